@@ -1,11 +1,28 @@
-#version 330 core
+#version 460 core
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
 
+// Per draw data of multi-draw indirect submissions, laid out like DrawData in draw_batches.h
+struct DrawData {
+    mat4 model;
+    vec4 positionOffset;
+    vec4 positionScale;
+    int materialIndex;
+};
+
+layout(std430, binding = 4) readonly buffer drawDataBuffer {
+    DrawData draws[];
+};
+
+// Set while drawing indirectly, the uniforms above are ignored then
+uniform bool indirectDraws;
+uniform int firstDraw;
+
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0); 
+    mat4 modelMatrix = indirectDraws ? draws[firstDraw + gl_DrawID].model : model;
+    gl_Position = projection * view * modelMatrix * vec4(aPos, 1.0);
 }
\ No newline at end of file
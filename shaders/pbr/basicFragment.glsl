@@ -1,10 +1,12 @@
 #version 460 core
+#extension GL_ARB_bindless_texture : enable
 
 out vec4 FragColor;
 
 in vec3 Normal;
 in vec3 WorldPos;
 in vec2 TexCoords;
+flat in int MaterialIndex;
 
 uniform vec3 viewPos;
 
@@ -14,6 +16,23 @@ uniform sampler2D texture_metallic;
 uniform sampler2D texture_ao;
 uniform sampler2D texture_roughness;
 
+// Laid out like MaterialEntry in material_table.h, slots are diffuse, normal, metallic, roughness and ao
+struct MaterialEntry {
+    uvec2 textures[5];
+    uint presentSlots;
+    float minLods[5];
+};
+
+layout(std430, binding = 5) readonly buffer materialTable {
+    MaterialEntry materials[];
+};
+
+// Only used without bindless handles, where textures are grouped into arrays of the same size and format
+layout(binding = 8) uniform sampler2DArray materialArrays[8];
+
+uniform bool useMaterialTable;
+uniform bool bindlessMaterials;
+
 uniform samplerCube irradianceMap;
 uniform samplerCube prefilterMap;
 uniform sampler2D brdfLUT;
@@ -28,9 +47,35 @@ const float PI = 3.14159265359;
 
 uniform Light lights[MAX_NUM_LIGHTS];
 
+// Levels above minLod haven't been streamed in, the level picked from the derivatives is clamped to it
+vec4 sampleTableTexture(uvec2 reference, vec2 uv, float minLod)
+{
+#ifdef GL_ARB_bindless_texture
+    if (bindlessMaterials) {
+        sampler2D table = sampler2D(reference);
+        return textureLod(table, uv, max(textureQueryLod(table, uv).y, minLod));
+    }
+#endif
+    float lod = max(textureQueryLod(materialArrays[reference.x], uv).y, minLod);
+    return textureLod(materialArrays[reference.x], vec3(uv, float(reference.y)), lod);
+}
+
+// From the material table when the draw's material is in it, fallback for textures the material doesn't have
+vec4 sampleMaterial(int slot, sampler2D boundTexture, vec2 uv, vec4 fallback)
+{
+    if (!useMaterialTable || MaterialIndex < 0) return texture(boundTexture, uv);
+
+    MaterialEntry material = materials[MaterialIndex];
+    if ((material.presentSlots & (1u << slot)) == 0u) return fallback;
+    return sampleTableTexture(material.textures[slot], uv, material.minLods[slot]);
+}
+
 vec3 getNormalFromMap()
 {
-    vec3 tangentNormal = texture(texture_normal, TexCoords).xyz * 2.0 - 1.0;
+    // Normal maps are baked as two channel BC5, z is rebuilt from the unit length
+    vec3 tangentNormal;
+    tangentNormal.xy = sampleMaterial(1, texture_normal, TexCoords, vec4(0.5, 0.5, 1.0, 1.0)).rg * 2.0 - 1.0;
+    tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
 
     vec3 Q1  = dFdx(WorldPos);
     vec3 Q2  = dFdy(WorldPos);
@@ -88,10 +133,10 @@ float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness) {
 }
 
 void main() {
-    vec3 albedo = pow(texture(texture_diffuse, TexCoords).rgb, vec3(2.2));
-    float metallic = texture(texture_metallic, TexCoords).g;
-    float roughness = texture(texture_roughness, TexCoords).b;
-    float ao = texture(texture_ao, TexCoords).r;
+    vec3 albedo = pow(sampleMaterial(0, texture_diffuse, TexCoords, vec4(1.0)).rgb, vec3(2.2));
+    float metallic = sampleMaterial(2, texture_metallic, TexCoords, vec4(0.0)).g;
+    float roughness = sampleMaterial(3, texture_roughness, TexCoords, vec4(1.0)).b;
+    float ao = sampleMaterial(4, texture_ao, TexCoords, vec4(1.0)).r;
 
     vec3 N = getNormalFromMap();
     vec3 V = normalize(viewPos - WorldPos);
@@ -6,16 +6,38 @@ layout (location = 2) in vec2 aTexCoords;
 out vec2 TexCoords;
 out vec3 WorldPos;
 out vec3 Normal;
+// Into the material table, -1 when the material's textures are bound
+flat out int MaterialIndex;
 
 uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
 
+// Per draw data of multi-draw indirect submissions, laid out like DrawData in draw_batches.h
+struct DrawData {
+    mat4 model;
+    vec4 positionOffset;
+    vec4 positionScale;
+    int materialIndex;
+};
+
+layout(std430, binding = 4) readonly buffer drawDataBuffer {
+    DrawData draws[];
+};
+
+// Set while drawing indirectly, the uniforms above are ignored then
+uniform bool indirectDraws;
+uniform int firstDraw;
+uniform int materialIndex;
+
 void main()
 {
+    mat4 modelMatrix = indirectDraws ? draws[firstDraw + gl_DrawID].model : model;
+    MaterialIndex = indirectDraws ? draws[firstDraw + gl_DrawID].materialIndex : materialIndex;
+
     TexCoords = aTexCoords;
-    WorldPos = vec3(model * vec4(aPos, 1.0));
-    Normal = (transpose(inverse(view * model)) * vec4(aNormal, 1.0)).rgb; 
+    WorldPos = vec3(modelMatrix * vec4(aPos, 1.0));
+    Normal = (transpose(inverse(view * modelMatrix)) * vec4(aNormal, 1.0)).rgb;
 
     gl_Position =  projection * view * vec4(WorldPos, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,71 @@
+#version 460 core
+// basicVertex.glsl for meshes baked with the PNTT_Q16 vertex format
+layout (location = 0) in vec4 aPos;
+layout (location = 1) in vec2 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec2 aTangent;
+
+out vec2 TexCoords;
+out vec3 WorldPos;
+out vec3 Normal;
+// Into the material table, -1 when the material's textures are bound
+flat out int MaterialIndex;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+
+// Mesh bounds the positions were quantized against
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+// Per draw data of multi-draw indirect submissions, laid out like DrawData in draw_batches.h
+struct DrawData {
+    mat4 model;
+    vec4 positionOffset;
+    vec4 positionScale;
+    int materialIndex;
+};
+
+layout(std430, binding = 4) readonly buffer drawDataBuffer {
+    DrawData draws[];
+};
+
+// Set while drawing indirectly, the uniforms above are ignored then
+uniform bool indirectDraws;
+uniform int firstDraw;
+uniform int materialIndex;
+
+vec3 decodeOctahedral(vec2 encoded)
+{
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (direction.z < 0.0) {
+        vec2 signs = vec2(encoded.x >= 0.0 ? 1.0 : -1.0, encoded.y >= 0.0 ? 1.0 : -1.0);
+        direction.xy = (1.0 - abs(direction.yx)) * signs;
+    }
+    return normalize(direction);
+}
+
+void main()
+{
+    mat4 modelMatrix = model;
+    vec3 offset = positionOffset;
+    vec3 scale = positionScale;
+    MaterialIndex = materialIndex;
+    if (indirectDraws) {
+        DrawData draw = draws[firstDraw + gl_DrawID];
+        modelMatrix = draw.model;
+        offset = draw.positionOffset.xyz;
+        scale = draw.positionScale.xyz;
+        MaterialIndex = draw.materialIndex;
+    }
+
+    vec3 position = offset + aPos.xyz * scale;
+    vec3 normal = decodeOctahedral(aNormal);
+
+    TexCoords = aTexCoords;
+    WorldPos = vec3(modelMatrix * vec4(position, 1.0));
+    Normal = (transpose(inverse(view * modelMatrix)) * vec4(normal, 1.0)).rgb;
+
+    gl_Position =  projection * view * vec4(WorldPos, 1.0);
+}
@@ -4,39 +4,39 @@
 
 #include "animation.h"
 
+#include <algorithm>
+#include <cmath>
 #include <glm/gtx/quaternion.hpp>
 
-std::vector<glm::mat4> Animation::getBoneTransforms(float time, const aiScene* scene,
-                                                    std::vector<NodeData>&nodeData, int animationIndex) {
+std::vector<glm::mat4> Animation::getBoneTransforms(float time, const AnimationClip& clip,
+                                                    std::vector<NodeData>&nodeData) {
     std::vector<glm::mat4> finalTransforms(bone_info.size());
-    const aiAnimation* animation = scene->mAnimations[animationIndex];
 
-    float ticksPerSecond = animation->mTicksPerSecond != 0
-                               ? animation->mTicksPerSecond
-                               : 25.0f;
-    float timeInTicks = time * ticksPerSecond;
-    float animationTimeTicks = fmod(timeInTicks, animation->mDuration);
+    // The clip loops, blend between the two frames around the current time
+    float frame = clip.duration > 0.0f ? fmod(time, clip.duration) * clip.sampleRate : 0.0f;
+    uint32_t lastFrame = clip.frameCount > 0 ? clip.frameCount - 1 : 0;
+    uint32_t currentFrame = std::min(static_cast<uint32_t>(frame), lastFrame);
+    uint32_t nextFrame = std::min(currentFrame + 1, lastFrame);
+    float factor = frame - currentFrame;
 
     glm::mat4 identity(1.0f);
+    size_t channelIndex = 0;
 
     for (int i = 0; i < nodeData.size(); i++) {
         NodeData&node = nodeData[i];
-        const aiNodeAnim* nodeAnim = findNodeAnim(animation, node.name);
         glm::mat4 totalTransform = node.originalTransform;
 
-        if (nodeAnim) {
-            const aiVector3D scaling = calcInterpolatedTransform(animationTimeTicks, nodeAnim->mNumScalingKeys,
-                                                                 nodeAnim->mScalingKeys);
-            glm::mat4 scalingMatrix = glm::scale(identity, glm::vec3(scaling.x, scaling.y, scaling.z));
+        while (channelIndex < clip.channels.size() && clip.channels[channelIndex].nodeIndex < i) {
+            channelIndex++;
+        }
+        if (channelIndex < clip.channels.size() && clip.channels[channelIndex].nodeIndex == i) {
+            const TransformSample& current = clip.channels[channelIndex].samples[currentFrame];
+            const TransformSample& next = clip.channels[channelIndex].samples[nextFrame];
 
-            const aiQuaternion rotationQ = calcInterpolatedRotation(animationTimeTicks, nodeAnim);
-            glm::quat rotateQ(rotationQ.w, rotationQ.x, rotationQ.y, rotationQ.z);
-            glm::mat4 rotationMatrix = glm::toMat4(rotateQ);
-
-            const aiVector3D translation = calcInterpolatedTransform(animationTimeTicks, nodeAnim->mNumPositionKeys,
-                                                                     nodeAnim->mPositionKeys);
-            glm::mat4 translationMatrix = glm::translate(
-                identity, glm::vec3(translation.x, translation.y, translation.z));
+            glm::mat4 scalingMatrix = glm::scale(identity, glm::mix(current.scale, next.scale, factor));
+            glm::mat4 rotationMatrix = glm::toMat4(glm::slerp(current.rotation, next.rotation, factor));
+            glm::mat4 translationMatrix = glm::translate(identity,
+                                                         glm::mix(current.translation, next.translation, factor));
 
             totalTransform = translationMatrix * rotationMatrix * scalingMatrix;
         }
@@ -53,10 +53,53 @@ std::vector<glm::mat4> Animation::getBoneTransforms(float time, const aiScene* s
     return finalTransforms;
 }
 
+AnimationClip sampleAnimation(const aiAnimation* animation, const std::vector<NodeData>&nodeData, float sampleRate) {
+    AnimationClip clip;
+    clip.name = animation->mName.C_Str();
+
+    float ticksPerSecond = animation->mTicksPerSecond != 0
+                               ? animation->mTicksPerSecond
+                               : 25.0f;
+    clip.duration = animation->mDuration / ticksPerSecond;
+    // Rounded up to a whole number of frames, which then divide the clip evenly
+    clip.frameCount = clip.duration > 0.0f ? static_cast<uint32_t>(std::ceil(clip.duration * sampleRate)) + 1 : 1;
+    clip.sampleRate = clip.frameCount > 1 ? (clip.frameCount - 1) / clip.duration : sampleRate;
+
+    for (uint32_t i = 0; i < nodeData.size(); i++) {
+        const aiNodeAnim* nodeAnim = findNodeAnim(animation, nodeData[i].name);
+        if (!nodeAnim) continue;
+
+        AnimationChannel channel;
+        channel.nodeIndex = i;
+        channel.samples.resize(clip.frameCount);
+        for (uint32_t frame = 0; frame < clip.frameCount; frame++) {
+            float ticks = clip.frameCount > 1 ? animation->mDuration * frame / (clip.frameCount - 1) : 0.0f;
+
+            const aiVector3D scaling = calcInterpolatedTransform(ticks, nodeAnim->mNumScalingKeys,
+                                                                 nodeAnim->mScalingKeys);
+            const aiQuaternion rotation = calcInterpolatedRotation(ticks, nodeAnim);
+            const aiVector3D translation = calcInterpolatedTransform(ticks, nodeAnim->mNumPositionKeys,
+                                                                     nodeAnim->mPositionKeys);
+
+            TransformSample& sample = channel.samples[frame];
+            sample.translation = glm::vec3(translation.x, translation.y, translation.z);
+            sample.rotation = glm::quat(rotation.w, rotation.x, rotation.y, rotation.z);
+            sample.scale = glm::vec3(scaling.x, scaling.y, scaling.z);
+        }
+        clip.channels.push_back(std::move(channel));
+    }
+
+    return clip;
+}
+
 aiVector3D calcInterpolatedTransform(float animationTicks, unsigned numKeys, aiVectorKey* keys) {
-    if (numKeys == 1) {
+    // Held before the first and after the last key
+    if (numKeys == 1 || animationTicks <= keys[0].mTime) {
         return keys[0].mValue;
     }
+    if (animationTicks >= keys[numKeys - 1].mTime) {
+        return keys[numKeys - 1].mValue;
+    }
 
     unsigned int transformIndex = 0;
     for (unsigned int i = 0; i < numKeys - 1; i++) {
@@ -79,9 +122,13 @@ aiVector3D calcInterpolatedTransform(float animationTicks, unsigned numKeys, aiV
 }
 
 aiQuaternion calcInterpolatedRotation(float animationTicks, const aiNodeAnim* nodeAnim) {
-    if (nodeAnim->mNumRotationKeys == 1) {
+    unsigned int numKeys = nodeAnim->mNumRotationKeys;
+    if (numKeys == 1 || animationTicks <= nodeAnim->mRotationKeys[0].mTime) {
         return nodeAnim->mRotationKeys[0].mValue;
     }
+    if (animationTicks >= nodeAnim->mRotationKeys[numKeys - 1].mTime) {
+        return nodeAnim->mRotationKeys[numKeys - 1].mValue;
+    }
 
     unsigned int rotationIndex = 0;
     for (unsigned int i = 0; i < nodeAnim->mNumRotationKeys - 1; i++) {
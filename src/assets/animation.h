@@ -5,6 +5,7 @@
 #ifndef ANIMATION_H
 #define ANIMATION_H
 #include <assimp/scene.h>
+#include <glm/gtc/quaternion.hpp>
 #include <utils/types.h>
 
 struct NodeData {
@@ -14,17 +15,45 @@ struct NodeData {
     int parentIndex;
 };
 
+// Local transform of a node at one frame of a clip
+struct TransformSample {
+    glm::vec3 translation;
+    glm::quat rotation;
+    glm::vec3 scale;
+};
+static_assert(sizeof(TransformSample) == 40, "Transform samples are stored as is in clip assets");
+
+// frameCount samples of one animated node
+struct AnimationChannel {
+    uint32_t nodeIndex;
+    std::vector<TransformSample> samples;
+};
+
+// A clip resampled at a fixed rate at bake time, so playing it needs neither the Assimp scene nor key searches.
+// Channels are sorted by node index.
+struct AnimationClip {
+    std::string name;
+    // Seconds, the first and last frames land exactly on 0 and duration
+    float duration = 0.0f;
+    float sampleRate = 0.0f;
+    uint32_t frameCount = 0;
+    std::vector<AnimationChannel> channels;
+};
+
+// The skin of one mesh: bone weights of every vertex and the bones they refer to
 struct Animation {
     std::vector<VertexBoneData> bone_data;
     std::vector<BoneInfo> bone_info;
     std::unordered_map<std::string, unsigned int> boneName_To_Index;
 
-    unsigned int animationSSBO;
+    unsigned int animationSSBO = 0;
 
-    std::vector<glm::mat4> getBoneTransforms(float time, const aiScene* scene, std::vector<NodeData>&nodeData,
-                                             int animationIndex = 0);
+    std::vector<glm::mat4> getBoneTransforms(float time, const AnimationClip& clip, std::vector<NodeData>&nodeData);
 };
 
+// Samples every channel of the animation that drives one of the nodes, at least sampleRate times per second
+AnimationClip sampleAnimation(const aiAnimation* animation, const std::vector<NodeData>& nodeData, float sampleRate);
+
 aiVector3D calcInterpolatedTransform(float animationTicks, unsigned int numKeys, aiVectorKey* keys);
 
 aiQuaternion calcInterpolatedRotation(float animationTicks, const aiNodeAnim* nodeAnim);
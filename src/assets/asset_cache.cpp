@@ -0,0 +1,160 @@
+#include "asset_cache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <nlohmann/json.hpp>
+
+#include "utils/hash.h"
+#include "utils/load_profiler.h"
+
+bool assets::recordSourceFile(const std::string& path, SourceRecord& record) {
+    ScopedLoadTimer timer(LoadStage::FileIO);
+    record.path = path;
+
+    std::error_code error;
+    record.size = std::filesystem::file_size(path, error);
+    if (error) return false;
+    record.modifiedTime = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    if (error) return false;
+
+    MappedFile mapping;
+    if (record.size > 0 && !mapping.open(path)) return false;
+    record.hash = hashBytes(mapping.data(), mapping.size());
+    addFileBytes(mapping.size());
+
+    return true;
+}
+
+bool assets::isSourceUnchanged(const SourceRecord& record) {
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(record.path, error);
+    if (error || size != record.size) return false;
+
+    int64_t modifiedTime = std::filesystem::last_write_time(record.path, error).time_since_epoch().count();
+    if (error) return false;
+    if (modifiedTime == record.modifiedTime) return true;
+
+    // Touched but possibly not edited
+    SourceRecord current;
+    return recordSourceFile(record.path, current) && current.hash == record.hash;
+}
+
+std::vector<std::string> assets::collectModelSourceFiles(const std::string& path) {
+    std::vector<std::string> files = {path};
+    std::filesystem::path modelPath(path);
+    std::string directory = path.substr(0, path.find_last_of('/') + 1);
+    std::string extension = modelPath.extension().string();
+
+    std::ifstream inputFile(path);
+    if (!inputFile.is_open()) return files;
+
+    if (extension == ".gltf") {
+        nlohmann::json gltf = nlohmann::json::parse(inputFile, nullptr, false);
+        if (gltf.is_discarded() || !gltf.contains("buffers")) return files;
+
+        for (const nlohmann::json& buffer : gltf["buffers"]) {
+            if (!buffer.contains("uri")) continue;
+
+            std::string uri = buffer["uri"].get<std::string>();
+            if (uri.rfind("data:", 0) != 0) files.push_back(directory + uri);
+        }
+    }
+    else if (extension == ".obj") {
+        std::string line;
+        while (std::getline(inputFile, line)) {
+            if (line.rfind("mtllib ", 0) != 0) continue;
+
+            std::istringstream stream(line.substr(7));
+            std::string library;
+            while (stream >> library) files.push_back(directory + library);
+        }
+    }
+
+    return files;
+}
+
+bool assets::CachedPack::open(const std::string& packPath, uint64_t settingsHash,
+                              const std::vector<std::string>& sourceFiles) {
+    close();
+    if (!pack.open(packPath)) return false;
+    path = packPath;
+
+    bool hasInfo = false, hasScene = false;
+    for (const PackEntry& entry : pack.getEntries()) {
+        if (isEntryType(entry, "MESH")) {
+            meshEntries.push_back(entry);
+        }
+        else if (isEntryType(entry, "SCEN")) {
+            sceneEntry = entry;
+            hasScene = true;
+        }
+        else if (isEntryType(entry, "SKIN")) {
+            skinEntries.push_back(entry);
+        }
+        else if (isEntryType(entry, "ANIM")) {
+            clipEntries.push_back(entry);
+        }
+        else if (isEntryType(entry, "TEXI")) {
+            textureEntries.push_back(entry);
+        }
+        else if (isEntryType(entry, "INFO")) {
+            AssetFileView file;
+            if (!pack.getEntryView(entry, file)) return false;
+
+            info = AssetConverter().convertBinaryToModelAssetInfo(file);
+            hasInfo = true;
+        }
+    }
+
+    if (!hasInfo || !hasScene || info.settingsHash != settingsHash ||
+        info.textureSources.size() != textureEntries.size()) {
+        close();
+        return false;
+    }
+
+    geometryChanged = info.sources.size() != sourceFiles.size();
+    for (size_t i = 0; i < info.sources.size() && !geometryChanged; i++) {
+        geometryChanged = info.sources[i].path != sourceFiles[i] || !isSourceUnchanged(info.sources[i]);
+    }
+
+    staleTextures.resize(info.textureSources.size());
+    for (size_t i = 0; i < info.textureSources.size(); i++) {
+        const SourceRecord& record = info.textureSources[i];
+        staleTextures[i] = record.embedded ? geometryChanged : !isSourceUnchanged(record);
+        textureIndices[record.path] = i;
+    }
+
+    return true;
+}
+
+void assets::CachedPack::close() {
+    path.clear();
+    pack.close();
+    info = {};
+    geometryChanged = true;
+    meshEntries.clear();
+    sceneEntry = {};
+    skinEntries.clear();
+    clipEntries.clear();
+    textureEntries.clear();
+    staleTextures.clear();
+    textureIndices.clear();
+}
+
+bool assets::CachedPack::isFresh() const {
+    if (geometryChanged) return false;
+
+    for (bool stale : staleTextures) {
+        if (stale) return false;
+    }
+    return true;
+}
+
+bool assets::CachedPack::findReusableTexture(const std::string& path, size_t& textureIndex) const {
+    auto iterator = textureIndices.find(path);
+    if (iterator == textureIndices.end() || staleTextures[iterator->second]) return false;
+
+    textureIndex = iterator->second;
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "asset_converter.h"
+#include "asset_pack.h"
+
+namespace assets {
+
+bool recordSourceFile(const std::string& path, SourceRecord& record);
+// Compares size and modification time first and only hashes the file when those differ
+bool isSourceUnchanged(const SourceRecord& record);
+
+// The model file plus the files it pulls in (glTF buffers, OBJ material libraries)
+std::vector<std::string> collectModelSourceFiles(const std::string& path);
+
+// An existing pack checked against the current sources, so whatever is still valid can be reused while rebaking
+struct CachedPack {
+    std::string path;
+    PackFile pack;
+    ModelAssetInfo info;
+
+    bool geometryChanged = true;
+    std::vector<PackEntry> meshEntries;
+    PackEntry sceneEntry;
+    std::vector<PackEntry> skinEntries;
+    std::vector<PackEntry> clipEntries;
+    // Indexed like info.textureSources
+    std::vector<PackEntry> textureEntries;
+    std::vector<bool> staleTextures;
+    std::unordered_map<std::string, size_t> textureIndices;
+
+    // Returns false if the pack is missing, unreadable or was baked with different settings
+    bool open(const std::string& packPath, uint64_t settingsHash, const std::vector<std::string>& sourceFiles);
+    void close();
+
+    bool isFresh() const;
+    bool findReusableTexture(const std::string& path, size_t& textureIndex) const;
+};
+}
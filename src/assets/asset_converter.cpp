@@ -3,183 +3,729 @@
 //
 
 #include "asset_converter.h"
+#include "asset_headers.h"
+#include "texture_compression.h"
+#include "texture_mips.h"
+#include "texture_registry.h"
+#include "vertex_quantization.h"
+#include "utils/load_profiler.h"
 #include <nlohmann/json.hpp>
 #include <lz4.h>
+#include <algorithm>
+#include <iostream>
 
-assets::AssetFile AssetConverter::convertMeshToBinary(Mesh& mesh) {
+assets::AssetFile AssetConverter::convertMeshToBinary(Mesh& mesh, VertexFormat format) {
     assets::AssetFile file;
     file.type[0] = 'M';
     file.type[1] = 'E';
     file.type[2] = 'S';
     file.type[3] = 'H';
-    file.version = 1;
-
-    nlohmann::json metadata;
-    metadata["vertex_format"] = "PNTTB_F32";
-    size_t vertexBufferSize = mesh.vertices.size() * sizeof(Vertex);
-    size_t indexBufferSize = mesh.indices.size() * sizeof(unsigned);
-    metadata["vertex_buffer_size"] = vertexBufferSize;
-    metadata["indices_buffer_size"] = indexBufferSize;
-
-    std::vector<float> boundsData;
-    boundsData.resize(8);
-    boundsData[0] = mesh.aabb.maxPoint.x;
-    boundsData[1] = mesh.aabb.maxPoint.y;
-    boundsData[2] = mesh.aabb.maxPoint.z;
-    boundsData[3] = mesh.aabb.maxPoint.w;
-    boundsData[4] = mesh.aabb.minPoint.x;
-    boundsData[5] = mesh.aabb.minPoint.y;
-    boundsData[6] = mesh.aabb.minPoint.z;
-    boundsData[7] = mesh.aabb.minPoint.w;
-    metadata["bounds"] = boundsData;
-
-    std::vector<char> mergedBuffer;
-    mergedBuffer.resize(vertexBufferSize + indexBufferSize);
-    memcpy(mergedBuffer.data(), mesh.vertices.data(), vertexBufferSize);
-    memcpy(mergedBuffer.data() + vertexBufferSize, mesh.indices.data(), indexBufferSize);
-
-    int possibleCompressSize = LZ4_compressBound(mergedBuffer.size());
-    file.binaryBlob.resize(possibleCompressSize);
-
-    int compressedSize = LZ4_compress_default(mergedBuffer.data(), file.binaryBlob.data(), mergedBuffer.size(), possibleCompressSize);
-    file.binaryBlob.resize(compressedSize);
-
-    metadata["compression"] = "LZ4";
-    file.json = metadata.dump();
+    file.version = assets::ASSET_FILE_VERSION;
+
+    // Quantized meshes store their packed vertices, the bounds below are what they are dequantized with
+    if (format == VertexFormat::Quantized && mesh.packedVertices.empty()) {
+        mesh.packedVertices = assets::packVertices(mesh.vertices, mesh.aabb);
+    }
+    const char* vertexData = format == VertexFormat::Quantized ? (const char*)mesh.packedVertices.data()
+                                                                : (const char*)mesh.vertices.data();
+
+    assets::MeshHeader header;
+    header.vertexFormat = format == VertexFormat::Quantized ? assets::MeshVertexFormat::PNTT_Q16
+                                                            : assets::MeshVertexFormat::PNTTB_F32;
+    header.vertexBufferSize = format == VertexFormat::Quantized ? mesh.packedVertices.size() * sizeof(PackedVertex)
+                                                                : mesh.vertices.size() * sizeof(Vertex);
+    header.indexSize = mesh.indexSize;
+    header.indexBufferSize = mesh.indices.size() * mesh.indexSize;
+    header.meshletBufferSize = mesh.meshlets.size() * sizeof(Meshlet);
+    header.lodCount = mesh.lods.size();
+    memcpy(header.boundsMin, &mesh.aabb.minPoint, sizeof(header.boundsMin));
+    memcpy(header.boundsMax, &mesh.aabb.maxPoint, sizeof(header.boundsMax));
+    header.uvDensity = mesh.uvDensity;
+
+    // Vertices, indices and meshlets are compressed as independent blocks so that loading can
+    // decompress each one straight into its final vector
+    int vertexCompressBound = LZ4_compressBound(header.vertexBufferSize);
+    int indexCompressBound = LZ4_compressBound(header.indexBufferSize);
+    int meshletCompressBound = LZ4_compressBound(header.meshletBufferSize);
+    file.binaryBlob.resize(vertexCompressBound + indexCompressBound + meshletCompressBound);
+
+    header.vertexCompressedSize = LZ4_compress_default(vertexData, file.binaryBlob.data(),
+        header.vertexBufferSize, vertexCompressBound);
+    std::vector<uint16_t> shortIndices;
+    const char* indexData = (const char*)mesh.indices.data();
+    if (mesh.indexSize == 2) {
+        shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+        indexData = (const char*)shortIndices.data();
+    }
+    header.indexCompressedSize = LZ4_compress_default(indexData,
+        file.binaryBlob.data() + header.vertexCompressedSize, header.indexBufferSize, indexCompressBound);
+    header.meshletCompressedSize = LZ4_compress_default((const char*)mesh.meshlets.data(),
+        file.binaryBlob.data() + header.vertexCompressedSize + header.indexCompressedSize, header.meshletBufferSize,
+        meshletCompressBound);
+    file.binaryBlob.resize(header.vertexCompressedSize + header.indexCompressedSize + header.meshletCompressedSize);
+
+    // LOD levels are ranges of the index buffer, all sharing the vertices
+    assets::appendMetadata(file.metadata, header);
+    for (const MeshLod& lod : mesh.lods) {
+        assets::appendMetadata(file.metadata, lod);
+    }
 
     return file;
 }
 
 Mesh AssetConverter::convertBinaryToMesh(const std::string& path) {
-    assets::AssetFile file;
-    loadBinaryFile(path, file);
-
-    auto metadata = nlohmann::json::parse(file.json);
-    auto bounds = metadata["bounds"].get<std::vector<float>>();
-    size_t vertexBufferSize = metadata["vertex_buffer_size"];
-    size_t indexBufferSize = metadata["indices_buffer_size"];
-    size_t totalBufferSize = vertexBufferSize + indexBufferSize;
-
-    Mesh mesh;
-    glm::vec4 maxPoint(bounds[0], bounds[1], bounds[2], bounds[3]);
-    glm::vec4 minPoint(bounds[4], bounds[5], bounds[6], bounds[7]);
-    mesh.aabb.maxPoint = maxPoint;
-    mesh.aabb.minPoint = minPoint;
+    assets::MappedFile mapping;
+    assets::AssetFileView file;
+    if (!assets::mapBinaryFile(path, mapping, file)) {
+        std::cout << "Failed to open mesh asset at path: " << path << "\n";
+        return {};
+    }
 
-    std::vector<char> uncompressedData;
-    uncompressedData.resize(totalBufferSize);
-    LZ4_decompress_safe(file.binaryBlob.data(), uncompressedData.data(), file.binaryBlob.size(), totalBufferSize);
+    return convertBinaryToMesh(file);
+}
 
-    std::vector<char> vertexBufferData;
-    std::vector<char> indexBufferData;
-    vertexBufferData.resize(vertexBufferSize);
-    indexBufferData.resize(indexBufferSize);
+namespace {
+// Where the buffers of a mesh asset are, whichever header version described them
+struct MeshBlocks {
+    bool quantized = false;
+    size_t vertexBufferSize = 0;
+    size_t indexBufferSize = 0;
+    size_t meshletBufferSize = 0;
+    // The first baked meshes kept vertices and indices in a single block, marked by a vertex block size of -1
+    int vertexBlockSize = -1;
+    int indexBlockSize = 0;
+    int meshletBlockSize = 0;
+};
+
+bool readMeshMetadataV1(const assets::AssetFileView& file, Mesh& mesh, MeshBlocks& blocks) {
+    auto metadata = nlohmann::json::parse(file.metadata);
+    auto bounds = metadata["bounds"].get<std::vector<float>>();
+    mesh.aabb.maxPoint = glm::vec4(bounds[0], bounds[1], bounds[2], bounds[3]);
+    mesh.aabb.minPoint = glm::vec4(bounds[4], bounds[5], bounds[6], bounds[7]);
+    mesh.indexSize = metadata.value("index_size", 4u);
+    if (metadata.contains("lods")) {
+        for (const nlohmann::json& lod : metadata["lods"]) {
+            mesh.lods.push_back({lod["index_offset"], lod["index_count"], lod["error"]});
+        }
+    }
 
-    memcpy(vertexBufferData.data(), uncompressedData.data(), vertexBufferSize);
-    memcpy(indexBufferData.data(), uncompressedData.data() + vertexBufferSize, indexBufferSize);
+    blocks.quantized = metadata["vertex_format"] == "PNTT_Q16";
+    blocks.vertexBufferSize = metadata["vertex_buffer_size"];
+    blocks.indexBufferSize = metadata["indices_buffer_size"];
+    blocks.meshletBufferSize = metadata.value("meshlet_buffer_size", size_t(0));
+
+    auto vertexCompressedSize = metadata.find("vertex_compressed_size");
+    if (vertexCompressedSize != metadata.end()) {
+        blocks.vertexBlockSize = *vertexCompressedSize;
+        // Assets baked before meshlets end with the index block
+        blocks.indexBlockSize = metadata.value("index_compressed_size",
+                                               static_cast<int>(file.blob.size) - blocks.vertexBlockSize);
+        blocks.meshletBlockSize = static_cast<int>(file.blob.size) - blocks.vertexBlockSize - blocks.indexBlockSize;
+    }
+    return true;
+}
 
-    std::vector<Vertex> vertices;
-    std::vector<unsigned> indices;
+bool readMeshMetadataV2(const assets::AssetFileView& file, Mesh& mesh, MeshBlocks& blocks) {
+    assets::MetadataReader reader(file.metadata);
+    assets::MeshHeader header;
+    if (!assets::readAssetHeader(reader, header) || header.compression != assets::AssetCompression::LZ4 ||
+        reader.remaining() != header.lodCount * sizeof(MeshLod) ||
+        file.blob.size != uint64_t(header.vertexCompressedSize) + header.indexCompressedSize +
+                          header.meshletCompressedSize) {
+        return false;
+    }
 
-    size_t vertexVectorSize = vertexBufferSize / sizeof(Vertex);
-    size_t indexVectorSize = indexBufferSize / sizeof(unsigned);
+    memcpy(&mesh.aabb.minPoint, header.boundsMin, sizeof(header.boundsMin));
+    memcpy(&mesh.aabb.maxPoint, header.boundsMax, sizeof(header.boundsMax));
+    mesh.uvDensity = header.uvDensity;
+    mesh.indexSize = header.indexSize;
+    mesh.lods.resize(header.lodCount);
+    for (MeshLod& lod : mesh.lods) {
+        reader.read(lod);
+    }
 
-    vertices.resize(vertexVectorSize);
-    indices.resize(indexVectorSize);
+    blocks.quantized = header.vertexFormat == assets::MeshVertexFormat::PNTT_Q16;
+    blocks.vertexBufferSize = header.vertexBufferSize;
+    blocks.indexBufferSize = header.indexBufferSize;
+    blocks.meshletBufferSize = header.meshletBufferSize;
+    blocks.vertexBlockSize = header.vertexCompressedSize;
+    blocks.indexBlockSize = header.indexCompressedSize;
+    blocks.meshletBlockSize = header.meshletCompressedSize;
+    return true;
+}
+}
 
-    auto* unpackedIndices = (unsigned*)indexBufferData.data();
-    for (int i = 0; i < indexVectorSize; i++) {
-        indices[i] = unpackedIndices[i];
+Mesh AssetConverter::convertBinaryToMesh(const assets::AssetFileView& file) const {
+    Mesh mesh;
+    MeshBlocks blocks;
+    bool validHeader;
+    {
+        ScopedLoadTimer timer(LoadStage::HeaderParse);
+        validHeader = file.version == 1 ? readMeshMetadataV1(file, mesh, blocks)
+                                        : readMeshMetadataV2(file, mesh, blocks);
+    }
+    if (!validHeader || (mesh.indexSize != 2 && mesh.indexSize != 4)) {
+        std::cout << "Mesh asset has an invalid header \n";
+        return {};
     }
 
-    auto* unpackedVertices = (Vertex*)vertexBufferData.data();
-    for (int i = 0; i < vertexVectorSize; i++) {
-        vertices[i] = unpackedVertices[i];
+    char* vertexData;
+    if (blocks.quantized) {
+        mesh.packedVertices.resize(blocks.vertexBufferSize / sizeof(PackedVertex));
+        vertexData = (char*)mesh.packedVertices.data();
+    }
+    else {
+        mesh.vertices.resize(blocks.vertexBufferSize / sizeof(Vertex));
+        vertexData = (char*)mesh.vertices.data();
+    }
+    mesh.indices.resize(blocks.indexBufferSize / mesh.indexSize);
+    mesh.meshlets.resize(blocks.meshletBufferSize / sizeof(Meshlet));
+
+    ScopedLoadTimer timer(LoadStage::Decompress);
+    addDecompressedBytes(blocks.vertexBufferSize + blocks.indexBufferSize + blocks.meshletBufferSize);
+    if (blocks.vertexBlockSize >= 0) {
+        int decompressedVertices = LZ4_decompress_safe(file.blob.data, vertexData,
+            blocks.vertexBlockSize, blocks.vertexBufferSize);
+        int decompressedIndices = LZ4_decompress_safe(file.blob.data + blocks.vertexBlockSize,
+            (char*)mesh.indices.data(), blocks.indexBlockSize, blocks.indexBufferSize);
+        int decompressedMeshlets = blocks.meshletBufferSize == 0 ? 0 : LZ4_decompress_safe(
+            file.blob.data + blocks.vertexBlockSize + blocks.indexBlockSize, (char*)mesh.meshlets.data(),
+            blocks.meshletBlockSize, blocks.meshletBufferSize);
+        if (decompressedVertices != blocks.vertexBufferSize || decompressedIndices != blocks.indexBufferSize ||
+            decompressedMeshlets != blocks.meshletBufferSize) {
+            std::cout << "Mesh asset is corrupted \n";
+            return {};
+        }
+    }
+    else {
+        std::vector<char> uncompressedData(blocks.vertexBufferSize + blocks.indexBufferSize);
+        int decompressedSize = LZ4_decompress_safe(file.blob.data, uncompressedData.data(), file.blob.size,
+            uncompressedData.size());
+        if (decompressedSize != uncompressedData.size()) {
+            std::cout << "Mesh asset is corrupted \n";
+            return {};
+        }
+
+        memcpy(vertexData, uncompressedData.data(), blocks.vertexBufferSize);
+        memcpy(mesh.indices.data(), uncompressedData.data() + blocks.vertexBufferSize, blocks.indexBufferSize);
     }
 
-    mesh.indices = indices;
-    mesh.vertices = vertices;
+    // 16 bit indices were decompressed into the front of the buffer, widen them back to front so none get overwritten
+    if (mesh.indexSize == 2) {
+        const char* shortIndices = (const char*)mesh.indices.data();
+        for (size_t i = mesh.indices.size(); i-- > 0;) {
+            uint16_t index;
+            memcpy(&index, shortIndices + i * sizeof(uint16_t), sizeof(uint16_t));
+            mesh.indices[i] = index;
+        }
+    }
 
     return mesh;
 }
 
-assets::AssetFile AssetConverter::convertTextureToBinary(Texture& texture) {
-    nlohmann::json textureMetadata;
-    textureMetadata["type"] = texture.type;
-    textureMetadata["format"] = "RGBA8";
-    textureMetadata["width"] = texture.width;
-    textureMetadata["height"] = texture.height;
-    textureMetadata["nrComponents"] = texture.nrComponents;
+namespace {
+// Appends data to the blob as one more LZ4 block
+void appendCompressedBlock(std::vector<char>& blob, const void* data, size_t size) {
+    int compressBound = LZ4_compressBound(size);
+    size_t offset = blob.size();
+    blob.resize(offset + compressBound);
+    int compressedSize = LZ4_compress_default((const char*)data, blob.data() + offset, size, compressBound);
+    blob.resize(offset + compressedSize);
+}
 
-    // TODO: Change this to account for other texture formats (Not everything will be 8 bits per channel)
-    int32_t textureBufferSize = texture.height * texture.width * texture.nrComponents;
-    textureMetadata["buffer_size"] = textureBufferSize;
+bool decompressBlock(const assets::ByteSpan& blob, void* data, size_t size) {
+    if (size == 0) return true;
+
+    ScopedLoadTimer timer(LoadStage::Decompress);
+    addDecompressedBytes(size);
+    return LZ4_decompress_safe(blob.data, (char*)data, blob.size, size) == static_cast<int>(size);
+}
+}
+
+assets::AssetFile AssetConverter::convertTextureToBinary(Texture& texture) {
+    assets::TextureHeader header;
+    header.format = static_cast<uint32_t>(texture.format);
+    header.width = texture.width;
+    header.height = texture.height;
+    header.nrComponents = texture.nrComponents;
+    header.levels = texture.levels;
+    header.bufferSize = texture.dataSize;
+    header.contentHash = texture.contentHash != 0 ? texture.contentHash : assets::computeTextureContentHash(texture);
+    header.typeLength = texture.type.size();
+    header.pathLength = texture.path.size();
 
     assets::AssetFile file;
     file.type[0] = 'T';
     file.type[1] = 'E';
     file.type[2] = 'X';
     file.type[3] = 'I';
-    file.version = 1;
-
-    int possibleCompressSize = LZ4_compressBound(textureBufferSize);
-    file.binaryBlob.resize(possibleCompressSize);
-
-    int compressedSize = LZ4_compress_default((const char*)texture.data, file.binaryBlob.data(), textureBufferSize, possibleCompressSize);
-    file.binaryBlob.resize(compressedSize);
-
-    textureMetadata["compression"] = "LZ4";
-    file.json = textureMetadata.dump();
+    file.version = assets::ASSET_FILE_VERSION;
+
+    assets::appendMetadata(file.metadata, header);
+    file.metadata += texture.type;
+    file.metadata += texture.path;
+
+    // Every level is its own block so streaming can decompress just the levels it needs
+    size_t offset = 0;
+    for (int level = 0; level < texture.levels; level++) {
+        size_t levelSize = assets::getMipRangeSize(texture, level, level + 1);
+        size_t blobSize = file.binaryBlob.size();
+        appendCompressedBlock(file.binaryBlob, texture.data + offset, levelSize);
+        assets::appendMetadata(file.metadata, static_cast<uint32_t>(file.binaryBlob.size() - blobSize));
+        offset += levelSize;
+    }
 
     return file;
 }
 
 Texture AssetConverter::convertBinaryToTexture(const std::string& path) {
-    assets::AssetFile file;
-    loadBinaryFile(path, file);
+    assets::MappedFile mapping;
+    assets::AssetFileView file;
+    if (!assets::mapBinaryFile(path, mapping, file)) {
+        std::cout << "Failed to open texture asset at path: " << path << "\n";
+        return {};
+    }
 
-    auto metadata = nlohmann::json::parse(file.json);
+    return convertBinaryToTexture(file);
+}
+
+namespace {
+Texture readTextureMetadataV1(const assets::AssetFileView& file) {
+    auto metadata = nlohmann::json::parse(file.metadata);
 
     Texture texture;
     texture.height = metadata["height"];
     texture.width = metadata["width"];
     texture.nrComponents = metadata["nrComponents"];
     texture.type = metadata["type"].get<std::string>();
+    if (metadata.contains("path")) texture.path = metadata["path"].get<std::string>();
+    texture.format = assets::getTextureFormatFromName(metadata["format"].get<std::string>());
+    texture.dataSize = metadata["buffer_size"];
+    texture.levels = metadata.value("levels", 1);
+
+    return texture;
+}
+}
+
+Texture AssetConverter::readTextureMetadata(const assets::AssetFileView& file) const {
+    ScopedLoadTimer timer(LoadStage::HeaderParse);
+    if (file.version == 1) return readTextureMetadataV1(file);
+
+    assets::MetadataReader reader(file.metadata);
+    assets::TextureHeader header;
+    Texture texture;
+    if (!assets::readAssetHeader(reader, header) || header.compression != assets::AssetCompression::LZ4 ||
+        header.format > static_cast<uint32_t>(TextureFormat::BC7) || !reader.readString(header.typeLength, texture.type) ||
+        !reader.readString(header.pathLength, texture.path)) {
+        std::cout << "Texture asset has an invalid header \n";
+        return {};
+    }
+
+    texture.format = static_cast<TextureFormat>(header.format);
+    texture.width = header.width;
+    texture.height = header.height;
+    texture.nrComponents = header.nrComponents;
+    texture.levels = header.levels;
+    texture.dataSize = header.bufferSize;
+    texture.contentHash = header.contentHash;
+
+    return texture;
+}
+
+namespace {
+// The compressed block of every level, version 1 files hold the whole chain in a single block
+bool getTextureLevelBlocks(const assets::AssetFileView& file, const Texture& texture,
+                           std::vector<assets::ByteSpan>& blocks) {
+    if (file.version == 1) {
+        blocks = {file.blob};
+        return true;
+    }
+
+    assets::MetadataReader reader(file.metadata);
+    assets::TextureHeader header;
+    std::string skipped;
+    if (!assets::readAssetHeader(reader, header) || !reader.readString(header.typeLength + header.pathLength, skipped) ||
+        reader.remaining() != texture.levels * sizeof(uint32_t) ||
+        texture.dataSize != assets::getMipRangeSize(texture, 0, texture.levels)) {
+        return false;
+    }
+
+    size_t offset = 0;
+    blocks.resize(texture.levels);
+    for (assets::ByteSpan& block : blocks) {
+        uint32_t compressedSize;
+        reader.read(compressedSize);
+        if (compressedSize > file.blob.size - offset) return false;
 
-    int textureBufferSize = metadata["buffer_size"];
+        block = {file.blob.data + offset, compressedSize};
+        offset += compressedSize;
+    }
+    return offset == file.blob.size;
+}
+}
+
+Texture AssetConverter::convertBinaryToTexture(const assets::AssetFileView& file, int firstLevel) const {
+    Texture texture = readTextureMetadata(file);
+    std::vector<assets::ByteSpan> blocks;
+    if (texture.dataSize == 0 || !getTextureLevelBlocks(file, texture, blocks)) return texture;
+
+    // Single block files can only be decompressed whole
+    texture.firstLevel = blocks.size() == 1 ? 0 : std::clamp(firstLevel, 0, texture.levels - 1);
+    texture.dataSize = blocks.size() == 1 ? texture.dataSize
+                                          : assets::getMipRangeSize(texture, texture.firstLevel, texture.levels);
     // TODO: Fix this to not use malloc because it doesn't account for exceptions and errors
-    texture.data = (unsigned char*)malloc(textureBufferSize);
-    LZ4_decompress_safe(file.binaryBlob.data(), (char*)texture.data, file.binaryBlob.size(), textureBufferSize);
+    texture.data = (unsigned char*)malloc(texture.dataSize);
+
+    size_t offset = 0;
+    for (size_t level = texture.firstLevel; level < blocks.size(); level++) {
+        size_t levelSize = blocks.size() == 1 ? texture.dataSize : assets::getMipRangeSize(texture, level, level + 1);
+        if (!decompressBlock(blocks[level], texture.data + offset, levelSize)) {
+            std::cout << "Texture asset " << texture.path << " is corrupted \n";
+            free(texture.data);
+            texture.data = nullptr;
+            return texture;
+        }
+        offset += levelSize;
+    }
 
     return texture;
 }
 
+bool AssetConverter::convertBinaryToTextureLevel(const assets::AssetFileView& file, int level, unsigned char* data,
+                                                 size_t size) const {
+    Texture texture = readTextureMetadata(file);
+    std::vector<assets::ByteSpan> blocks;
+    if (texture.dataSize == 0 || !getTextureLevelBlocks(file, texture, blocks) || blocks.size() == 1 ||
+        level < 0 || level >= texture.levels || size != assets::getMipRangeSize(texture, level, level + 1)) {
+        return false;
+    }
+
+    return decompressBlock(blocks[level], data, size);
+}
+
+namespace {
+bool readScene(assets::MetadataReader& reader, SceneAsset& scene) {
+    assets::SceneHeader header;
+    if (!assets::readAssetHeader(reader, header) ||
+        header.nodeCount > reader.remaining() / sizeof(assets::NodeRecord)) {
+        return false;
+    }
+
+    scene.nodes.resize(header.nodeCount);
+    for (int i = 0; i < scene.nodes.size(); i++) {
+        NodeData& node = scene.nodes[i];
+        assets::NodeRecord record;
+        // Parents always come before their children, which is what bone transforms are accumulated in
+        if (!reader.read(record) || !reader.readString(record.nameLength, node.name) || record.parentIndex >= i) {
+            return false;
+        }
+        node.originalTransform = glm::make_mat4(record.transform);
+        node.transformation = node.originalTransform;
+        node.parentIndex = record.parentIndex;
+    }
+
+    if (header.materialCount > reader.remaining() / sizeof(assets::MaterialRecord)) return false;
+    scene.materialTextures.resize(header.materialCount);
+    for (std::vector<std::string>& textures : scene.materialTextures) {
+        assets::MaterialRecord record;
+        if (!reader.read(record) || record.textureCount > reader.remaining() / sizeof(uint32_t)) return false;
+
+        textures.resize(record.textureCount);
+        for (std::string& path : textures) {
+            uint32_t length;
+            if (!reader.read(length) || !reader.readString(length, path)) return false;
+        }
+    }
+
+    if (reader.remaining() != header.meshCount * sizeof(assets::MeshInstanceRecord)) return false;
+    for (uint32_t i = 0; i < header.meshCount; i++) {
+        assets::MeshInstanceRecord record;
+        reader.read(record);
+        scene.meshMaterials.push_back(record.materialIndex);
+        scene.meshTransforms.push_back(glm::make_mat4(record.transform));
+    }
+    return true;
+}
+}
+
+assets::AssetFile AssetConverter::convertSceneToBinary(const SceneAsset& scene) {
+    assets::SceneHeader header;
+    header.nodeCount = scene.nodes.size();
+    header.materialCount = scene.materialTextures.size();
+    header.meshCount = scene.meshMaterials.size();
+
+    assets::AssetFile file;
+    memcpy(file.type, "SCEN", 4);
+    file.version = assets::ASSET_FILE_VERSION;
+
+    assets::appendMetadata(file.metadata, header);
+    for (const NodeData& node : scene.nodes) {
+        assets::NodeRecord record;
+        memcpy(record.transform, glm::value_ptr(node.originalTransform), sizeof(record.transform));
+        record.parentIndex = node.parentIndex;
+        record.nameLength = node.name.size();
+        assets::appendMetadata(file.metadata, record);
+        file.metadata += node.name;
+    }
+    for (const std::vector<std::string>& textures : scene.materialTextures) {
+        assets::MaterialRecord record;
+        record.textureCount = textures.size();
+        assets::appendMetadata(file.metadata, record);
+        for (const std::string& path : textures) {
+            assets::appendMetadata(file.metadata, static_cast<uint32_t>(path.size()));
+            file.metadata += path;
+        }
+    }
+    for (size_t i = 0; i < scene.meshMaterials.size(); i++) {
+        assets::MeshInstanceRecord record;
+        record.materialIndex = scene.meshMaterials[i];
+        memcpy(record.transform, glm::value_ptr(scene.meshTransforms[i]), sizeof(record.transform));
+        assets::appendMetadata(file.metadata, record);
+    }
+
+    return file;
+}
+
+bool AssetConverter::convertBinaryToScene(const assets::AssetFileView& file, SceneAsset& scene) const {
+    ScopedLoadTimer timer(LoadStage::HeaderParse);
+    assets::MetadataReader reader(file.metadata);
+    if (file.version < 2 || !readScene(reader, scene)) {
+        std::cout << "Scene asset has an invalid header \n";
+        scene = {};
+        return false;
+    }
+    return true;
+}
+
+assets::AssetFile AssetConverter::convertSkinToBinary(const Animation& skin) {
+    assets::SkinHeader header;
+    header.boneCount = skin.bone_info.size();
+    header.vertexCount = skin.bone_data.size();
+
+    assets::AssetFile file;
+    memcpy(file.type, "SKIN", 4);
+    file.version = assets::ASSET_FILE_VERSION;
+
+    std::vector<const std::string*> boneNames(skin.bone_info.size(), nullptr);
+    for (const auto& [name, index] : skin.boneName_To_Index) {
+        if (index < boneNames.size()) boneNames[index] = &name;
+    }
+
+    assets::appendMetadata(file.metadata, header);
+    for (size_t i = 0; i < skin.bone_info.size(); i++) {
+        assets::BoneRecord record;
+        memcpy(record.offsetTransform, glm::value_ptr(skin.bone_info[i].offsetTransform),
+               sizeof(record.offsetTransform));
+        record.nameLength = boneNames[i] != nullptr ? boneNames[i]->size() : 0;
+        assets::appendMetadata(file.metadata, record);
+        if (boneNames[i] != nullptr) file.metadata += *boneNames[i];
+    }
+
+    appendCompressedBlock(file.binaryBlob, skin.bone_data.data(), skin.bone_data.size() * sizeof(VertexBoneData));
+    return file;
+}
+
+bool AssetConverter::convertBinaryToSkin(const assets::AssetFileView& file, Animation& skin) const {
+    assets::MetadataReader reader(file.metadata);
+    assets::SkinHeader header;
+    bool validHeader = file.version >= 2 && assets::readAssetHeader(reader, header) &&
+                       header.compression == assets::AssetCompression::LZ4 &&
+                       header.boneCount <= reader.remaining() / sizeof(assets::BoneRecord);
+
+    skin.bone_info.resize(validHeader ? header.boneCount : 0);
+    for (unsigned int i = 0; i < skin.bone_info.size() && validHeader; i++) {
+        assets::BoneRecord record;
+        std::string name;
+        validHeader = reader.read(record) && reader.readString(record.nameLength, name);
+        skin.bone_info[i].offsetTransform = glm::make_mat4(record.offsetTransform);
+        skin.bone_info[i].finalTransform = glm::mat4(1.0f);
+        if (!name.empty()) skin.boneName_To_Index[name] = i;
+    }
+    if (!validHeader) {
+        std::cout << "Skin asset has an invalid header \n";
+        skin = {};
+        return false;
+    }
+
+    skin.bone_data.resize(header.vertexCount);
+    if (!decompressBlock(file.blob, skin.bone_data.data(), skin.bone_data.size() * sizeof(VertexBoneData))) {
+        std::cout << "Skin asset is corrupted \n";
+        skin = {};
+        return false;
+    }
+    return true;
+}
+
+assets::AssetFile AssetConverter::convertClipToBinary(const AnimationClip& clip) {
+    assets::ClipHeader header;
+    header.channelCount = clip.channels.size();
+    header.frameCount = clip.frameCount;
+    header.duration = clip.duration;
+    header.sampleRate = clip.sampleRate;
+    header.nameLength = clip.name.size();
+
+    assets::AssetFile file;
+    memcpy(file.type, "ANIM", 4);
+    file.version = assets::ASSET_FILE_VERSION;
+
+    assets::appendMetadata(file.metadata, header);
+    file.metadata += clip.name;
+    std::vector<TransformSample> samples;
+    samples.reserve(clip.channels.size() * clip.frameCount);
+    for (const AnimationChannel& channel : clip.channels) {
+        assets::appendMetadata(file.metadata, channel.nodeIndex);
+        samples.insert(samples.end(), channel.samples.begin(), channel.samples.end());
+    }
+
+    appendCompressedBlock(file.binaryBlob, samples.data(), samples.size() * sizeof(TransformSample));
+    return file;
+}
+
+bool AssetConverter::convertBinaryToClip(const assets::AssetFileView& file, AnimationClip& clip) const {
+    assets::MetadataReader reader(file.metadata);
+    assets::ClipHeader header;
+    if (file.version < 2 || !assets::readAssetHeader(reader, header) ||
+        header.compression != assets::AssetCompression::LZ4 || !reader.readString(header.nameLength, clip.name) ||
+        reader.remaining() != header.channelCount * sizeof(uint32_t) || header.frameCount == 0) {
+        std::cout << "Clip asset has an invalid header \n";
+        clip = {};
+        return false;
+    }
+
+    clip.duration = header.duration;
+    clip.sampleRate = header.sampleRate;
+    clip.frameCount = header.frameCount;
+    clip.channels.resize(header.channelCount);
+    for (AnimationChannel& channel : clip.channels) {
+        reader.read(channel.nodeIndex);
+    }
+
+    std::vector<TransformSample> samples(size_t(header.channelCount) * header.frameCount);
+    if (!decompressBlock(file.blob, samples.data(), samples.size() * sizeof(TransformSample))) {
+        std::cout << "Clip asset is corrupted \n";
+        clip = {};
+        return false;
+    }
+    for (size_t i = 0; i < clip.channels.size(); i++) {
+        auto first = samples.begin() + i * header.frameCount;
+        clip.channels[i].samples.assign(first, first + header.frameCount);
+    }
+    return true;
+}
+
+namespace {
+std::vector<SourceRecord> jsonToSourceRecords(const nlohmann::json& array) {
+    std::vector<SourceRecord> records;
+    for (const nlohmann::json& object : array) {
+        SourceRecord record;
+        record.path = object["path"].get<std::string>();
+        record.size = object["size"];
+        record.modifiedTime = object["time"];
+        record.hash = object["hash"];
+        record.embedded = object["embedded"];
+        records.push_back(record);
+    }
+    return records;
+}
+
+void appendSourceRecords(std::string& metadata, const std::vector<SourceRecord>& records) {
+    for (const SourceRecord& record : records) {
+        assets::SourceRecordHeader header;
+        header.size = record.size;
+        header.modifiedTime = record.modifiedTime;
+        header.hash = record.hash;
+        header.embedded = record.embedded;
+        header.pathLength = record.path.size();
+        assets::appendMetadata(metadata, header);
+        metadata += record.path;
+    }
+}
+
+bool readSourceRecords(assets::MetadataReader& reader, size_t count, std::vector<SourceRecord>& records) {
+    if (count > reader.remaining() / sizeof(assets::SourceRecordHeader)) return false;
+
+    records.resize(count);
+    for (SourceRecord& record : records) {
+        assets::SourceRecordHeader header;
+        if (!reader.read(header) || !reader.readString(header.pathLength, record.path)) return false;
+
+        record.size = header.size;
+        record.modifiedTime = header.modifiedTime;
+        record.hash = header.hash;
+        record.embedded = header.embedded != 0;
+    }
+    return true;
+}
+
+ModelAssetInfo readModelAssetInfoV1(const assets::AssetFileView& file) {
+    nlohmann::json model_metadata = nlohmann::json::parse(file.metadata);
+
+    ModelAssetInfo info;
+    info.numMeshes = model_metadata["numMeshes"];
+    info.numTexture = model_metadata["numTextures"];
+    if (model_metadata.contains("settingsHash")) {
+        info.settingsHash = model_metadata["settingsHash"];
+        info.directory = model_metadata["directory"].get<std::string>();
+        info.sources = jsonToSourceRecords(model_metadata["sources"]);
+        info.textureSources = jsonToSourceRecords(model_metadata["textureSources"]);
+    }
+
+    return info;
+}
+}
+
 assets::AssetFile AssetConverter::convertModelAssetInfoToBinary(ModelAssetInfo& assetInfo) {
-    nlohmann::json model_metadata;
-    model_metadata["numMeshes"] = assetInfo.numMeshes;
-    model_metadata["numTextures"] = assetInfo.numTexture;
+    assets::ModelInfoHeader header;
+    header.numMeshes = assetInfo.numMeshes;
+    header.numTextures = assetInfo.numTexture;
+    header.settingsHash = assetInfo.settingsHash;
+    header.directoryLength = assetInfo.directory.size();
+    header.sourceCount = assetInfo.sources.size();
+    header.textureSourceCount = assetInfo.textureSources.size();
 
     assets::AssetFile file;
     file.type[0] = 'I';
     file.type[1] = 'N';
     file.type[2] = 'F';
     file.type[3] = 'O';
+    file.version = assets::ASSET_FILE_VERSION;
 
-    file.version = 1;
-    file.json = model_metadata.dump();
+    assets::appendMetadata(file.metadata, header);
+    file.metadata += assetInfo.directory;
+    appendSourceRecords(file.metadata, assetInfo.sources);
+    appendSourceRecords(file.metadata, assetInfo.textureSources);
 
     return file;
 }
 
 ModelAssetInfo AssetConverter::convertBinaryToModelAssetInfo(const std::string& path) {
-    assets::AssetFile file;
-    assets::loadBinaryFile(path, file);
+    assets::MappedFile mapping;
+    assets::AssetFileView file;
+    if (!assets::mapBinaryFile(path, mapping, file)) {
+        std::cout << "Failed to open model asset at path: " << path << "\n";
+        return {};
+    }
+
+    return convertBinaryToModelAssetInfo(file);
+}
 
-    nlohmann::json model_metadata = nlohmann::json::parse(file.json);
+ModelAssetInfo AssetConverter::convertBinaryToModelAssetInfo(const assets::AssetFileView& file) const {
+    ScopedLoadTimer timer(LoadStage::HeaderParse);
+    if (file.version == 1) return readModelAssetInfoV1(file);
 
+    assets::MetadataReader reader(file.metadata);
+    assets::ModelInfoHeader header;
     ModelAssetInfo info;
-    info.numMeshes = model_metadata["numMeshes"];
-    info.numTexture = model_metadata["numTextures"];
+    if (!assets::readAssetHeader(reader, header) || !reader.readString(header.directoryLength, info.directory) ||
+        !readSourceRecords(reader, header.sourceCount, info.sources) ||
+        !readSourceRecords(reader, header.textureSourceCount, info.textureSources)) {
+        std::cout << "Model asset has an invalid header \n";
+        return {};
+    }
+
+    info.numMeshes = header.numMeshes;
+    info.numTexture = header.numTextures;
+    info.settingsHash = header.settingsHash;
 
     return info;
 }
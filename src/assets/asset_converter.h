@@ -5,23 +5,71 @@
 #ifndef ASSET_CONVERTER_H
 #define ASSET_CONVERTER_H
 #include "asset_file.h"
+#include "assets/animation.h"
 #include "assets/mesh.h"
 
+// Identifies the exact version of a file an asset was baked from
+struct SourceRecord {
+    std::string path;
+    uint64_t size = 0;
+    int64_t modifiedTime = 0;
+    uint64_t hash = 0;
+    // Embedded textures live inside the model file and change together with it
+    bool embedded = false;
+};
+
 struct ModelAssetInfo {
     int numMeshes = 0;
     int numTexture = 0;
+
+    uint64_t settingsHash = 0;
+    std::string directory;
+    // The model file and every file it references
+    std::vector<SourceRecord> sources;
+    // One per texture entry, in the same order
+    std::vector<SourceRecord> textureSources;
+};
+
+// Everything about a model that isn't a buffer: the node hierarchy, materials and the meshes using them
+struct SceneAsset {
+    std::vector<NodeData> nodes;
+    // Texture paths of every material, as Material::texture_paths lists them
+    std::vector<std::vector<std::string>> materialTextures;
+    // One of each per mesh
+    std::vector<uint32_t> meshMaterials;
+    std::vector<glm::mat4> meshTransforms;
 };
 
 class AssetConverter {
 public:
-     assets::AssetFile convertMeshToBinary(Mesh&mesh);
+    assets::AssetFile convertMeshToBinary(Mesh& mesh, VertexFormat format = VertexFormat::Float);
     Mesh convertBinaryToMesh(const std::string&path);
+    Mesh convertBinaryToMesh(const assets::AssetFileView& file) const;
 
     assets::AssetFile convertTextureToBinary(Texture&texture);
     Texture convertBinaryToTexture(const std::string&path);
+    // Decompresses levels [firstLevel, levels) only, Texture::firstLevel says where data starts
+    Texture convertBinaryToTexture(const assets::AssetFileView& file, int firstLevel = 0) const;
+    // A single level straight into data, which has to hold exactly that level, so it can land in mapped GPU memory.
+    // False if the file has no such level or only holds the whole chain as one block.
+    bool convertBinaryToTextureLevel(const assets::AssetFileView& file, int level, unsigned char* data,
+                                     size_t size) const;
+    // Type, path and dimensions only, without decompressing the pixels
+    Texture readTextureMetadata(const assets::AssetFileView& file) const;
+
+    assets::AssetFile convertSceneToBinary(const SceneAsset& scene);
+    bool convertBinaryToScene(const assets::AssetFileView& file, SceneAsset& scene) const;
+
+    // A mesh skin, the entry index is the index of the mesh it belongs to
+    assets::AssetFile convertSkinToBinary(const Animation& skin);
+    bool convertBinaryToSkin(const assets::AssetFileView& file, Animation& skin) const;
+
+    assets::AssetFile convertClipToBinary(const AnimationClip& clip);
+    bool convertBinaryToClip(const assets::AssetFileView& file, AnimationClip& clip) const;
 
     assets::AssetFile convertModelAssetInfoToBinary(ModelAssetInfo& assetInfo);
     ModelAssetInfo convertBinaryToModelAssetInfo(const std::string& path);
+    ModelAssetInfo convertBinaryToModelAssetInfo(const assets::AssetFileView& file) const;
 };
 
 
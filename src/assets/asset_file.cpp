@@ -3,8 +3,20 @@
 //
 
 #include "asset_file.h"
+#include <cstring>
 #include <fstream>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 bool assets::saveBinaryFile(const std::string& path, const AssetFile& file) {
     std::ofstream outputFile;
     outputFile.open(path, std::ios::binary | std::ios::out);
@@ -14,13 +26,13 @@ bool assets::saveBinaryFile(const std::string& path, const AssetFile& file) {
     const uint32_t version = file.version;
     outputFile.write((const char*) &version, sizeof(uint32_t));
 
-    const uint32_t length = file.json.size();
+    const uint32_t length = file.metadata.size();
     outputFile.write((const char*) &length, sizeof(uint32_t));
 
     const uint32_t blobSize = file.binaryBlob.size();
     outputFile.write((const char*) &blobSize, sizeof(uint32_t));
 
-    outputFile.write(file.json.c_str(), length);
+    outputFile.write(file.metadata.c_str(), length);
 
     outputFile.write(file.binaryBlob.data(), blobSize);
 
@@ -42,16 +54,152 @@ bool assets::loadBinaryFile(const std::string& path, AssetFile& file) {
     inputFile.read(file.type, 4);
     inputFile.read((char*) &file.version, sizeof(uint32_t));
 
-    uint32_t jsonLength = 0;
-    inputFile.read((char*) &jsonLength, sizeof(uint32_t));
+    uint32_t metadataLength = 0;
+    inputFile.read((char*) &metadataLength, sizeof(uint32_t));
     uint32_t blobSize = 0;
     inputFile.read((char*) &blobSize, sizeof(uint32_t));
 
-    file.json.resize(jsonLength);
-    inputFile.read(file.json.data(), jsonLength);
+    file.metadata.resize(metadataLength);
+    inputFile.read(file.metadata.data(), metadataLength);
 
     file.binaryBlob.resize(blobSize);
     inputFile.read(file.binaryBlob.data(), blobSize);
 
     return true;
 }
+
+assets::MappedFile::~MappedFile() {
+    close();
+}
+
+assets::MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+assets::MappedFile& assets::MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        std::swap(mData, other.mData);
+        std::swap(mSize, other.mSize);
+#ifdef _WIN32
+        std::swap(mFileHandle, other.mFileHandle);
+        std::swap(mMappingHandle, other.mMappingHandle);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+bool assets::MappedFile::open(const std::string& path) {
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    mFileHandle = file;
+    mMappingHandle = mapping;
+    mData = static_cast<const char*>(view);
+    mSize = static_cast<size_t>(fileSize.QuadPart);
+
+    return true;
+}
+
+void assets::MappedFile::close() {
+    if (mData != nullptr) UnmapViewOfFile(mData);
+    if (mMappingHandle != nullptr) CloseHandle(mMappingHandle);
+    if (mFileHandle != nullptr) CloseHandle(mFileHandle);
+
+    mData = nullptr;
+    mSize = 0;
+    mFileHandle = nullptr;
+    mMappingHandle = nullptr;
+}
+#else
+bool assets::MappedFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat fileInfo {};
+    if (fstat(fd, &fileInfo) != 0 || fileInfo.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, fileInfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    madvise(view, fileInfo.st_size, MADV_SEQUENTIAL);
+
+    mData = static_cast<const char*>(view);
+    mSize = static_cast<size_t>(fileInfo.st_size);
+
+    return true;
+}
+
+void assets::MappedFile::close() {
+    if (mData != nullptr) munmap(const_cast<char*>(mData), mSize);
+
+    mData = nullptr;
+    mSize = 0;
+}
+#endif
+
+bool assets::parseAssetFile(const char* data, size_t size, AssetFileView& view) {
+    constexpr size_t headerSize = 4 + 3 * sizeof(uint32_t);
+    if (data == nullptr || size < headerSize) {
+        return false;
+    }
+
+    uint32_t metadataLength = 0, blobSize = 0;
+    memcpy(view.type, data, 4);
+    memcpy(&view.version, data + 4, sizeof(uint32_t));
+    memcpy(&metadataLength, data + 8, sizeof(uint32_t));
+    memcpy(&blobSize, data + 12, sizeof(uint32_t));
+
+    if (size - headerSize < static_cast<size_t>(metadataLength) + blobSize) {
+        return false;
+    }
+
+    view.metadata = std::string_view(data + headerSize, metadataLength);
+    view.blob.data = data + headerSize + metadataLength;
+    view.blob.size = blobSize;
+
+    return true;
+}
+
+bool assets::mapBinaryFile(const std::string& path, MappedFile& mapping, AssetFileView& view) {
+    if (!mapping.open(path)) {
+        return false;
+    }
+
+    return parseAssetFile(mapping.data(), mapping.size(), view);
+}
@@ -4,18 +4,65 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace assets {
 
+// Version 1 files describe themselves with a JSON string, version 2 files with the binary headers in
+// asset_headers.h
 struct AssetFile {
     char type[4];
     int version;
-    std::string json;
+    std::string metadata;
     std::vector<char> binaryBlob;
 };
 
+struct ByteSpan {
+    const char* data = nullptr;
+    size_t size = 0;
+};
+
+// Non-owning view of an asset file that lives in memory somewhere else (usually a MappedFile).
+struct AssetFileView {
+    char type[4] = {};
+    uint32_t version = 0;
+    std::string_view metadata;
+    ByteSpan blob;
+};
+
+// Read-only memory mapping of a whole file. Views handed out from it stay valid until it is closed.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return mData; }
+    size_t size() const { return mSize; }
+
+private:
+    const char* mData = nullptr;
+    size_t mSize = 0;
+
+#ifdef _WIN32
+    void* mFileHandle = nullptr;
+    void* mMappingHandle = nullptr;
+#endif
+};
+
 bool saveBinaryFile(const std::string& path, const AssetFile& file);
 bool loadBinaryFile(const std::string& path, AssetFile& file);
-}
\ No newline at end of file
+
+bool parseAssetFile(const char* data, size_t size, AssetFileView& view);
+bool mapBinaryFile(const std::string& path, MappedFile& mapping, AssetFileView& view);
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Headers are read in place with memcpy, so the bytes on disk are just the structs below
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Asset headers are stored little endian"
+#endif
+
+namespace assets {
+
+// "AHD2"
+constexpr uint32_t ASSET_HEADER_MAGIC = 0x32444841;
+constexpr uint32_t ASSET_FILE_VERSION = 2;
+
+enum class AssetCompression : uint32_t {
+    None = 0, LZ4
+};
+
+enum class MeshVertexFormat : uint32_t {
+    PNTTB_F32 = 0, PNTT_Q16
+};
+
+#pragma pack(push, 1)
+// Followed by `lodCount` MeshLod records
+struct MeshHeader {
+    uint32_t magic = ASSET_HEADER_MAGIC;
+    uint32_t headerSize = sizeof(MeshHeader);
+    MeshVertexFormat vertexFormat = MeshVertexFormat::PNTTB_F32;
+    uint32_t indexSize = 4;
+    AssetCompression compression = AssetCompression::LZ4;
+    uint32_t lodCount = 0;
+    uint64_t vertexBufferSize = 0;
+    uint64_t indexBufferSize = 0;
+    uint64_t meshletBufferSize = 0;
+    uint32_t vertexCompressedSize = 0;
+    uint32_t indexCompressedSize = 0;
+    uint32_t meshletCompressedSize = 0;
+    float boundsMin[4] = {};
+    float boundsMax[4] = {};
+    // Texture coordinate units per mesh space unit, 0 for meshes without texture coordinates
+    float uvDensity = 0.0f;
+};
+
+// Followed by the type and path characters and the compressed size of every level as uint32_t. The blob holds one
+// LZ4 block per level, largest first.
+struct TextureHeader {
+    uint32_t magic = ASSET_HEADER_MAGIC;
+    uint32_t headerSize = sizeof(TextureHeader);
+    uint32_t format = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t nrComponents = 0;
+    uint32_t levels = 1;
+    AssetCompression compression = AssetCompression::LZ4;
+    uint64_t bufferSize = 0;
+    // computeTextureContentHash of the pixels, lets loads find an identical texture before decompressing
+    uint64_t contentHash = 0;
+    uint32_t typeLength = 0;
+    uint32_t pathLength = 0;
+};
+
+// Followed by the directory characters and then every source record
+struct ModelInfoHeader {
+    uint32_t magic = ASSET_HEADER_MAGIC;
+    uint32_t headerSize = sizeof(ModelInfoHeader);
+    uint32_t numMeshes = 0;
+    uint32_t numTextures = 0;
+    uint64_t settingsHash = 0;
+    uint32_t directoryLength = 0;
+    uint32_t sourceCount = 0;
+    uint32_t textureSourceCount = 0;
+};
+
+// Followed by nodeCount NodeRecords, materialCount MaterialRecords and meshCount MeshInstanceRecords
+struct SceneHeader {
+    uint32_t magic = ASSET_HEADER_MAGIC;
+    uint32_t headerSize = sizeof(SceneHeader);
+    uint32_t nodeCount = 0;
+    uint32_t materialCount = 0;
+    uint32_t meshCount = 0;
+};
+
+// Followed by the name characters
+struct NodeRecord {
+    float transform[16] = {};
+    int32_t parentIndex = -1;
+    uint32_t nameLength = 0;
+};
+
+// Followed by textureCount texture paths, each a uint32_t length and then its characters
+struct MaterialRecord {
+    uint32_t textureCount = 0;
+};
+
+struct MeshInstanceRecord {
+    uint32_t materialIndex = 0;
+    float transform[16] = {};
+};
+
+// Followed by boneCount BoneRecords, the blob is the compressed VertexBoneData of every vertex
+struct SkinHeader {
+    uint32_t magic = ASSET_HEADER_MAGIC;
+    uint32_t headerSize = sizeof(SkinHeader);
+    AssetCompression compression = AssetCompression::LZ4;
+    uint32_t boneCount = 0;
+    uint32_t vertexCount = 0;
+};
+
+// Followed by the name characters
+struct BoneRecord {
+    float offsetTransform[16] = {};
+    uint32_t nameLength = 0;
+};
+
+// Followed by the name characters and then the uint32_t node index of every channel. The blob is the compressed
+// samples of every channel one after the other, frameCount TransformSamples each.
+struct ClipHeader {
+    uint32_t magic = ASSET_HEADER_MAGIC;
+    uint32_t headerSize = sizeof(ClipHeader);
+    AssetCompression compression = AssetCompression::LZ4;
+    uint32_t channelCount = 0;
+    uint32_t frameCount = 0;
+    float duration = 0.0f;
+    float sampleRate = 0.0f;
+    uint32_t nameLength = 0;
+};
+
+// Followed by the path characters
+struct SourceRecordHeader {
+    uint64_t size = 0;
+    int64_t modifiedTime = 0;
+    uint64_t hash = 0;
+    uint32_t embedded = 0;
+    uint32_t pathLength = 0;
+};
+#pragma pack(pop)
+
+// Sequential reads out of a metadata block, every read fails once it would run past the end
+class MetadataReader {
+public:
+    explicit MetadataReader(std::string_view data) : data(data) {}
+
+    template <typename T>
+    bool read(T& value) {
+        if (data.size() - offset < sizeof(T)) return false;
+        memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    bool readString(size_t length, std::string& value) {
+        if (data.size() - offset < length) return false;
+        value.assign(data.data() + offset, length);
+        offset += length;
+        return true;
+    }
+
+    size_t remaining() const { return data.size() - offset; }
+
+private:
+    std::string_view data;
+    size_t offset = 0;
+};
+
+// Reads a header and checks it was written with this exact layout
+template <typename Header>
+bool readAssetHeader(MetadataReader& reader, Header& header) {
+    return reader.read(header) && header.magic == ASSET_HEADER_MAGIC && header.headerSize == sizeof(Header);
+}
+
+template <typename T>
+void appendMetadata(std::string& metadata, const T& value) {
+    metadata.append((const char*) &value, sizeof(T));
+}
+}
@@ -0,0 +1,167 @@
+#include "asset_pack.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "utils/load_profiler.h"
+
+namespace {
+constexpr size_t ASSET_FILE_HEADER_SIZE = 4 + 3 * sizeof(uint32_t);
+constexpr uint64_t ENTRY_ALIGNMENT = 16;
+
+bool isValidHeader(const assets::PackHeader& header) {
+    return memcmp(header.magic, "PACK", 4) == 0 && header.version == 1
+           && header.entrySize == sizeof(assets::PackEntry);
+}
+}
+
+void assets::PackWriter::addEntry(AssetFile file, PackEntry entry) {
+    memcpy(entry.type, file.type, 4);
+    entry.size = ASSET_FILE_HEADER_SIZE + file.metadata.size() + file.binaryBlob.size();
+
+    entries.push_back({entry, std::move(file), {}});
+}
+
+void assets::PackWriter::addRawEntry(ByteSpan bytes, PackEntry entry) {
+    entry.size = bytes.size;
+
+    entries.push_back({entry, {}, bytes});
+}
+
+bool assets::PackWriter::save(const std::string& path) const {
+    PackHeader header;
+    header.entryCount = entries.size();
+
+    std::vector<PackEntry> tableOfContents;
+    tableOfContents.reserve(entries.size());
+    uint64_t offset = sizeof(PackHeader) + sizeof(PackEntry) * entries.size();
+    for (const PendingEntry& pending : entries) {
+        PackEntry entry = pending.entry;
+        offset = (offset + ENTRY_ALIGNMENT - 1) & ~(ENTRY_ALIGNMENT - 1);
+        entry.offset = offset;
+        offset += entry.size;
+
+        tableOfContents.push_back(entry);
+    }
+
+    std::ofstream outputFile;
+    outputFile.open(path, std::ios::binary | std::ios::out);
+    if (!outputFile.is_open()) {
+        return false;
+    }
+
+    outputFile.write((const char*) &header, sizeof(PackHeader));
+    outputFile.write((const char*) tableOfContents.data(), sizeof(PackEntry) * tableOfContents.size());
+
+    const char padding[ENTRY_ALIGNMENT] = {};
+    for (size_t i = 0; i < entries.size(); i++) {
+        uint64_t position = outputFile.tellp();
+        outputFile.write(padding, tableOfContents[i].offset - position);
+
+        if (entries[i].raw.data != nullptr) {
+            outputFile.write(entries[i].raw.data, entries[i].raw.size);
+            continue;
+        }
+
+        const AssetFile& file = entries[i].file;
+        outputFile.write(file.type, 4);
+
+        const uint32_t version = file.version;
+        outputFile.write((const char*) &version, sizeof(uint32_t));
+
+        const uint32_t length = file.metadata.size();
+        outputFile.write((const char*) &length, sizeof(uint32_t));
+
+        const uint32_t blobSize = file.binaryBlob.size();
+        outputFile.write((const char*) &blobSize, sizeof(uint32_t));
+
+        outputFile.write(file.metadata.c_str(), length);
+        outputFile.write(file.binaryBlob.data(), blobSize);
+    }
+
+    return outputFile.good();
+}
+
+bool assets::PackFile::open(const std::string& path) {
+    // Only maps the pack, the pages are read in later by whatever touches them first
+    ScopedLoadTimer timer(LoadStage::FileIO);
+    entries.clear();
+    if (!mapping.open(path) || mapping.size() < sizeof(PackHeader)) {
+        return false;
+    }
+    addFileBytes(mapping.size());
+
+    PackHeader header;
+    memcpy(&header, mapping.data(), sizeof(PackHeader));
+    if (!isValidHeader(header)) {
+        return false;
+    }
+
+    size_t tableSize = sizeof(PackEntry) * header.entryCount;
+    if (mapping.size() - sizeof(PackHeader) < tableSize) {
+        return false;
+    }
+
+    entries.resize(header.entryCount);
+    memcpy(entries.data(), mapping.data() + sizeof(PackHeader), tableSize);
+
+    return true;
+}
+
+void assets::PackFile::close() {
+    mapping.close();
+    entries.clear();
+}
+
+bool assets::PackFile::getEntryView(const PackEntry& entry, AssetFileView& view) const {
+    ByteSpan bytes;
+    if (!getEntryBytes(entry, bytes)) {
+        return false;
+    }
+
+    return parseAssetFile(bytes.data, bytes.size, view);
+}
+
+bool assets::PackFile::getEntryBytes(const PackEntry& entry, ByteSpan& bytes) const {
+    if (entry.offset > mapping.size() || mapping.size() - entry.offset < entry.size) {
+        return false;
+    }
+
+    bytes.data = mapping.data() + entry.offset;
+    bytes.size = entry.size;
+    return true;
+}
+
+bool assets::PackFile::getEntryView(const PackLocation& location, AssetFileView& view) const {
+    PackEntry entry;
+    entry.offset = location.offset;
+    entry.size = location.size;
+    return getEntryView(entry, view);
+}
+
+bool assets::readPackTableOfContents(const std::string& path, std::vector<PackEntry>& entries) {
+    std::ifstream inputFile;
+    inputFile.open(path, std::ios::binary);
+    if (!inputFile.is_open()) {
+        return false;
+    }
+
+    PackHeader header;
+    inputFile.read((char*) &header, sizeof(PackHeader));
+    if (!inputFile || !isValidHeader(header)) {
+        return false;
+    }
+
+    entries.resize(header.entryCount);
+    inputFile.read((char*) entries.data(), sizeof(PackEntry) * header.entryCount);
+
+    return inputFile.good();
+}
+
+bool assets::isEntryType(const PackEntry& entry, const char* type) {
+    return memcmp(entry.type, type, 4) == 0;
+}
+
+PackLocation assets::getPackLocation(const PackEntry& entry) {
+    return {entry.offset, entry.size};
+}
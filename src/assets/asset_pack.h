@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "asset_file.h"
+#include "utils/types.h"
+
+namespace assets {
+
+enum class PackCompression : uint32_t {
+    None = 0,
+    LZ4 = 1
+};
+
+struct PackEntry {
+    char type[4] = {};
+    PackCompression compression = PackCompression::None;
+    uint32_t index = 0;
+    uint32_t reserved = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint64_t uncompressedSize = 0;
+    // Max point followed by min point, only filled in for meshes
+    float bounds[8] = {};
+};
+
+// A pack is a single file holding every asset of a model:
+// [PackHeader][PackEntry * entryCount][asset file 0][asset file 1]...
+// Each asset file is stored exactly as saveBinaryFile would write it, so the converters decode it unchanged.
+struct PackHeader {
+    char magic[4] = {'P', 'A', 'C', 'K'};
+    uint32_t version = 1;
+    uint32_t entryCount = 0;
+    uint32_t entrySize = sizeof(PackEntry);
+};
+
+static_assert(sizeof(PackHeader) == 16, "PackHeader layout changed");
+static_assert(sizeof(PackEntry) == 72, "PackEntry layout changed");
+
+class PackWriter {
+public:
+    void addEntry(AssetFile file, PackEntry entry);
+    // Copies an already encoded asset file, e.g. an unchanged entry of an older pack. The bytes must stay valid until save.
+    void addRawEntry(ByteSpan bytes, PackEntry entry);
+    bool save(const std::string& path) const;
+
+private:
+    struct PendingEntry {
+        PackEntry entry;
+        AssetFile file;
+        ByteSpan raw;
+    };
+
+    std::vector<PendingEntry> entries;
+};
+
+// Maps a whole pack so any entry can be decoded in place
+class PackFile {
+public:
+    bool open(const std::string& path);
+    void close();
+
+    const std::vector<PackEntry>& getEntries() const { return entries; }
+    bool getEntryView(const PackEntry& entry, AssetFileView& view) const;
+    bool getEntryBytes(const PackEntry& entry, ByteSpan& bytes) const;
+    // Whatever is at the location now, a rebake may have put another entry there since it was taken
+    bool getEntryView(const PackLocation& location, AssetFileView& view) const;
+
+private:
+    MappedFile mapping;
+    std::vector<PackEntry> entries;
+};
+
+// Reads only the header and table of contents, e.g. to get bounds without touching any payload
+bool readPackTableOfContents(const std::string& path, std::vector<PackEntry>& entries);
+
+bool isEntryType(const PackEntry& entry, const char* type);
+PackLocation getPackLocation(const PackEntry& entry);
+}
@@ -7,16 +7,76 @@
 #include <vector>
 #include <utils/types.h>
 
+enum class VertexFormat {
+    Float, Quantized
+};
+
+// A cluster of triangles covering a contiguous range of the mesh indices. Bounds are in mesh space.
+struct Meshlet {
+    glm::vec3 center;
+    float radius;
+    glm::vec3 aabbMin;
+    uint32_t indexOffset;
+    glm::vec3 aabbMax;
+    uint32_t indexCount;
+    // Every triangle faces away from cameras inside the cone, a cutoff of 1 means it can't be cone culled
+    glm::vec3 coneApex;
+    float coneCutoff;
+    glm::vec3 coneAxis;
+    uint32_t vertexCount;
+};
+static_assert(sizeof(Meshlet) == 80, "Meshlets are stored as is in mesh assets");
+
+// Range of the mesh indices drawn at one level of detail, level 0 is the full mesh
+struct MeshLod {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    // Mesh space distance the level can be off from the full mesh by
+    float error;
+};
+
+// Owns its geometry and its slot in the geometry pool, meshes are moved around and only ever duplicated through
+// clone
 struct Mesh {
+    Mesh() = default;
+    Mesh(Mesh&&) = default;
+    Mesh& operator=(Mesh&&) = default;
+
     std::vector<Vertex> vertices;
+    // Meshes loaded from a quantized bake only have these, dequantized with aabb in the vertex shader
+    std::vector<PackedVertex> packedVertices;
     std::vector<unsigned int> indices;
+    // Width of the indices on disk and on the GPU, the CPU copy above is always 32 bit
+    unsigned int indexSize = 4;
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshLod> lods;
+    // Level picked last frame, levels only change once past the hysteresis band
+    unsigned int currentLod = 0;
 
     size_t materialIndex;
 
     glm::mat4 model_matrix;
     BoundingBox aabb;
+    // Texture coordinate units per mesh space unit, averaged by area. Texture streaming picks levels with it.
+    float uvDensity = 0.0f;
+    // Frame the mesh was last inside the view frustum, meshes unseen for longest are evicted first
+    uint64_t lastVisibleFrame = 0;
+
+    // Invalid while the mesh isn't on the GPU
+    GeometryHandle geometry;
+    // Of the mesh's entry in the pack it was loaded from, what evicted geometry is read back from
+    PackLocation packLocation;
+
+    // Same geometry without the pool slot, which stays with this mesh
+    Mesh clone() const {
+        Mesh mesh(*this);
+        mesh.geometry = {};
+        return mesh;
+    }
 
-    AllocatedBuffer buffer;
+private:
+    Mesh(const Mesh&) = default;
+    Mesh& operator=(const Mesh&) = default;
 };
 
 #endif //MESH_H
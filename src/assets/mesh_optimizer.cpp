@@ -0,0 +1,306 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace {
+constexpr int FORSYTH_CACHE_SIZE = 32;
+// FIFO cache size the overdraw clusters are built against, close to what current GPUs behave like
+constexpr int OVERDRAW_CACHE_SIZE = 16;
+
+float getVertexScore(int cachePosition, unsigned int remainingTriangles) {
+    if (remainingTriangles == 0) return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        // The last triangle's vertices get a fixed score so the next one doesn't just reuse all three
+        score = cachePosition < 3
+                    ? 0.75f
+                    : std::pow(1.0f - (cachePosition - 3) / float(FORSYTH_CACHE_SIZE - 3), 1.5f);
+    }
+    // Vertices with few triangles left are finished off first so they can leave the cache for good
+    return score + 2.0f / std::sqrt((float) remainingTriangles);
+}
+
+// Simulated FIFO cache, a vertex is cached if it was inserted less than cacheSize misses ago
+class FifoCache {
+public:
+    FifoCache(size_t vertexCount, int cacheSize) : timestamps(vertexCount, 0), cacheSize(cacheSize),
+                                                   time(cacheSize + 1) {}
+
+    bool access(unsigned int vertex) {
+        if (time - timestamps[vertex] <= (unsigned int) cacheSize) return false;
+
+        timestamps[vertex] = time++;
+        return true;
+    }
+
+    void flush() {
+        time += cacheSize + 1;
+    }
+
+private:
+    std::vector<unsigned int> timestamps;
+    int cacheSize;
+    unsigned int time;
+};
+
+unsigned int countTriangleMisses(FifoCache& cache, const unsigned int* triangle) {
+    return (unsigned int) cache.access(triangle[0]) + cache.access(triangle[1]) + cache.access(triangle[2]);
+}
+}
+
+assets::VertexCacheStats assets::analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount,
+                                                    int cacheSize) {
+    VertexCacheStats stats;
+    if (indices.empty()) return stats;
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t misses = 0, uniqueVertices = 0;
+    for (unsigned int index : indices) {
+        misses += cache.access(index);
+        if (!referenced[index]) {
+            referenced[index] = true;
+            uniqueVertices++;
+        }
+    }
+
+    stats.acmr = (float) misses / (float) (indices.size() / 3);
+    stats.atvr = (float) misses / (float) uniqueVertices;
+    return stats;
+}
+
+void assets::optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return;
+
+    // Triangles touching each vertex, the first remainingTriangles of every range are the ones not emitted yet
+    std::vector<unsigned int> remainingTriangles(vertexCount, 0);
+    for (unsigned int index : indices) remainingTriangles[index]++;
+
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+    std::partial_sum(remainingTriangles.begin(), remainingTriangles.end(), adjacencyOffsets.begin() + 1);
+
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fillCounts(vertexCount, 0);
+    for (size_t i = 0; i < indices.size(); i++) {
+        unsigned int vertex = indices[i];
+        adjacency[adjacencyOffsets[vertex] + fillCounts[vertex]++] = i / 3;
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) vertexScores[i] = getVertexScore(-1, remainingTriangles[i]);
+
+    std::vector<float> triangleScores(triangleCount);
+    for (size_t i = 0; i < triangleCount; i++) {
+        const unsigned int* triangle = &indices[i * 3];
+        triangleScores[i] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+
+    std::vector<unsigned int> cache, nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    long bestTriangle = std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+    size_t scanPosition = 0;
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        if (bestTriangle < 0) {
+            // Nothing in the cache has triangles left, continue with the next one in source order
+            while (emitted[scanPosition]) scanPosition++;
+            bestTriangle = (long) scanPosition;
+        }
+
+        const unsigned int* triangle = &indices[bestTriangle * 3];
+        output.insert(output.end(), triangle, triangle + 3);
+        emitted[bestTriangle] = true;
+
+        for (int i = 0; i < 3; i++) {
+            unsigned int vertex = triangle[i];
+            unsigned int* begin = &adjacency[adjacencyOffsets[vertex]];
+            unsigned int* end = begin + remainingTriangles[vertex];
+            unsigned int* found = std::find(begin, end, (unsigned int) bestTriangle);
+            if (found != end) {
+                std::swap(*found, *(end - 1));
+                remainingTriangles[vertex]--;
+            }
+        }
+
+        // The new triangle's vertices move to the front, everything past the cache size gets evicted
+        nextCache.assign(triangle, triangle + 3);
+        for (unsigned int vertex : cache) {
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) nextCache.push_back(vertex);
+        }
+        for (size_t i = FORSYTH_CACHE_SIZE; i < nextCache.size(); i++) {
+            cachePositions[nextCache[i]] = -1;
+            vertexScores[nextCache[i]] = getVertexScore(-1, remainingTriangles[nextCache[i]]);
+        }
+
+        size_t cachedCount = std::min(nextCache.size(), (size_t) FORSYTH_CACHE_SIZE);
+        for (size_t i = 0; i < cachedCount; i++) {
+            cachePositions[nextCache[i]] = (int) i;
+            vertexScores[nextCache[i]] = getVertexScore((int) i, remainingTriangles[nextCache[i]]);
+        }
+
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (unsigned int vertex : nextCache) {
+            unsigned int begin = adjacencyOffsets[vertex];
+            for (unsigned int i = begin; i < begin + remainingTriangles[vertex]; i++) {
+                unsigned int candidate = adjacency[i];
+                const unsigned int* candidateTriangle = &indices[candidate * 3];
+                float score = vertexScores[candidateTriangle[0]] + vertexScores[candidateTriangle[1]]
+                              + vertexScores[candidateTriangle[2]];
+                triangleScores[candidate] = score;
+
+                if (score > bestScore) {
+                    bestScore = score;
+                    bestTriangle = candidate;
+                }
+            }
+        }
+
+        nextCache.resize(cachedCount);
+        std::swap(cache, nextCache);
+    }
+
+    indices = std::move(output);
+}
+
+void assets::optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return;
+
+    // Hard boundaries are where the optimized order already starts over with three new vertices
+    std::vector<size_t> hardClusters;
+    {
+        FifoCache cache(vertices.size(), OVERDRAW_CACHE_SIZE);
+        for (size_t i = 0; i < triangleCount; i++) {
+            if (countTriangleMisses(cache, &indices[i * 3]) == 3 || i == 0) hardClusters.push_back(i);
+        }
+    }
+    hardClusters.push_back(triangleCount);
+
+    // Soft boundaries split those further wherever the cache efficiency so far stays within the threshold
+    std::vector<size_t> clusters;
+    FifoCache cache(vertices.size(), OVERDRAW_CACHE_SIZE);
+    for (size_t c = 0; c + 1 < hardClusters.size(); c++) {
+        size_t start = hardClusters[c], end = hardClusters[c + 1];
+
+        cache.flush();
+        size_t clusterMisses = 0;
+        for (size_t i = start; i < end; i++) clusterMisses += countTriangleMisses(cache, &indices[i * 3]);
+        float clusterThreshold = threshold * (float) clusterMisses / (float) (end - start);
+
+        cache.flush();
+        clusters.push_back(start);
+        size_t runStart = start, runMisses = 0;
+        for (size_t i = start; i < end; i++) {
+            runMisses += countTriangleMisses(cache, &indices[i * 3]);
+            if (i + 1 < end && (float) runMisses / (float) (i + 1 - runStart) <= clusterThreshold) {
+                clusters.push_back(i + 1);
+                runStart = i + 1;
+                runMisses = 0;
+                cache.flush();
+            }
+        }
+    }
+    clusters.push_back(triangleCount);
+
+    // Clusters facing away from the mesh center go first, they are the most likely to occlude the rest
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    size_t clusterCount = clusters.size() - 1;
+    std::vector<glm::vec3> clusterCenters(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+    for (size_t c = 0; c < clusterCount; c++) {
+        float clusterArea = 0.0f;
+        for (size_t i = clusters[c]; i < clusters[c + 1]; i++) {
+            const glm::vec3& a = vertices[indices[i * 3]].Position;
+            const glm::vec3& b = vertices[indices[i * 3 + 1]].Position;
+            const glm::vec3& d = vertices[indices[i * 3 + 2]].Position;
+
+            glm::vec3 normal = glm::cross(b - a, d - a);
+            float area = glm::length(normal);
+            glm::vec3 center = (a + b + d) / 3.0f;
+
+            clusterCenters[c] += center * area;
+            clusterNormals[c] += normal;
+            clusterArea += area;
+        }
+
+        meshCenter += clusterCenters[c];
+        meshArea += clusterArea;
+        clusterCenters[c] = clusterArea > 0.0f ? clusterCenters[c] / clusterArea : clusterCenters[c];
+        float normalLength = glm::length(clusterNormals[c]);
+        clusterNormals[c] = normalLength > 0.0f ? clusterNormals[c] / normalLength : clusterNormals[c];
+    }
+    if (meshArea > 0.0f) meshCenter /= meshArea;
+
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) {
+        sortKeys[c] = glm::dot(clusterCenters[c] - meshCenter, clusterNormals[c]);
+    }
+
+    std::vector<size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (size_t c : order) {
+        output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+    }
+    indices = std::move(output);
+}
+
+std::vector<unsigned int> assets::optimizeVertexFetch(const std::vector<unsigned int>& indices, size_t vertexCount,
+                                                      size_t& usedVertexCount) {
+    std::vector<unsigned int> remap(vertexCount, ~0u);
+    usedVertexCount = 0;
+    for (unsigned int index : indices) {
+        if (remap[index] == ~0u) remap[index] = usedVertexCount++;
+    }
+    return remap;
+}
+
+assets::MeshOptimizationReport assets::optimizeMesh(Mesh& mesh, std::vector<VertexBoneData>& boneData,
+                                                    bool reduceOverdraw) {
+    MeshOptimizationReport report;
+    report.triangleCount = mesh.indices.size() / 3;
+    report.before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+    optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    if (reduceOverdraw) {
+        optimizeOverdraw(mesh.indices, mesh.vertices);
+    }
+
+    size_t usedVertexCount;
+    std::vector<unsigned int> remap = optimizeVertexFetch(mesh.indices, mesh.vertices.size(), usedVertexCount);
+
+    std::vector<Vertex> vertices(usedVertexCount);
+    bool hasBones = boneData.size() == mesh.vertices.size();
+    std::vector<VertexBoneData> remappedBones(hasBones ? usedVertexCount : 0);
+    for (size_t i = 0; i < remap.size(); i++) {
+        if (remap[i] == ~0u) continue;
+
+        vertices[remap[i]] = mesh.vertices[i];
+        // The ID indexes the bone data in the skinning shader, so it follows the vertex to its new slot
+        vertices[remap[i]].ID = remap[i];
+        if (hasBones) remappedBones[remap[i]] = boneData[i];
+    }
+    for (unsigned int& index : mesh.indices) index = remap[index];
+
+    mesh.vertices = std::move(vertices);
+    if (hasBones) boneData = std::move(remappedBones);
+
+    mesh.indexSize = mesh.vertices.size() < 65536 ? 2 : 4;
+    report.after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+    return report;
+}
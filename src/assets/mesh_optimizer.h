@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include "mesh.h"
+
+namespace assets {
+
+// Post-transform cache statistics for a FIFO cache of the given size
+struct VertexCacheStats {
+    // Average cache miss ratio, transformed vertices per triangle
+    float acmr = 0.0f;
+    // Average transform to vertex ratio, 1.0 means every vertex is transformed exactly once
+    float atvr = 0.0f;
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize = 16);
+
+// Forsyth's linear speed ordering, reorders whole triangles in place
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+// Sorts cache friendly clusters of triangles front to back from the outside in, the cache efficiency can get
+// worse by at most `threshold`. Expects indices already optimized for the vertex cache.
+void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+// Old to new vertex index in order of first use, unused vertices map to ~0u
+std::vector<unsigned int> optimizeVertexFetch(const std::vector<unsigned int>& indices, size_t vertexCount,
+                                              size_t& usedVertexCount);
+
+struct MeshOptimizationReport {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    size_t triangleCount = 0;
+};
+
+// Runs all three passes over a freshly imported mesh and picks the index width. The bone data, when there is
+// any, is remapped together with the vertices.
+MeshOptimizationReport optimizeMesh(Mesh& mesh, std::vector<VertexBoneData>& boneData, bool reduceOverdraw);
+}
@@ -0,0 +1,266 @@
+#include "mesh_simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <numeric>
+
+#include "mesh_optimizer.h"
+
+namespace {
+// Levels that don't remove at least this share of the previous level's triangles aren't worth a switch
+constexpr float MIN_LOD_REDUCTION = 0.8f;
+// Largest error any level can have, relative to the mesh bounds diagonal
+constexpr float MAX_LOD_RELATIVE_ERROR = 0.05f;
+
+// Symmetric 4x4 matrix measuring the summed squared distance to a set of planes
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    double a11 = 0, a12 = 0, a13 = 0;
+    double a22 = 0, a23 = 0;
+    double a33 = 0;
+
+    static Quadric fromPlane(const glm::dvec3& normal, double distance) {
+        Quadric q;
+        q.a00 = normal.x * normal.x; q.a01 = normal.x * normal.y; q.a02 = normal.x * normal.z; q.a03 = normal.x * distance;
+        q.a11 = normal.y * normal.y; q.a12 = normal.y * normal.z; q.a13 = normal.y * distance;
+        q.a22 = normal.z * normal.z; q.a23 = normal.z * distance;
+        q.a33 = distance * distance;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& other) {
+        a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+        a11 += other.a11; a12 += other.a12; a13 += other.a13;
+        a22 += other.a22; a23 += other.a23;
+        a33 += other.a33;
+        return *this;
+    }
+
+    double evaluate(const glm::vec3& point) const {
+        double x = point.x, y = point.y, z = point.z;
+        double result = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x +
+                        a11 * y * y + 2 * a12 * y * z + 2 * a13 * y +
+                        a22 * z * z + 2 * a23 * z + a33;
+        return std::max(result, 0.0);
+    }
+};
+
+struct Collapse {
+    unsigned int from;
+    unsigned int to;
+    double cost;
+};
+
+// Maps every vertex to the first one with the same `keySize` leading bytes
+std::vector<unsigned int> findDuplicates(const std::vector<Vertex>& vertices, size_t keySize) {
+    std::vector<unsigned int> order(vertices.size());
+    std::iota(order.begin(), order.end(), 0u);
+    auto compare = [&](unsigned int a, unsigned int b) {
+        int difference = memcmp(&vertices[a], &vertices[b], keySize);
+        return difference != 0 ? difference < 0 : a < b;
+    };
+    std::sort(order.begin(), order.end(), compare);
+
+    std::vector<unsigned int> remap(vertices.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        bool sameAsPrevious = i > 0 && memcmp(&vertices[order[i]], &vertices[order[i - 1]], keySize) == 0;
+        remap[order[i]] = sameAsPrevious ? remap[order[i - 1]] : order[i];
+    }
+    return remap;
+}
+
+class Simplifier {
+public:
+    Simplifier(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices)
+        : vertices(vertices), quadrics(vertices.size()), locked(vertices.size(), false) {
+        // Vertices that only differ in tangent space are welded, ones that differ in normal or UV are seams
+        static_assert(offsetof(Vertex, TexCoords) + sizeof(glm::vec2) == offsetof(Vertex, Tangent),
+                      "Wedges are keyed on the position, normal and UV bytes");
+        std::vector<unsigned int> wedges = findDuplicates(vertices, offsetof(Vertex, Tangent));
+        std::vector<unsigned int> positions = findDuplicates(vertices, sizeof(glm::vec3));
+
+        triangles.reserve(indices.size());
+        for (unsigned int index : indices) triangles.push_back(wedges[index]);
+
+        std::vector<unsigned int> firstWedge(vertices.size(), ~0u);
+        for (unsigned int vertex : triangles) {
+            unsigned int& first = firstWedge[positions[vertex]];
+            if (first == ~0u) first = vertex;
+            else if (first != vertex) locked[positions[vertex]] = true;
+        }
+
+        // Edges used by anything but exactly two triangles are on a border or non manifold
+        std::vector<std::pair<unsigned int, unsigned int>> edges;
+        for (size_t i = 0; i + 2 < triangles.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                unsigned int a = positions[triangles[i + k]], b = positions[triangles[i + (k + 1) % 3]];
+                edges.emplace_back(std::min(a, b), std::max(a, b));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        for (size_t i = 0; i < edges.size();) {
+            size_t end = i;
+            while (end < edges.size() && edges[end] == edges[i]) end++;
+            if (end - i != 2) {
+                locked[edges[i].first] = true;
+                locked[edges[i].second] = true;
+            }
+            i = end;
+        }
+        for (size_t vertex = 0; vertex < vertices.size(); vertex++) {
+            if (locked[positions[vertex]]) locked[vertex] = true;
+        }
+
+        for (size_t i = 0; i + 2 < triangles.size(); i += 3) {
+            glm::dvec3 a = vertices[triangles[i]].Position;
+            glm::dvec3 b = vertices[triangles[i + 1]].Position;
+            glm::dvec3 c = vertices[triangles[i + 2]].Position;
+            glm::dvec3 normal = glm::cross(b - a, c - a);
+            double length = glm::length(normal);
+            if (length <= 0.0) continue;
+
+            normal /= length;
+            Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, a));
+            for (int k = 0; k < 3; k++) quadrics[triangles[i + k]] += plane;
+        }
+    }
+
+    // Returns false once nothing else can be collapsed under the error limit
+    bool simplify(size_t targetIndexCount, float maxError) {
+        double maxCost = double(maxError) * maxError;
+        while (triangles.size() > targetIndexCount) {
+            size_t collapsed = collapsePass((triangles.size() - targetIndexCount) / 3, maxCost);
+            if (collapsed == 0) return false;
+        }
+        return true;
+    }
+
+    std::vector<unsigned int> triangles;
+    float error = 0.0f;
+
+private:
+    const std::vector<Vertex>& vertices;
+    std::vector<Quadric> quadrics;
+    std::vector<bool> locked;
+
+    // Collapses the cheapest edges that don't share any triangles with each other, returns how many were
+    size_t collapsePass(size_t trianglesToRemove, double maxCost) {
+        std::vector<unsigned int> offsets(vertices.size() + 1, 0);
+        for (unsigned int vertex : triangles) offsets[vertex + 1]++;
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        std::vector<unsigned int> adjacency(triangles.size());
+        std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < triangles.size(); i++) adjacency[fill[triangles[i]]++] = i / 3;
+
+        std::vector<Collapse> collapses;
+        for (size_t i = 0; i + 2 < triangles.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                unsigned int a = triangles[i + k], b = triangles[i + (k + 1) % 3];
+                if (!locked[a]) collapses.push_back({a, b, getCost(a, b)});
+                if (!locked[b]) collapses.push_back({b, a, getCost(b, a)});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+            return a.cost < b.cost;
+        });
+
+        std::vector<unsigned int> remap(vertices.size());
+        std::iota(remap.begin(), remap.end(), 0u);
+        std::vector<bool> touched(vertices.size(), false);
+        size_t collapsed = 0, removedTriangles = 0;
+        for (const Collapse& collapse : collapses) {
+            if (collapse.cost > maxCost || removedTriangles >= trianglesToRemove) break;
+            if (touched[collapse.from] || touched[collapse.to]) continue;
+            if (flipsTriangles(collapse, offsets, adjacency)) continue;
+
+            for (unsigned int j = offsets[collapse.from]; j < offsets[collapse.from + 1]; j++) {
+                const unsigned int* triangle = &triangles[adjacency[j] * 3];
+                bool sharesEdge = triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to;
+                if (sharesEdge) removedTriangles++;
+                for (int k = 0; k < 3; k++) touched[triangle[k]] = true;
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            error = std::max(error, (float) std::sqrt(collapse.cost));
+            collapsed++;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i + 2 < triangles.size(); i += 3) {
+            unsigned int a = remap[triangles[i]], b = remap[triangles[i + 1]], c = remap[triangles[i + 2]];
+            if (a == b || b == c || a == c) continue;
+            triangles[write++] = a;
+            triangles[write++] = b;
+            triangles[write++] = c;
+        }
+        triangles.resize(write);
+
+        return collapsed;
+    }
+
+    double getCost(unsigned int from, unsigned int to) const {
+        Quadric combined = quadrics[from];
+        combined += quadrics[to];
+        return combined.evaluate(vertices[to].Position);
+    }
+
+    bool flipsTriangles(const Collapse& collapse, const std::vector<unsigned int>& offsets,
+                        const std::vector<unsigned int>& adjacency) const {
+        const glm::vec3& target = vertices[collapse.to].Position;
+        for (unsigned int j = offsets[collapse.from]; j < offsets[collapse.from + 1]; j++) {
+            const unsigned int* triangle = &triangles[adjacency[j] * 3];
+            if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) continue;
+
+            glm::vec3 corners[3], moved[3];
+            for (int k = 0; k < 3; k++) {
+                corners[k] = vertices[triangle[k]].Position;
+                moved[k] = triangle[k] == collapse.from ? target : corners[k];
+            }
+            glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+            glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+            if (glm::dot(before, after) <= 0.0f) return true;
+        }
+        return false;
+    }
+};
+}
+
+std::vector<assets::SimplifiedIndices> assets::simplifyMesh(const std::vector<unsigned int>& indices,
+                                                            const std::vector<Vertex>& vertices,
+                                                            const std::vector<size_t>& targetIndexCounts,
+                                                            float maxError) {
+    std::vector<SimplifiedIndices> levels;
+    Simplifier simplifier(indices, vertices);
+    for (size_t target : targetIndexCounts) {
+        bool reachedTarget = simplifier.simplify(target, maxError);
+        levels.push_back({simplifier.triangles, simplifier.error});
+        if (!reachedTarget) break;
+    }
+    return levels;
+}
+
+void assets::generateMeshLods(Mesh& mesh) {
+    size_t baseIndexCount = mesh.indices.size();
+    mesh.lods = {{0, static_cast<uint32_t>(baseIndexCount), 0.0f}};
+    if (mesh.vertices.empty() || baseIndexCount < 3 * 64) return;
+
+    std::vector<size_t> targets;
+    for (size_t level = 1; level < MAX_MESH_LODS; level++) {
+        targets.push_back((baseIndexCount >> level) / 3 * 3);
+    }
+    float diagonal = glm::length(glm::vec3(mesh.aabb.maxPoint - mesh.aabb.minPoint));
+
+    std::vector<SimplifiedIndices> levels = simplifyMesh(mesh.indices, mesh.vertices, targets,
+                                                         diagonal * MAX_LOD_RELATIVE_ERROR);
+    for (SimplifiedIndices& level : levels) {
+        if (level.indices.empty() || level.indices.size() > mesh.lods.back().indexCount * MIN_LOD_REDUCTION) break;
+
+        optimizeVertexCache(level.indices, mesh.vertices.size());
+        mesh.lods.push_back({static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(level.indices.size()),
+                             level.error});
+        mesh.indices.insert(mesh.indices.end(), level.indices.begin(), level.indices.end());
+    }
+}
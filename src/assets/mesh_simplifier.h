@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include "mesh.h"
+
+namespace assets {
+
+constexpr size_t MAX_MESH_LODS = 4;
+
+struct SimplifiedIndices {
+    std::vector<unsigned int> indices;
+    // Mesh space distance the simplified surface can be off by
+    float error = 0.0f;
+};
+
+// Quadric error edge collapse. Every target gets its own level, each one simplified further from the previous,
+// and levels stop early once `maxError` would be exceeded. Vertices on UV or normal seams and on open borders
+// are never moved so the levels keep sharing the original vertex buffer without cracks.
+std::vector<SimplifiedIndices> simplifyMesh(const std::vector<unsigned int>& indices,
+                                            const std::vector<Vertex>& vertices,
+                                            const std::vector<size_t>& targetIndexCounts, float maxError);
+
+// Appends up to MAX_MESH_LODS - 1 simplified levels after the mesh indices and fills in `mesh.lods`, level 0
+// being the full mesh. Meshlets keep covering level 0 only.
+void generateMeshLods(Mesh& mesh);
+}
@@ -0,0 +1,119 @@
+#include "meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+// Cones whose triangles spread wider than this are too rarely culled to be worth testing
+constexpr float MIN_CONE_SPREAD = 0.1f;
+}
+
+void assets::computeMeshletBounds(Meshlet& meshlet, const std::vector<unsigned int>& indices,
+                                  const std::vector<Vertex>& vertices) {
+    glm::vec3 minPoint(std::numeric_limits<float>::max());
+    glm::vec3 maxPoint(std::numeric_limits<float>::lowest());
+    for (size_t i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; i++) {
+        const glm::vec3& position = vertices[indices[i]].Position;
+        minPoint = glm::min(minPoint, position);
+        maxPoint = glm::max(maxPoint, position);
+    }
+    meshlet.aabbMin = minPoint;
+    meshlet.aabbMax = maxPoint;
+    meshlet.center = (minPoint + maxPoint) * 0.5f;
+
+    float radius = 0.0f;
+    for (size_t i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; i++) {
+        radius = std::max(radius, glm::distance(meshlet.center, vertices[indices[i]].Position));
+    }
+    meshlet.radius = radius;
+
+    // The cone axis is the average of the face normals, degenerate triangles don't face anywhere
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec3> corners;
+    glm::vec3 axis(0.0f);
+    for (size_t i = meshlet.indexOffset; i + 2 < meshlet.indexOffset + meshlet.indexCount; i += 3) {
+        const glm::vec3& a = vertices[indices[i]].Position;
+        const glm::vec3& b = vertices[indices[i + 1]].Position;
+        const glm::vec3& c = vertices[indices[i + 2]].Position;
+
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float area = glm::length(normal);
+        if (area <= 0.0f) continue;
+
+        normals.push_back(normal / area);
+        corners.push_back(a);
+        axis += normal / area;
+    }
+
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneApex = meshlet.center;
+    meshlet.coneCutoff = 1.0f;
+
+    float axisLength = glm::length(axis);
+    if (normals.empty() || axisLength <= 0.0f) return;
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for (const glm::vec3& normal : normals) {
+        minDot = std::min(minDot, glm::dot(normal, axis));
+    }
+    meshlet.coneAxis = axis;
+    if (minDot <= MIN_CONE_SPREAD) return;
+
+    // Pushes the apex back along the axis until it's behind every triangle's plane, so the cone test done from
+    // the apex is conservative for the whole cluster
+    float maxT = 0.0f;
+    for (size_t i = 0; i < normals.size(); i++) {
+        float t = glm::dot(meshlet.center - corners[i], normals[i]) / glm::dot(axis, normals[i]);
+        maxT = std::max(maxT, t);
+    }
+    meshlet.coneApex = meshlet.center - axis * maxT;
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+std::vector<Meshlet> assets::buildMeshlets(const Mesh& mesh, size_t maxVertices, size_t maxTriangles) {
+    std::vector<Meshlet> meshlets;
+    if (mesh.indices.empty()) return meshlets;
+
+    // Vertices are marked with the meshlet that last used them instead of clearing a set per meshlet
+    std::vector<unsigned int> lastMeshlet(mesh.vertices.size(), ~0u);
+
+    Meshlet current{};
+    auto finishMeshlet = [&](size_t endIndex) {
+        current.indexCount = static_cast<uint32_t>(endIndex - current.indexOffset);
+        computeMeshletBounds(current, mesh.indices, mesh.vertices);
+        meshlets.push_back(current);
+
+        current = {};
+        current.indexOffset = static_cast<uint32_t>(endIndex);
+    };
+
+    auto countNewVertices = [&](const unsigned int* triangle, unsigned int meshletIndex) {
+        size_t count = 0;
+        for (int k = 0; k < 3; k++) {
+            bool repeated = (k > 0 && triangle[k] == triangle[0]) || (k > 1 && triangle[k] == triangle[1]);
+            if (lastMeshlet[triangle[k]] != meshletIndex && !repeated) count++;
+        }
+        return count;
+    };
+
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        const unsigned int* triangle = &mesh.indices[i];
+        unsigned int meshletIndex = static_cast<unsigned int>(meshlets.size());
+        size_t newVertices = countNewVertices(triangle, meshletIndex);
+
+        size_t triangleCount = (i - current.indexOffset) / 3;
+        if (current.vertexCount + newVertices > maxVertices || triangleCount == maxTriangles) {
+            finishMeshlet(i);
+            meshletIndex++;
+            newVertices = countNewVertices(triangle, meshletIndex);
+        }
+
+        for (int k = 0; k < 3; k++) lastMeshlet[triangle[k]] = meshletIndex;
+        current.vertexCount += static_cast<uint32_t>(newVertices);
+    }
+    finishMeshlet(mesh.indices.size() - mesh.indices.size() % 3);
+
+    return meshlets;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+
+#include "mesh.h"
+
+namespace assets {
+
+constexpr size_t MAX_MESHLET_VERTICES = 64;
+constexpr size_t MAX_MESHLET_TRIANGLES = 124;
+
+// Splits the indices into meshlets in their current order, so they should already be optimized for the vertex
+// cache for the clusters to be compact. Expects the float vertices.
+std::vector<Meshlet> buildMeshlets(const Mesh& mesh, size_t maxVertices = MAX_MESHLET_VERTICES,
+                                   size_t maxTriangles = MAX_MESHLET_TRIANGLES);
+
+// Fills in the bounding sphere, aabb and normal cone of a meshlet whose index range is already set
+void computeMeshletBounds(Meshlet& meshlet, const std::vector<unsigned int>& indices,
+                          const std::vector<Vertex>& vertices);
+}
@@ -4,22 +4,62 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
+#include <atomic>
+#include <memory_resource>
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <functional>
 
 #include "asset_converter.h"
 #include "mesh.h"
 #include "utils/material.h"
 #include "assets/animation.h"
 
+namespace assets {
+struct CachedPack;
+struct PackEntry;
+}
+
 enum FileType {
     GLTF = 0, OBJ
 };
 
+// Everything besides the source files that changes what gets baked, a different hash invalidates cached packs
+struct ImportSettings {
+    FileType type = OBJ;
+    unsigned int importerFlags = 0;
+    VertexFormat vertexFormat = VertexFormat::Quantized;
+    // Vertex cache, overdraw and fetch ordering at bake time
+    bool optimizeMeshes = true;
+    bool reduceOverdraw = true;
+    bool buildMeshlets = true;
+    bool generateLods = true;
+    // Animation clips are resampled to at least this many frames per second
+    unsigned int animationSampleRate = 30;
+
+    uint64_t hash() const;
+};
+ImportSettings makeImportSettings(FileType type);
+
+// Shared between a loading thread and whoever waits for it. Items are textures, meshes, skins and clips, the total
+// grows as the load finds out about them. Once cancelled the remaining items are skipped and nothing gets baked.
+struct LoadProgress {
+    std::atomic<bool> cancelled{false};
+    std::atomic<size_t> finishedItems{0};
+    std::atomic<size_t> totalItems{0};
+};
+
 bool textureFromMemory(void* data, unsigned int bufferSize, Texture& texture);
 bool textureFromFile(const char *path, const std::string &directory, Texture& texture, bool gamma = false);
 glm::mat4 convertToGlmMatrix(const aiMatrix4x4& aiMat);
+void mergeBounds(BoundingBox& bounds, const BoundingBox& other);
+
+class Model;
+// Drops the texture references of the model, pixels and GL textures go away with the last model using them
+void freeTextureData(Model& model);
+// Loads the cached asset of a model serially and in parallel and prints the average times
+void reportCachedLoadSpeedup(const std::string& path, FileType type, int iterations = 5);
 
 class Model {
     public:
@@ -28,31 +68,71 @@ class Model {
         std::vector<NodeData> nodes;
 
         std::vector<Material> materials_loaded;
+        // The skin of every mesh, empty for meshes without bones
         std::vector<Animation> animations;
+        std::vector<AnimationClip> clips;
 
         std::string directory;
+        // Where the model was loaded from or baked to, evicted GPU data is read back from here
+        std::string packPath;
         bool gammaCorrection;
         glm::mat4 model_matrix;
         BoundingBox aabb;
         bool shouldDraw = true;
-        int numAnimations = 0;
+        bool parallelLoading = true;
 
-        const aiScene* scene;
         AssetConverter asset_converter;
 
         Model();
-        explicit Model(std::string path, FileType type = OBJ);
+        // Owns its geometry, GL objects and texture references, so models are moved and never copied
+        Model(const Model&) = delete;
+        Model& operator=(const Model&) = delete;
+        Model(Model&&) = default;
+        Model& operator=(Model&&) = default;
+        explicit Model(std::string path, FileType type = OBJ, bool parallelLoading = true,
+                       LoadProgress* progress = nullptr);
+        // Same as above with the paths and settings given as is instead of derived from the model name
+        Model(const std::string& sourcePath, const std::string& packPath, const ImportSettings& settings,
+              bool parallelLoading = true);
+
+        // Brings the pack at packPath up to date with the source without keeping the model around, paths are
+        // used as given. Returns false if the source can't be imported or the pack can't be written.
+        static bool bake(const std::string& sourcePath, const std::string& packPath, const ImportSettings& settings);
     private:
-        void loadInfo(std::string path, FileType type);
-        void loadFromAsset(const std::string& assetFolderPath);
-        void saveToAsset(const std::string& assetFolderPath);
+        // Only alive while importing, everything drawing needs is baked
+        const aiScene* scene = nullptr;
+        // Only set during the constructor
+        LoadProgress* progress = nullptr;
 
-        void processNode(aiNode *node, const aiScene *scene, int parentIndex = -1);
-        Mesh processMesh(aiMesh *mesh, const aiScene *scene);
+        // Loads from the pack when it's valid and imports and bakes otherwise. With bakeOnly an up to date pack
+        // isn't loaded at all.
+        bool load(const std::string& sourcePath, const std::string& packPath, const ImportSettings& settings,
+                  bool bakeOnly);
+        bool loadInfo(std::string path, const ImportSettings& settings, const assets::CachedPack* cache);
+        void loadFromPack(const assets::CachedPack& cache);
+        bool saveToPack(const std::string& packPath, const ImportSettings& settings,
+                        const std::vector<std::string>& sourceFiles, assets::CachedPack* cache);
+        // Runs decode for every item, in parallel when parallelLoading is set, and reports them to progress
+        void decodeAll(size_t count, const std::function<void(size_t)>& decode) const;
+        bool isCancelled() const;
 
-    void processMaterials(const aiScene *scene);
+        void processNode(aiNode* node, std::pmr::vector<Mesh>& sceneMeshes,
+                         std::pmr::vector<Animation>& sceneAnimations, std::pmr::vector<unsigned int>& meshReferences,
+                         int parentIndex = -1);
+        // Returns the number of nodes
+        static size_t countMeshReferences(const aiNode* node, std::pmr::vector<unsigned int>& meshReferences);
+        Mesh processMesh(aiMesh *mesh, const aiScene *scene, Animation& animation) const;
 
-        void readNodeHierarchy(const aiNode* node, Mesh& mesh);
+        // One texture per distinct name, materialTextures gets the indices every material uses
+        std::vector<Texture> gatherMaterialTextures(const aiScene* scene,
+                                                    std::pmr::vector<std::pmr::vector<size_t>>& materialTextures);
+        void processMaterials(std::vector<Texture>& decodedTextures,
+                              const std::pmr::vector<std::pmr::vector<size_t>>& materialTextures);
+        bool decodeTexture(Texture& texture, const assets::CachedPack* cache) const;
+        // Shares the registered copy when there is one and decompresses and registers the texture otherwise. Only
+        // the coarse levels are decompressed, the renderer streams the rest from entry in packPath.
+        bool loadCachedTexture(const assets::AssetFileView& file, const std::string& packPath,
+                               const assets::PackEntry& entry, Texture& texture) const;
 
-        std::vector<std::string> loadMaterialTextures(aiMaterial *mat, aiTextureType type, std::string typeName);
+        void readNodeHierarchy(const aiNode* node, Mesh& mesh);
 };
\ No newline at end of file
@@ -0,0 +1,479 @@
+#include "texture_compression.h"
+#include "texture_mips.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+struct BlockPixels {
+    float values[16][4];
+};
+
+BlockPixels toFloat(const uint8_t* rgba) {
+    BlockPixels block;
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            block.values[i][c] = rgba[i * 4 + c];
+        }
+    }
+    return block;
+}
+
+// Endpoints at the extremes of the block's principal axis over the first `channels` channels
+void fitPrincipalAxis(const BlockPixels& block, int channels, float* low, float* high) {
+    float mean[4] = {};
+    for (const auto& pixel : block.values) {
+        for (int c = 0; c < channels; c++) mean[c] += pixel[c] / 16.0f;
+    }
+
+    float covariance[4][4] = {};
+    for (const auto& pixel : block.values) {
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++) {
+                covariance[a][b] += (pixel[a] - mean[a]) * (pixel[b] - mean[b]);
+            }
+        }
+    }
+
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        float length = 0.0f;
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++) next[a] += covariance[a][b] * axis[b];
+            length = std::max(length, std::abs(next[a]));
+        }
+        if (length < 1e-6f) break;
+
+        for (int a = 0; a < channels; a++) axis[a] = next[a] / length;
+    }
+
+    float minProjection = 0.0f, maxProjection = 0.0f;
+    float axisLength = 0.0f;
+    for (int c = 0; c < channels; c++) axisLength += axis[c] * axis[c];
+    if (axisLength > 1e-6f) {
+        for (const auto& pixel : block.values) {
+            float projection = 0.0f;
+            for (int c = 0; c < channels; c++) projection += (pixel[c] - mean[c]) * axis[c];
+            projection /= axisLength;
+
+            minProjection = std::min(minProjection, projection);
+            maxProjection = std::max(maxProjection, projection);
+        }
+    }
+
+    for (int c = 0; c < channels; c++) {
+        low[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+        high[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+    }
+}
+
+// Least squares endpoints for fixed per pixel weights, where a weight of 0 is `first` and 1 is `second`
+bool refitEndpoints(const BlockPixels& block, const float* weights, int channels, float* first, float* second) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = {}, bx[4] = {};
+    for (int i = 0; i < 16; i++) {
+        float a = 1.0f - weights[i];
+        float b = weights[i];
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < channels; c++) {
+            ax[c] += a * block.values[i][c];
+            bx[c] += b * block.values[i][c];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f) return false;
+
+    for (int c = 0; c < channels; c++) {
+        first[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+        second[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+uint16_t packColor565(const float* color) {
+    auto r = (uint16_t) std::lround(color[0] * 31.0f / 255.0f);
+    auto g = (uint16_t) std::lround(color[1] * 63.0f / 255.0f);
+    auto b = (uint16_t) std::lround(color[2] * 31.0f / 255.0f);
+    return (r << 11) | (g << 5) | b;
+}
+
+void unpackColor565(uint16_t packed, float* color) {
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (float) ((r << 3) | (r >> 2));
+    color[1] = (float) ((g << 2) | (g >> 4));
+    color[2] = (float) ((b << 3) | (b >> 2));
+}
+
+// Four color mode palette: index 0 and 1 are the endpoints, 2 and 3 lie at a third and two thirds
+constexpr float BC1_WEIGHTS[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+float findBC1Indices(const BlockPixels& block, uint16_t color0, uint16_t color1, uint8_t* indices) {
+    float endpoints[2][3];
+    unpackColor565(color0, endpoints[0]);
+    unpackColor565(color1, endpoints[1]);
+
+    float palette[4][3];
+    for (int i = 0; i < 4; i++) {
+        for (int c = 0; c < 3; c++) {
+            palette[i][c] = endpoints[0][c] + (endpoints[1][c] - endpoints[0][c]) * BC1_WEIGHTS[i];
+        }
+    }
+
+    float totalError = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float bestError = INFINITY;
+        for (uint8_t index = 0; index < 4; index++) {
+            float error = 0.0f;
+            for (int c = 0; c < 3; c++) {
+                float difference = block.values[i][c] - palette[index][c];
+                error += difference * difference;
+            }
+            if (error < bestError) {
+                bestError = error;
+                indices[i] = index;
+            }
+        }
+        totalError += bestError;
+    }
+    return totalError;
+}
+
+void encodeColorBlock(const BlockPixels& block, uint8_t* output) {
+    float low[4], high[4];
+    fitPrincipalAxis(block, 3, low, high);
+
+    uint16_t color0 = packColor565(high), color1 = packColor565(low);
+    uint8_t indices[16];
+    float error = findBC1Indices(block, color0, color1, indices);
+
+    float weights[16];
+    for (int i = 0; i < 16; i++) weights[i] = BC1_WEIGHTS[indices[i]];
+    if (refitEndpoints(block, weights, 3, high, low)) {
+        uint16_t refined0 = packColor565(high), refined1 = packColor565(low);
+        uint8_t refinedIndices[16];
+        if (findBC1Indices(block, refined0, refined1, refinedIndices) < error) {
+            color0 = refined0;
+            color1 = refined1;
+            memcpy(indices, refinedIndices, sizeof(indices));
+        }
+    }
+
+    // color0 > color1 selects the four color mode, swapping the endpoints mirrors the palette
+    if (color0 < color1) {
+        std::swap(color0, color1);
+        for (uint8_t& index : indices) index ^= 1;
+    }
+    else if (color0 == color1) {
+        memset(indices, 0, sizeof(indices));
+    }
+
+    uint32_t packedIndices = 0;
+    for (int i = 0; i < 16; i++) packedIndices |= (uint32_t) indices[i] << (2 * i);
+
+    memcpy(output, &color0, 2);
+    memcpy(output + 2, &color1, 2);
+    memcpy(output + 4, &packedIndices, 4);
+}
+
+void encodeSingleChannelBlock(const uint8_t* rgba, int channel, uint8_t* output) {
+    uint8_t maxValue = 0, minValue = 255;
+    for (int i = 0; i < 16; i++) {
+        maxValue = std::max(maxValue, rgba[i * 4 + channel]);
+        minValue = std::min(minValue, rgba[i * 4 + channel]);
+    }
+
+    // Eight value mode: the endpoints followed by six evenly spaced values from max to min
+    int palette[8] = {maxValue, minValue};
+    for (int i = 2; i < 8; i++) palette[i] = ((8 - i) * maxValue + (i - 1) * minValue) / 7;
+
+    uint64_t packedIndices = 0;
+    if (maxValue != minValue) {
+        for (int i = 0; i < 16; i++) {
+            int value = rgba[i * 4 + channel];
+            uint64_t bestIndex = 0;
+            for (int index = 1; index < 8; index++) {
+                if (std::abs(palette[index] - value) < std::abs(palette[bestIndex] - value)) bestIndex = index;
+            }
+            packedIndices |= bestIndex << (3 * i);
+        }
+    }
+
+    output[0] = maxValue;
+    output[1] = minValue;
+    for (int i = 0; i < 6; i++) output[2 + i] = (uint8_t) (packedIndices >> (8 * i));
+}
+
+constexpr int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct BC7Endpoint {
+    uint8_t values[4];
+    uint8_t pBit;
+};
+
+// Mode 6 stores 7 bits per channel plus a shared lowest bit per endpoint, picked to best match all channels
+BC7Endpoint quantizeBC7Endpoint(const float* color) {
+    BC7Endpoint best{};
+    float bestError = INFINITY;
+    for (uint8_t pBit = 0; pBit < 2; pBit++) {
+        BC7Endpoint candidate{};
+        candidate.pBit = pBit;
+
+        float error = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            long quantized = std::lround((color[c] - pBit) / 2.0f);
+            candidate.values[c] = (uint8_t) std::clamp(quantized, 0l, 127l);
+
+            float difference = (float) ((candidate.values[c] << 1) | pBit) - color[c];
+            error += difference * difference;
+        }
+
+        if (error < bestError) {
+            bestError = error;
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+float findBC7Indices(const BlockPixels& block, const BC7Endpoint& first, const BC7Endpoint& second, uint8_t* indices) {
+    int palette[16][4];
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            int value0 = (first.values[c] << 1) | first.pBit;
+            int value1 = (second.values[c] << 1) | second.pBit;
+            palette[i][c] = ((64 - BC7_WEIGHTS[i]) * value0 + BC7_WEIGHTS[i] * value1 + 32) >> 6;
+        }
+    }
+
+    float totalError = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float bestError = INFINITY;
+        for (uint8_t index = 0; index < 16; index++) {
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++) {
+                float difference = block.values[i][c] - palette[index][c];
+                error += difference * difference;
+            }
+            if (error < bestError) {
+                bestError = error;
+                indices[i] = index;
+            }
+        }
+        totalError += bestError;
+    }
+    return totalError;
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t* output) : output(output) {
+        memset(output, 0, 16);
+    }
+
+    void write(uint32_t value, int count) {
+        for (int i = 0; i < count; i++, position++) {
+            output[position / 8] |= ((value >> i) & 1) << (position % 8);
+        }
+    }
+
+private:
+    uint8_t* output;
+    int position = 0;
+};
+
+void loadBlock(const unsigned char* pixels, int width, int height, int nrComponents, int blockX, int blockY,
+               uint8_t* rgba) {
+    for (int y = 0; y < 4; y++) {
+        int sourceY = std::min(blockY * 4 + y, height - 1);
+        for (int x = 0; x < 4; x++) {
+            int sourceX = std::min(blockX * 4 + x, width - 1);
+            const unsigned char* source = pixels + ((size_t) sourceY * width + sourceX) * nrComponents;
+            uint8_t* destination = rgba + (y * 4 + x) * 4;
+
+            if (nrComponents >= 3) {
+                destination[0] = source[0];
+                destination[1] = source[1];
+                destination[2] = source[2];
+                destination[3] = nrComponents == 4 ? source[3] : 255;
+            }
+            else {
+                destination[0] = destination[1] = destination[2] = source[0];
+                destination[3] = nrComponents == 2 ? source[1] : 255;
+            }
+        }
+    }
+}
+
+bool hasTransparency(const Texture& texture) {
+    if (texture.nrComponents != 2 && texture.nrComponents != 4) return false;
+
+    size_t pixelCount = (size_t) texture.width * texture.height;
+    for (size_t i = 0; i < pixelCount; i++) {
+        if (texture.data[i * texture.nrComponents + texture.nrComponents - 1] != 255) return true;
+    }
+    return false;
+}
+}
+
+TextureFormat assets::chooseTextureFormat(const Texture& texture) {
+    if (texture.type == "texture_normal") {
+        return TextureFormat::BC5;
+    }
+
+    bool isMask = texture.type == "texture_ao" || texture.type == "texture_roughness"
+                  || texture.type == "texture_metallic";
+    if (isMask) {
+        // glTF packs metalness and roughness into different channels of one texture, so only true
+        // single channel masks can drop to BC4
+        return texture.nrComponents == 1 ? TextureFormat::BC4 : TextureFormat::BC7;
+    }
+
+    bool transparent = hasTransparency(texture);
+    if (texture.type == "texture_diffuse") {
+        return transparent ? TextureFormat::BC7 : TextureFormat::BC1;
+    }
+    return transparent ? TextureFormat::BC3 : TextureFormat::BC1;
+}
+
+const char* assets::getTextureFormatName(TextureFormat format) {
+    switch (format) {
+        case TextureFormat::BC1: return "BC1";
+        case TextureFormat::BC3: return "BC3";
+        case TextureFormat::BC4: return "BC4";
+        case TextureFormat::BC5: return "BC5";
+        case TextureFormat::BC7: return "BC7";
+        default: return "RGBA8";
+    }
+}
+
+TextureFormat assets::getTextureFormatFromName(const std::string& name) {
+    for (TextureFormat format : {TextureFormat::BC1, TextureFormat::BC3, TextureFormat::BC4,
+                                 TextureFormat::BC5, TextureFormat::BC7}) {
+        if (name == getTextureFormatName(format)) return format;
+    }
+    return TextureFormat::Uncompressed;
+}
+
+std::vector<unsigned char> assets::compressTexture(const unsigned char* pixels, int width, int height,
+                                                   int nrComponents, TextureFormat format) {
+    if (format == TextureFormat::Uncompressed) return {};
+    std::vector<unsigned char> blocks(getTextureDataSize(format, width, height, nrComponents));
+
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+    size_t blockSize = getTextureDataSize(format, 4, 4, nrComponents);
+    uint8_t rgba[64];
+    for (int blockY = 0; blockY < blocksY; blockY++) {
+        for (int blockX = 0; blockX < blocksX; blockX++) {
+            loadBlock(pixels, width, height, nrComponents, blockX, blockY, rgba);
+            uint8_t* output = blocks.data() + ((size_t) blockY * blocksX + blockX) * blockSize;
+
+            switch (format) {
+                case TextureFormat::BC1: encodeBC1Block(rgba, output); break;
+                case TextureFormat::BC3: encodeBC3Block(rgba, output); break;
+                case TextureFormat::BC4: encodeBC4Block(rgba, 0, output); break;
+                case TextureFormat::BC5: encodeBC5Block(rgba, output); break;
+                case TextureFormat::BC7: encodeBC7Block(rgba, output); break;
+                default: break;
+            }
+        }
+    }
+
+    return blocks;
+}
+
+bool assets::compressTexture(Texture& texture) {
+    if (texture.format != TextureFormat::Uncompressed || texture.data == nullptr) return false;
+
+    TextureFormat format = chooseTextureFormat(texture);
+    std::vector<std::vector<unsigned char>> mipChain = generateMipChain(texture.data, texture.width, texture.height,
+                                                                        texture.nrComponents, getMipFilter(texture));
+
+    std::vector<unsigned char> blocks;
+    int levelWidth = texture.width, levelHeight = texture.height;
+    for (const std::vector<unsigned char>& level : mipChain) {
+        std::vector<unsigned char> levelBlocks = compressTexture(level.data(), levelWidth, levelHeight,
+                                                                 texture.nrComponents, format);
+        blocks.insert(blocks.end(), levelBlocks.begin(), levelBlocks.end());
+
+        levelWidth = std::max(levelWidth / 2, 1);
+        levelHeight = std::max(levelHeight / 2, 1);
+    }
+
+    // Allocated with malloc like every other texture buffer so the renderer can free them the same way
+    auto* data = (unsigned char*) malloc(blocks.size());
+    if (data == nullptr) return false;
+    memcpy(data, blocks.data(), blocks.size());
+
+    free(texture.data);
+    texture.data = data;
+    texture.dataSize = blocks.size();
+    texture.format = format;
+    texture.levels = mipChain.size();
+    return true;
+}
+
+void assets::encodeBC1Block(const uint8_t* rgba, uint8_t* output) {
+    encodeColorBlock(toFloat(rgba), output);
+}
+
+void assets::encodeBC3Block(const uint8_t* rgba, uint8_t* output) {
+    encodeSingleChannelBlock(rgba, 3, output);
+    encodeColorBlock(toFloat(rgba), output + 8);
+}
+
+void assets::encodeBC4Block(const uint8_t* rgba, int channel, uint8_t* output) {
+    encodeSingleChannelBlock(rgba, channel, output);
+}
+
+void assets::encodeBC5Block(const uint8_t* rgba, uint8_t* output) {
+    encodeSingleChannelBlock(rgba, 0, output);
+    encodeSingleChannelBlock(rgba, 1, output + 8);
+}
+
+void assets::encodeBC7Block(const uint8_t* rgba, uint8_t* output) {
+    BlockPixels block = toFloat(rgba);
+
+    float low[4], high[4];
+    fitPrincipalAxis(block, 4, low, high);
+
+    BC7Endpoint first = quantizeBC7Endpoint(low), second = quantizeBC7Endpoint(high);
+    uint8_t indices[16];
+    float error = findBC7Indices(block, first, second, indices);
+
+    float weights[16];
+    for (int i = 0; i < 16; i++) weights[i] = BC7_WEIGHTS[indices[i]] / 64.0f;
+    if (refitEndpoints(block, weights, 4, low, high)) {
+        BC7Endpoint refinedFirst = quantizeBC7Endpoint(low), refinedSecond = quantizeBC7Endpoint(high);
+        uint8_t refinedIndices[16];
+        if (findBC7Indices(block, refinedFirst, refinedSecond, refinedIndices) < error) {
+            first = refinedFirst;
+            second = refinedSecond;
+            memcpy(indices, refinedIndices, sizeof(indices));
+        }
+    }
+
+    // The first index is stored with an implicit zero top bit
+    if (indices[0] & 8) {
+        std::swap(first, second);
+        for (uint8_t& index : indices) index = 15 - index;
+    }
+
+    BitWriter writer(output);
+    writer.write(1 << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        writer.write(first.values[c], 7);
+        writer.write(second.values[c], 7);
+    }
+    writer.write(first.pBit, 1);
+    writer.write(second.pBit, 1);
+
+    writer.write(indices[0], 3);
+    for (int i = 1; i < 16; i++) writer.write(indices[i], 4);
+}
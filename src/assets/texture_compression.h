@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "utils/types.h"
+
+namespace assets {
+
+// BC5 for normal maps, BC4 for single channel masks, BC7 for packed masks and diffuse with alpha, BC1/BC3 otherwise
+TextureFormat chooseTextureFormat(const Texture& texture);
+
+const char* getTextureFormatName(TextureFormat format);
+TextureFormat getTextureFormatFromName(const std::string& name);
+
+// Encodes tightly packed 8 bit pixels with 1 to 4 channels, edge blocks repeat the last row and column
+std::vector<unsigned char> compressTexture(const unsigned char* pixels, int width, int height, int nrComponents,
+                                           TextureFormat format);
+// Replaces the pixels of an uncompressed texture with its whole mip chain, block compressed in the format picked for it
+bool compressTexture(Texture& texture);
+
+// Single 4x4 blocks, the input is always 16 RGBA pixels
+void encodeBC1Block(const uint8_t* rgba, uint8_t* output);
+void encodeBC3Block(const uint8_t* rgba, uint8_t* output);
+void encodeBC4Block(const uint8_t* rgba, int channel, uint8_t* output);
+void encodeBC5Block(const uint8_t* rgba, uint8_t* output);
+void encodeBC7Block(const uint8_t* rgba, uint8_t* output);
+}
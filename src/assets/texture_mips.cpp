@@ -0,0 +1,164 @@
+#include "texture_mips.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+float srgbToLinear(float value) {
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float linearToSrgb(float value) {
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+const float* getSrgbToLinearTable() {
+    static const std::vector<float> table = [] {
+        std::vector<float> values(256);
+        for (int i = 0; i < 256; i++) values[i] = srgbToLinear(i / 255.0f);
+        return values;
+    }();
+    return table.data();
+}
+
+// Alpha (the last channel of 2 and 4 channel textures) is always filtered as plain linear data
+int getColorChannels(int nrComponents) {
+    return nrComponents == 2 || nrComponents == 4 ? nrComponents - 1 : nrComponents;
+}
+
+std::vector<float> decodeLevel(const unsigned char* pixels, size_t pixelCount, int nrComponents, assets::MipFilter filter) {
+    const float* srgbTable = getSrgbToLinearTable();
+    int colorChannels = getColorChannels(nrComponents);
+
+    std::vector<float> values(pixelCount * nrComponents);
+    for (size_t i = 0; i < pixelCount; i++) {
+        for (int c = 0; c < nrComponents; c++) {
+            unsigned char value = pixels[i * nrComponents + c];
+            bool isColor = c < colorChannels;
+
+            if (filter == assets::MipFilter::SRGB && isColor) {
+                values[i * nrComponents + c] = srgbTable[value];
+            }
+            else if (filter == assets::MipFilter::Normal && isColor) {
+                values[i * nrComponents + c] = value / 127.5f - 1.0f;
+            }
+            else {
+                values[i * nrComponents + c] = value / 255.0f;
+            }
+        }
+    }
+    return values;
+}
+
+std::vector<unsigned char> encodeLevel(const std::vector<float>& values, int nrComponents, assets::MipFilter filter) {
+    int colorChannels = getColorChannels(nrComponents);
+
+    std::vector<unsigned char> pixels(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+        float value = values[i];
+        bool isColor = (int) (i % nrComponents) < colorChannels;
+
+        if (filter == assets::MipFilter::SRGB && isColor) {
+            value = linearToSrgb(value);
+        }
+        else if (filter == assets::MipFilter::Normal && isColor) {
+            value = value * 0.5f + 0.5f;
+        }
+        pixels[i] = (unsigned char) std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+    }
+    return pixels;
+}
+
+// Plain loops over contiguous channels so the compiler can vectorize them
+std::vector<float> downsample(const std::vector<float>& source, int width, int height, int nrComponents,
+                              int nextWidth, int nextHeight, assets::MipFilter filter) {
+    std::vector<float> destination((size_t) nextWidth * nextHeight * nrComponents);
+    for (int y = 0; y < nextHeight; y++) {
+        const float* row0 = source.data() + (size_t) std::min(2 * y, height - 1) * width * nrComponents;
+        const float* row1 = source.data() + (size_t) std::min(2 * y + 1, height - 1) * width * nrComponents;
+        float* output = destination.data() + (size_t) y * nextWidth * nrComponents;
+
+        for (int x = 0; x < nextWidth; x++) {
+            int x0 = std::min(2 * x, width - 1) * nrComponents;
+            int x1 = std::min(2 * x + 1, width - 1) * nrComponents;
+            for (int c = 0; c < nrComponents; c++) {
+                output[x * nrComponents + c] = 0.25f * (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]);
+            }
+        }
+    }
+
+    if (filter == assets::MipFilter::Normal && nrComponents >= 3) {
+        for (size_t i = 0; i < destination.size(); i += nrComponents) {
+            float* normal = destination.data() + i;
+            float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            if (length > 1e-6f) {
+                normal[0] /= length;
+                normal[1] /= length;
+                normal[2] /= length;
+            }
+        }
+    }
+
+    return destination;
+}
+}
+
+assets::MipFilter assets::getMipFilter(const Texture& texture) {
+    if (texture.type == "texture_normal" && texture.nrComponents >= 3) return MipFilter::Normal;
+    if (texture.type == "texture_diffuse") return MipFilter::SRGB;
+    return MipFilter::Linear;
+}
+
+int assets::getMipLevelCount(int width, int height) {
+    int levels = 1;
+    while (width > 1 || height > 1) {
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+        levels++;
+    }
+    return levels;
+}
+
+size_t assets::getMipRangeSize(const Texture& texture, int firstLevel, int lastLevel) {
+    size_t size = 0;
+    for (int level = firstLevel; level < lastLevel; level++) {
+        size += getTextureDataSize(texture.format, std::max(texture.width >> level, 1),
+                                   std::max(texture.height >> level, 1), texture.nrComponents);
+    }
+    return size;
+}
+
+bool assets::canStreamTexture(const Texture& texture) {
+    return texture.format != TextureFormat::Uncompressed && texture.levels > 1 && !texture.streamSource.empty();
+}
+
+int assets::getStreamingBaseLevel(const Texture& texture) {
+    if (!canStreamTexture(texture)) return 0;
+
+    int level = 0;
+    while (level < texture.levels - 1 && std::max(texture.width, texture.height) >> level > STREAMING_BASE_SIZE) {
+        level++;
+    }
+    return level;
+}
+
+std::vector<std::vector<unsigned char>> assets::generateMipChain(const unsigned char* pixels, int width, int height,
+                                                                 int nrComponents, MipFilter filter) {
+    std::vector<std::vector<unsigned char>> levels;
+    levels.emplace_back(pixels, pixels + (size_t) width * height * nrComponents);
+
+    // Every level is filtered from the full precision one above it, not from its 8 bit copy
+    std::vector<float> values = decodeLevel(pixels, (size_t) width * height, nrComponents, filter);
+    while (width > 1 || height > 1) {
+        int nextWidth = std::max(width / 2, 1);
+        int nextHeight = std::max(height / 2, 1);
+
+        values = downsample(values, width, height, nrComponents, nextWidth, nextHeight, filter);
+        levels.push_back(encodeLevel(values, nrComponents, filter));
+
+        width = nextWidth;
+        height = nextHeight;
+    }
+
+    return levels;
+}
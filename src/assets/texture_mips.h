@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include "utils/types.h"
+
+namespace assets {
+
+enum class MipFilter {
+    Linear,
+    // Colour data is averaged in linear space and re-encoded, so mips don't darken
+    SRGB,
+    // Decoded to [-1, 1], averaged and renormalized
+    Normal
+};
+
+MipFilter getMipFilter(const Texture& texture);
+int getMipLevelCount(int width, int height);
+// Bytes of levels [firstLevel, lastLevel) of a texture
+size_t getMipRangeSize(const Texture& texture, int firstLevel, int lastLevel);
+
+// Levels at most this many texels wide are loaded with the model, finer ones are streamed in on demand
+constexpr int STREAMING_BASE_SIZE = 128;
+// Block compressed textures with a mip chain and a pack to stream it from
+bool canStreamTexture(const Texture& texture);
+// Finest level loaded up front, 0 for textures that don't stream
+int getStreamingBaseLevel(const Texture& texture);
+
+// 2x2 box filtered chain down to 1x1, level 0 included. Odd sizes repeat their last row and column.
+std::vector<std::vector<unsigned char>> generateMipChain(const unsigned char* pixels, int width, int height,
+                                                         int nrComponents, MipFilter filter);
+}
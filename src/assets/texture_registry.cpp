@@ -0,0 +1,126 @@
+#include "texture_registry.h"
+
+#include <cstdlib>
+
+#include "utils/hash.h"
+
+namespace {
+constexpr unsigned int NO_TEXTURE = -1;
+}
+
+uint64_t assets::computeTextureContentHash(const Texture& texture) {
+    uint64_t hash = hashBytes(texture.data, texture.dataSize);
+    hash = hashCombine(hash, texture.width);
+    hash = hashCombine(hash, texture.height);
+    hash = hashCombine(hash, texture.nrComponents);
+    hash = hashCombine(hash, texture.levels);
+    // 0 marks textures that aren't registered
+    return hash != 0 ? hash : 1;
+}
+
+assets::TextureKey assets::getTextureKey(const Texture& texture) {
+    return {texture.contentHash, texture.format};
+}
+
+size_t assets::TextureKeyHash::operator()(const TextureKey& key) const {
+    return hashCombine(key.contentHash, static_cast<uint64_t>(key.format));
+}
+
+bool assets::TextureRegistry::acquire(const TextureKey& key, Texture& texture) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto iterator = entries.find(key);
+    if (iterator == entries.end()) return false;
+
+    Entry& entry = iterator->second;
+    entry.references++;
+
+    std::string type = std::move(texture.type);
+    std::string path = std::move(texture.path);
+    texture = entry.texture;
+    texture.data = nullptr;
+    texture.type = std::move(type);
+    texture.path = std::move(path);
+    return true;
+}
+
+void assets::TextureRegistry::add(Texture& texture) {
+    if (texture.contentHash == 0) texture.contentHash = computeTextureContentHash(texture);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = entries[getTextureKey(texture)];
+    if (entry.references++ == 0) {
+        entry.texture = texture;
+        texture.data = nullptr;
+        return;
+    }
+
+    // Loaded twice at the same time, or the same image under another name
+    if (entry.texture.data != texture.data) free(texture.data);
+    texture.data = nullptr;
+    texture.id = entry.texture.id;
+}
+
+void assets::TextureRegistry::release(const TextureKey& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto iterator = entries.find(key);
+    if (iterator == entries.end() || --iterator->second.references > 0) return;
+
+    Texture& texture = iterator->second.texture;
+    free(texture.data);
+    if (texture.id != NO_TEXTURE) unusedTextureIds.push_back(texture.id);
+    entries.erase(iterator);
+}
+
+Texture assets::TextureRegistry::find(const TextureKey& key) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto iterator = entries.find(key);
+    if (iterator == entries.end()) return {};
+
+    Texture texture = iterator->second.texture;
+    texture.data = nullptr;
+    return texture;
+}
+
+bool assets::TextureRegistry::withPixels(const TextureKey& key, const std::function<void(const Texture&)>& use) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto iterator = entries.find(key);
+    if (iterator == entries.end() || iterator->second.texture.data == nullptr) return false;
+
+    use(iterator->second.texture);
+    return true;
+}
+
+void assets::TextureRegistry::setUploaded(const TextureKey& key, unsigned int id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto iterator = entries.find(key);
+    if (iterator == entries.end()) return;
+
+    Texture& texture = iterator->second.texture;
+    texture.id = id;
+    free(texture.data);
+    texture.data = nullptr;
+}
+
+std::vector<unsigned int> assets::TextureRegistry::takeUnusedTextureIds() {
+    std::vector<unsigned int> textureIds;
+    std::lock_guard<std::mutex> lock(mutex);
+    textureIds.swap(unusedTextureIds);
+    return textureIds;
+}
+
+assets::TextureRegistryStats assets::TextureRegistry::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    TextureRegistryStats stats;
+    for (const auto& [key, entry] : entries) {
+        stats.textures++;
+        stats.references += entry.references;
+        stats.bytes += entry.texture.dataSize;
+        stats.sharedBytes += entry.texture.dataSize * (entry.references - 1);
+    }
+    return stats;
+}
+
+assets::TextureRegistry& assets::TextureRegistry::shared() {
+    static TextureRegistry registry;
+    return registry;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/types.h"
+
+namespace assets {
+
+// Hash of the pixels and their dimensions, the same image baked by any model hashes the same. Never 0.
+uint64_t computeTextureContentHash(const Texture& texture);
+
+struct TextureKey {
+    uint64_t contentHash = 0;
+    TextureFormat format = TextureFormat::Uncompressed;
+
+    bool operator==(const TextureKey& other) const {
+        return contentHash == other.contentHash && format == other.format;
+    }
+};
+TextureKey getTextureKey(const Texture& texture);
+
+struct TextureKeyHash {
+    size_t operator()(const TextureKey& key) const;
+};
+
+struct TextureRegistryStats {
+    size_t textures = 0;
+    size_t references = 0;
+    // Size of every unique texture, and what the extra references would have cost without sharing
+    size_t bytes = 0;
+    size_t sharedBytes = 0;
+};
+
+// Process-wide textures keyed by content and format. Every texture a model holds is one reference, so identical
+// textures are decoded, kept and uploaded once however many models and materials use them. Texture::contentHash
+// is only set on textures holding a reference. The registry is the only owner of the pixels: nothing outside it
+// ever points at them, they're only read through withPixels and may be freed by setUploaded or release between
+// two calls.
+class TextureRegistry {
+public:
+    // Adds a reference to an existing entry and copies all of it but the pixels into texture, type and path stay
+    bool acquire(const TextureKey& key, Texture& texture);
+    // Takes over the pixels of a freshly decoded texture, texture.data is null afterwards. When an identical texture
+    // is already registered the new pixels are freed and texture takes the existing one's GL texture instead.
+    void add(Texture& texture);
+    void release(const TextureKey& key);
+
+    // The registry copy without its pixels, an empty texture when there's no entry
+    Texture find(const TextureKey& key) const;
+    // Calls use with the registry copy, pixels included, while holding the lock, so nothing can free them in the
+    // meantime. use must neither keep the pointer nor call back into the registry. False without calling use when
+    // there's no entry or its pixels are gone, as they are once it's uploaded.
+    bool withPixels(const TextureKey& key, const std::function<void(const Texture&)>& use) const;
+    // Uploaded textures drop their pixels, later acquires only get the GL texture
+    void setUploaded(const TextureKey& key, unsigned int id);
+    // GL textures whose last reference went away. The registry never calls GL, the renderer deletes them.
+    std::vector<unsigned int> takeUnusedTextureIds();
+
+    TextureRegistryStats getStats() const;
+
+    static TextureRegistry& shared();
+
+private:
+    struct Entry {
+        Texture texture;
+        size_t references = 0;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<TextureKey, Entry, TextureKeyHash> entries;
+    std::vector<unsigned int> unusedTextureIds;
+};
+}
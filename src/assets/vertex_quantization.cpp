@@ -0,0 +1,101 @@
+#include "vertex_quantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/packing.hpp>
+
+namespace {
+int16_t toSnorm16(float value) {
+    return (int16_t) std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+float fromSnorm16(int16_t value) {
+    return std::max(value / 32767.0f, -1.0f);
+}
+
+glm::vec2 signNotZero(const glm::vec2& value) {
+    return {value.x >= 0.0f ? 1.0f : -1.0f, value.y >= 0.0f ? 1.0f : -1.0f};
+}
+
+glm::vec3 getBoundsExtent(const BoundingBox& bounds) {
+    return glm::vec3(bounds.maxPoint) - glm::vec3(bounds.minPoint);
+}
+}
+
+glm::vec2 assets::encodeOctahedral(const glm::vec3& direction) {
+    float length = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    if (length < 1e-12f) return glm::vec2(0.0f);
+
+    glm::vec3 projected = direction / length;
+    glm::vec2 encoded(projected.x, projected.y);
+    if (projected.z < 0.0f) {
+        encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * signNotZero(encoded);
+    }
+    return encoded;
+}
+
+glm::vec3 assets::decodeOctahedral(const glm::vec2& encoded) {
+    glm::vec3 direction(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+    if (direction.z < 0.0f) {
+        glm::vec2 folded = (1.0f - glm::abs(glm::vec2(direction.y, direction.x))) * signNotZero(encoded);
+        direction.x = folded.x;
+        direction.y = folded.y;
+    }
+    return glm::normalize(direction);
+}
+
+PackedVertex assets::packVertex(const Vertex& vertex, const BoundingBox& bounds) {
+    glm::vec3 extent = getBoundsExtent(bounds);
+    glm::vec3 minPoint(bounds.minPoint);
+
+    PackedVertex packed{};
+    for (int i = 0; i < 3; i++) {
+        float normalized = extent[i] > 0.0f ? (vertex.Position[i] - minPoint[i]) / extent[i] : 0.0f;
+        packed.position[i] = (uint16_t) std::lround(std::clamp(normalized, 0.0f, 1.0f) * 65535.0f);
+    }
+
+    // Only the handedness of the bitangent is kept, the shader rebuilds it from the normal and tangent
+    float handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent);
+    packed.position[3] = handedness < 0.0f ? 0 : 65535;
+
+    glm::vec2 normal = encodeOctahedral(vertex.Normal);
+    glm::vec2 tangent = encodeOctahedral(vertex.Tangent);
+    packed.normal[0] = toSnorm16(normal.x);
+    packed.normal[1] = toSnorm16(normal.y);
+    packed.tangent[0] = toSnorm16(tangent.x);
+    packed.tangent[1] = toSnorm16(tangent.y);
+
+    packed.texCoords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+    packed.texCoords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+    packed.ID = vertex.ID;
+
+    return packed;
+}
+
+Vertex assets::unpackVertex(const PackedVertex& vertex, const BoundingBox& bounds) {
+    glm::vec3 extent = getBoundsExtent(bounds);
+    glm::vec3 minPoint(bounds.minPoint);
+
+    Vertex unpacked{};
+    for (int i = 0; i < 3; i++) {
+        unpacked.Position[i] = minPoint[i] + vertex.position[i] / 65535.0f * extent[i];
+    }
+
+    unpacked.Normal = decodeOctahedral(glm::vec2(fromSnorm16(vertex.normal[0]), fromSnorm16(vertex.normal[1])));
+    unpacked.Tangent = decodeOctahedral(glm::vec2(fromSnorm16(vertex.tangent[0]), fromSnorm16(vertex.tangent[1])));
+    float handedness = vertex.position[3] == 0 ? -1.0f : 1.0f;
+    unpacked.Bitangent = glm::cross(unpacked.Normal, unpacked.Tangent) * handedness;
+
+    unpacked.TexCoords = glm::vec2(glm::unpackHalf1x16(vertex.texCoords[0]), glm::unpackHalf1x16(vertex.texCoords[1]));
+    unpacked.ID = vertex.ID;
+
+    return unpacked;
+}
+
+std::vector<PackedVertex> assets::packVertices(const std::vector<Vertex>& vertices, const BoundingBox& bounds) {
+    std::vector<PackedVertex> packed(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        packed[i] = packVertex(vertices[i], bounds);
+    }
+    return packed;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+
+#include "utils/types.h"
+
+namespace assets {
+
+glm::vec2 encodeOctahedral(const glm::vec3& direction);
+glm::vec3 decodeOctahedral(const glm::vec2& encoded);
+
+PackedVertex packVertex(const Vertex& vertex, const BoundingBox& bounds);
+Vertex unpackVertex(const PackedVertex& vertex, const BoundingBox& bounds);
+std::vector<PackedVertex> packVertices(const std::vector<Vertex>& vertices, const BoundingBox& bounds);
+}
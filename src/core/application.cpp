@@ -51,6 +51,7 @@ void Application::init()
     gladLoadGLLoader(SDL_GL_GetProcAddress);
     SDL_GL_SetSwapInterval(1);
 
+    bool hasBindlessTextures = false;
     GLint numExtensions = 0;
     glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
     for (int i = 0; i < numExtensions; i++) {
@@ -58,6 +59,7 @@ void Application::init()
         std::cout << extension << "\n";
         if (extension == "GL_ARB_bindless_texture") {
             std::cout << "Bindless Textures supported" << "\n";
+            hasBindlessTextures = true;
             break;
         }
     }
@@ -82,20 +84,19 @@ void Application::init()
 
     mRenderer.camera = &camera;
 
+    mRenderer.materialTable.init(hasBindlessTextures);
     mRenderer.init_resources();
     mRenderer.subscribePrograms(updateListener);
 
-    Model newModel("sponzaBasic/glTF/Sponza.gltf", GLTF);
     auto model = glm::mat4(1.0f);
     model = glm::scale(model, glm::vec3(0.1f));
-    newModel.model_matrix = model;
-    mRenderer.loadModelData(newModel);
-    usableObjs.push_back(newModel);
+    modelLoader.load("sponzaBasic/glTF/Sponza.gltf", GLTF, model);
 
     mRenderer.handleObjs(usableObjs);
 
     mEditor.renderer = &mRenderer;
     mEditor.objs = &usableObjs;
+    mEditor.loader = &modelLoader;
 
     std::string path = "../../shaders/default";
     fileWatcher.addWatch(path, &updateListener, true);
@@ -197,20 +198,17 @@ void Application::handleEvents()
 
 void Application::handleImportedObjs()
 {
-    if (!importedObjs.empty()) {
-        Model model = importedObjs[importedObjs.size() - 1];
-        mRenderer.loadModelData(model);
+    size_t modelCount = usableObjs.size();
+    modelLoader.update(mRenderer, usableObjs);
 
-        importedObjs.pop_back();
-        usableObjs.push_back(model);
+    if (usableObjs.size() != modelCount) {
+        mRenderer.handleObjs(usableObjs);
     }
 }
 
 void Application::asyncLoadModel(std::string path, FileType type)
 {
-    Model newModel(std::move(path), type);
-
-    importedObjs.push_back(newModel);
+    modelLoader.load(std::move(path), type);
 }
 
 void Application::handleMouse(double xposIn, double yposIn)
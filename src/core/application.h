@@ -4,6 +4,7 @@
 #include <SDL.h>
 
 #include <renderer/gl_renderer.h>
+#include "core/model_loader.h"
 
 class Application {
 public:
@@ -41,7 +42,7 @@ private:
     float deltaTime = 0.0f;
     float lastFrame = 0.0f;
 
-    std::vector<Model> importedObjs;
+    ModelLoader modelLoader;
     std::vector<Model> usableObjs;
     int chosenObjIndex = 0;
 
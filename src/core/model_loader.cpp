@@ -0,0 +1,158 @@
+#include "model_loader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "renderer/base_renderer.h"
+
+const char* getModelLoadStatusName(ModelLoadStatus status) {
+    switch (status) {
+        case ModelLoadStatus::Loading: return "Loading";
+        case ModelLoadStatus::Uploading: return "Uploading";
+        case ModelLoadStatus::Done: return "Done";
+        case ModelLoadStatus::Failed: return "Failed";
+        case ModelLoadStatus::Cancelled: return "Cancelled";
+        default: return "Unknown";
+    }
+}
+
+ModelLoader::~ModelLoader() {
+    // The GL context is gone by now, uploaded objects go with it and only the texture references are left to drop
+    for (std::unique_ptr<PendingLoad>& load : loads) {
+        load->progress->cancelled = true;
+    }
+    for (std::unique_ptr<PendingLoad>& load : loads) {
+        if (load->info.status == ModelLoadStatus::Loading) {
+            load->model = load->result.get();
+            freeTextureData(load->model);
+        }
+        else if (load->info.status == ModelLoadStatus::Uploading) {
+            freeTextureData(load->model);
+        }
+    }
+}
+
+size_t ModelLoader::load(std::string path, FileType type, const glm::mat4& modelMatrix) {
+    auto load = std::make_unique<PendingLoad>();
+    load->info.id = nextId++;
+    load->info.path = path;
+    load->modelMatrix = modelMatrix;
+    load->progress = std::make_shared<LoadProgress>();
+
+    std::shared_ptr<LoadProgress> progress = load->progress;
+    load->result = pool.submit([path = std::move(path), type, progress]() {
+        return Model(path, type, true, progress.get());
+    });
+
+    loads.push_back(std::move(load));
+    return loads.back()->info.id;
+}
+
+void ModelLoader::cancel(size_t id) {
+    for (std::unique_ptr<PendingLoad>& load : loads) {
+        if (load->info.id == id) load->progress->cancelled = true;
+    }
+}
+
+void ModelLoader::update(BaseRenderer& renderer, std::vector<Model>& models) {
+    renderer.deleteUnusedTextures();
+
+    auto startTime = std::chrono::steady_clock::now();
+    auto hasBudget = [&]() {
+        auto elapsed = std::chrono::steady_clock::now() - startTime;
+        return std::chrono::duration<double, std::milli>(elapsed).count() < uploadBudgetMilliseconds;
+    };
+    bool uploadedAny = false;
+
+    for (std::unique_ptr<PendingLoad>& load : loads) {
+        ModelLoadInfo& info = load->info;
+        bool cancelled = load->progress->cancelled;
+        if (info.status == ModelLoadStatus::Loading) {
+            if (load->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+
+            load->model = load->result.get();
+            if (cancelled || load->model.meshes.empty()) {
+                if (!cancelled) std::cout << "Failed to load model: " << info.path << "\n";
+                freeTextureData(load->model);
+                info.status = cancelled ? ModelLoadStatus::Cancelled : ModelLoadStatus::Failed;
+                continue;
+            }
+
+            load->model.model_matrix = load->modelMatrix;
+            for (auto& [path, texture] : load->model.textures_loaded) {
+                load->textures.push_back(&texture);
+            }
+            info.status = ModelLoadStatus::Uploading;
+        }
+        if (info.status != ModelLoadStatus::Uploading) continue;
+
+        if (cancelled) {
+            renderer.cancelUpload(load->pieceProgress);
+            renderer.unloadModelData(load->model);
+            info.status = ModelLoadStatus::Cancelled;
+            continue;
+        }
+
+        while (info.status == ModelLoadStatus::Uploading && (!uploadedAny || hasBudget())) {
+            uploadNextPiece(renderer, *load, models);
+            uploadedAny = true;
+        }
+    }
+}
+
+void ModelLoader::uploadNextPiece(BaseRenderer& renderer, PendingLoad& load, std::vector<Model>& models) {
+    size_t piece = load.uploadedPieces;
+    bool isDone = true;
+    if (piece < load.textures.size()) {
+        isDone = renderer.uploadTexture(*load.textures[piece], load.pieceProgress, uploadChunkBytes);
+    }
+    else if (piece - load.textures.size() < load.model.meshes.size()) {
+        size_t meshIndex = piece - load.textures.size();
+        isDone = renderer.uploadMesh(load.model, meshIndex, load.pieceProgress, uploadChunkBytes);
+    }
+    else {
+        renderer.finishModelUpload(load.model);
+        models.push_back(std::move(load.model));
+        load.model = Model();
+        load.textures.clear();
+        load.info.status = ModelLoadStatus::Done;
+        return;
+    }
+
+    if (isDone) {
+        load.uploadedPieces++;
+        load.pieceProgress = {};
+    }
+}
+
+size_t ModelLoader::getPieceCount(const PendingLoad& load) {
+    return load.textures.size() + load.model.meshes.size() + 1;
+}
+
+std::vector<ModelLoadInfo> ModelLoader::getLoads() const {
+    std::vector<ModelLoadInfo> infos;
+    for (const std::unique_ptr<PendingLoad>& load : loads) {
+        ModelLoadInfo info = load->info;
+        if (info.status == ModelLoadStatus::Loading) {
+            size_t totalItems = load->progress->totalItems;
+            info.progress = totalItems > 0 ? (float) load->progress->finishedItems / totalItems : 0.0f;
+        }
+        else if (info.status == ModelLoadStatus::Uploading) {
+            info.progress = (float) load->uploadedPieces / getPieceCount(*load);
+        }
+        else {
+            info.progress = 1.0f;
+        }
+        infos.push_back(info);
+    }
+    return infos;
+}
+
+void ModelLoader::clearFinished() {
+    loads.erase(std::remove_if(loads.begin(), loads.end(), [](const std::unique_ptr<PendingLoad>& load) {
+        ModelLoadStatus status = load->info.status;
+        return status == ModelLoadStatus::Done || status == ModelLoadStatus::Failed ||
+               status == ModelLoadStatus::Cancelled;
+    }), loads.end());
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "assets/model.h"
+#include "renderer/base_renderer.h"
+#include "utils/thread_pool.h"
+
+enum class ModelLoadStatus {
+    Loading, Uploading, Done, Failed, Cancelled
+};
+const char* getModelLoadStatusName(ModelLoadStatus status);
+
+struct ModelLoadInfo {
+    size_t id = 0;
+    std::string path;
+    ModelLoadStatus status = ModelLoadStatus::Loading;
+    // Of the current status, items decoded while loading and pieces uploaded afterwards
+    float progress = 0.0f;
+};
+
+// Loads models on background threads and uploads them on the GL thread a piece at a time, a texture or a mesh,
+// so big models neither block the frame they're requested in nor the one they arrive in. Large pieces go up in
+// parts of uploadChunkBytes, so no single mesh or texture blows the budget either. Not thread safe, every call has
+// to come from the GL thread.
+class ModelLoader {
+public:
+    ModelLoader() = default;
+    ~ModelLoader();
+
+    ModelLoader(const ModelLoader&) = delete;
+    ModelLoader& operator=(const ModelLoader&) = delete;
+
+    // Path and type as taken by the Model constructor. Returns the id of the load.
+    size_t load(std::string path, FileType type = OBJ, const glm::mat4& modelMatrix = glm::mat4(1.0f));
+    // Stops decoding at the next item or frees whatever was uploaded so far
+    void cancel(size_t id);
+
+    // Uploads finished loads until uploadBudgetMilliseconds are spent, at least one piece every call, and appends
+    // fully uploaded models to models
+    void update(BaseRenderer& renderer, std::vector<Model>& models);
+
+    std::vector<ModelLoadInfo> getLoads() const;
+    // Forgets every load that is done, failed or cancelled
+    void clearFinished();
+
+    double uploadBudgetMilliseconds = 2.0;
+    // Most a single upload call hands to the driver
+    size_t uploadChunkBytes = size_t(1) << 20;
+
+private:
+    struct PendingLoad {
+        ModelLoadInfo info;
+        glm::mat4 modelMatrix;
+        std::shared_ptr<LoadProgress> progress;
+        std::future<Model> result;
+
+        Model model;
+        std::vector<Texture*> textures;
+        size_t uploadedPieces = 0;
+        // Of the piece being uploaded
+        UploadProgress pieceProgress;
+    };
+
+    // Textures first, then meshes and then the materials, which need the texture ids. A part of the piece at a
+    // time, the next piece once it's done.
+    void uploadNextPiece(BaseRenderer& renderer, PendingLoad& load, std::vector<Model>& models);
+    static size_t getPieceCount(const PendingLoad& load);
+
+    // Imports aren't split across threads like pack loads, two of them at a time keep the shared pool busy
+    ThreadPool pool{2};
+    std::vector<std::unique_ptr<PendingLoad>> loads;
+    size_t nextId = 0;
+};
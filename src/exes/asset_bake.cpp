@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "assets/model.h"
+#include "utils/paths.h"
+#include "utils/thread_pool.h"
+
+namespace {
+void printUsage() {
+    std::cout << "Usage: asset_bake [options] <model>...\n"
+              << "Bakes OBJ and glTF models into packs without needing a GPU. Models are given relative to the\n"
+              << "objects directory like the demo loads them, so running both from the same directory lets the\n"
+              << "demo pick the packs up as they are. The demo only imports with the defaults, packs baked with\n"
+              << "any of the options below get rebaked by it.\n\n"
+              << "  --objects <dir>     Where models are read from, defaults to " << OBJECT_PATH << "\n"
+              << "  --out <dir>         Where packs get written, defaults to " << ASSET_PATH << "\n"
+              << "  --type <gltf|obj>   Import every model as this type instead of going by extension\n"
+              << "  --jobs <n>          Models baked at the same time, defaults to the hardware threads\n"
+              << "  --float-vertices    Store full float vertices instead of quantized ones\n"
+              << "  --no-optimize       Skip the vertex cache, overdraw and fetch optimizations\n"
+              << "  --no-overdraw       Skip only the overdraw optimization\n"
+              << "  --no-meshlets       Don't build meshlets\n"
+              << "  --no-lods           Don't generate simplified levels of detail\n"
+              << "  --animation-rate <n> Frames per second animation clips are resampled at, defaults to 30\n";
+}
+
+FileType getFileType(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    return extension == ".gltf" || extension == ".glb" ? GLTF : OBJ;
+}
+}
+
+int main(int argc, char* argv[]) {
+    std::string objectDirectory = OBJECT_PATH;
+    std::string outputDirectory = ASSET_PATH;
+    bool hasForcedType = false;
+    FileType forcedType = OBJ;
+    unsigned int jobs = std::thread::hardware_concurrency();
+    ImportSettings options;
+    std::vector<std::string> sources;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--objects" && hasValue) {
+            objectDirectory = argv[++i];
+            if (!objectDirectory.empty() && objectDirectory.back() != '/') objectDirectory += '/';
+        }
+        else if (argument == "--out" && hasValue) {
+            outputDirectory = argv[++i];
+        }
+        else if (argument == "--type" && hasValue) {
+            std::string type = argv[++i];
+            if (type != "gltf" && type != "obj") {
+                std::cout << "Unknown model type: " << type << "\n";
+                return 2;
+            }
+            hasForcedType = true;
+            forcedType = type == "gltf" ? GLTF : OBJ;
+        }
+        else if (argument == "--jobs" && hasValue) {
+            jobs = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (argument == "--float-vertices") {
+            options.vertexFormat = VertexFormat::Float;
+        }
+        else if (argument == "--no-optimize") {
+            options.optimizeMeshes = false;
+        }
+        else if (argument == "--no-overdraw") {
+            options.reduceOverdraw = false;
+        }
+        else if (argument == "--no-meshlets") {
+            options.buildMeshlets = false;
+        }
+        else if (argument == "--no-lods") {
+            options.generateLods = false;
+        }
+        else if (argument == "--animation-rate" && hasValue) {
+            options.animationSampleRate = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (argument == "--help" || argument == "-h") {
+            printUsage();
+            return 0;
+        }
+        else if (!argument.empty() && argument[0] == '-') {
+            std::cout << "Unknown option: " << argument << "\n";
+            printUsage();
+            return 2;
+        }
+        else {
+            sources.push_back(argument);
+        }
+    }
+
+    if (sources.empty()) {
+        printUsage();
+        return 2;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(outputDirectory, error);
+    if (error) {
+        std::cout << "Failed to create output directory " << outputDirectory << ": " << error.message() << "\n";
+        return 1;
+    }
+
+    // Each model already spreads its textures and meshes over the shared pool, this one only limits how many
+    // models are in flight at once
+    ThreadPool modelPool(std::min<size_t>(jobs, sources.size()));
+    std::atomic<int> failures = 0;
+    std::mutex outputMutex;
+
+    modelPool.parallelFor(sources.size(), [&](size_t i) {
+        // Same concatenation as the Model constructor, the source paths recorded in the pack have to match
+        std::filesystem::path sourcePath = objectDirectory + sources[i];
+        std::filesystem::path packPath = std::filesystem::path(outputDirectory) / (sourcePath.stem().string() + ".pack");
+
+        ImportSettings settings = makeImportSettings(hasForcedType ? forcedType : getFileType(sourcePath));
+        settings.vertexFormat = options.vertexFormat;
+        settings.optimizeMeshes = options.optimizeMeshes;
+        settings.reduceOverdraw = options.reduceOverdraw;
+        settings.buildMeshlets = options.buildMeshlets;
+        settings.generateLods = options.generateLods;
+        settings.animationSampleRate = options.animationSampleRate;
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        bool baked = std::filesystem::exists(sourcePath) &&
+                     Model::bake(sourcePath.string(), packPath.string(), settings);
+        auto endTime = std::chrono::high_resolution_clock::now();
+        double elapsedTime = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+
+        std::lock_guard<std::mutex> lock(outputMutex);
+        if (baked) {
+            std::cout << "Baked " << sourcePath.string() << " -> " << packPath.string() << " in " << elapsedTime
+                      << " ms\n";
+        }
+        else {
+            std::cout << "Failed to bake " << sourcePath.string() << "\n";
+            failures++;
+        }
+    });
+
+    if (failures > 0) {
+        std::cout << failures << " of " << sources.size() << " models failed to bake\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,341 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "assets/model.h"
+#include "utils/load_profiler.h"
+#include "utils/paths.h"
+#include "utils/thread_pool.h"
+
+namespace {
+// Every operator new of the process, including assimp's. Pixels decoded by stb and LZ4 output come from malloc
+// and aren't in here.
+std::atomic<uint64_t> allocationCount{0};
+std::atomic<uint64_t> allocatedBytes{0};
+std::atomic<uint64_t> liveBytes{0};
+std::atomic<uint64_t> peakLiveBytes{0};
+
+// Ahead of every block, keeps the size for operator delete without breaking the alignment of the block
+constexpr size_t ALLOCATION_HEADER_SIZE = alignof(std::max_align_t);
+
+void* countedAllocate(size_t size) {
+    void* block = std::malloc(size + ALLOCATION_HEADER_SIZE);
+    if (block == nullptr) return nullptr;
+    *static_cast<size_t*>(block) = size;
+
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    uint64_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    uint64_t peak = peakLiveBytes.load(std::memory_order_relaxed);
+    while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    return static_cast<char*>(block) + ALLOCATION_HEADER_SIZE;
+}
+
+void countedFree(void* pointer) {
+    if (pointer == nullptr) return;
+    void* block = static_cast<char*>(pointer) - ALLOCATION_HEADER_SIZE;
+    liveBytes.fetch_sub(*static_cast<size_t*>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+}
+
+void* operator new(size_t size) {
+    void* pointer = countedAllocate(size);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    countedFree(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    countedFree(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+    countedFree(pointer);
+}
+
+namespace {
+struct BenchmarkRun {
+    std::string mode;
+    int iteration = 0;
+    double wallMilliseconds = 0.0;
+    double stageMilliseconds[LOAD_STAGE_COUNT] = {};
+    uint64_t decompressedBytes = 0;
+    uint64_t fileBytes = 0;
+    uint64_t packBytes = 0;
+    uint64_t triangles = 0;
+    // Operator new calls during the load, the bytes they asked for, and the most the load had allocated at once
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t peakBytes = 0;
+    bool loaded = false;
+};
+
+void printUsage() {
+    std::cout << "Usage: asset_bench [options] <model>\n"
+              << "Loads a model over and over without a GPU and breaks the load time down by stage.\n\n"
+              << "  --objects <dir>          Where the model is read from, defaults to " << OBJECT_PATH << "\n"
+              << "  --type <gltf|obj>        Import type, goes by extension otherwise\n"
+              << "  --mode <cold|cached|both> Import from source every time, load the baked pack, or both\n"
+              << "  --iterations <n>         Timed loads per mode, defaults to 5\n"
+              << "  --serial                 Load on the calling thread only\n"
+              << "  --csv <file>             Write every run as a CSV row\n"
+              << "  --json <file>            Write every run and the per mode averages as JSON\n";
+}
+
+uint64_t countTriangles(const Model& model) {
+    uint64_t triangles = 0;
+    for (const Mesh& mesh : model.meshes) {
+        triangles += (mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount) / 3;
+    }
+    return triangles;
+}
+
+BenchmarkRun runLoad(const std::string& sourcePath, const std::string& packPath, const ImportSettings& settings,
+                     bool parallel, bool cold) {
+    if (cold) {
+        std::error_code error;
+        std::filesystem::remove(packPath, error);
+    }
+
+    LoadProfile profile;
+    setActiveLoadProfile(&profile);
+    uint64_t startAllocations = allocationCount, startAllocatedBytes = allocatedBytes, startLiveBytes = liveBytes;
+    peakLiveBytes = startLiveBytes;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    Model model(sourcePath, packPath, settings, parallel);
+    auto endTime = std::chrono::high_resolution_clock::now();
+    setActiveLoadProfile(nullptr);
+
+    BenchmarkRun run;
+    run.allocations = allocationCount - startAllocations;
+    run.allocatedBytes = allocatedBytes - startAllocatedBytes;
+    run.peakBytes = peakLiveBytes - startLiveBytes;
+    run.mode = cold ? "cold" : "cached";
+    run.wallMilliseconds = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    for (size_t stage = 0; stage < LOAD_STAGE_COUNT; stage++) {
+        run.stageMilliseconds[stage] = profile.getStageMilliseconds(static_cast<LoadStage>(stage));
+    }
+    run.decompressedBytes = profile.decompressedBytes;
+    run.fileBytes = profile.fileBytes;
+    std::error_code error;
+    run.packBytes = std::filesystem::file_size(packPath, error);
+    run.triangles = countTriangles(model);
+    run.loaded = !model.meshes.empty();
+
+    freeTextureData(model);
+    return run;
+}
+
+double getMegabytesPerSecond(uint64_t bytes, double milliseconds) {
+    return milliseconds > 0.0 ? bytes / 1e6 / (milliseconds / 1000.0) : 0.0;
+}
+
+nlohmann::json runToJson(const BenchmarkRun& run) {
+    nlohmann::json stages;
+    for (size_t stage = 0; stage < LOAD_STAGE_COUNT; stage++) {
+        stages[getLoadStageName(static_cast<LoadStage>(stage))] = run.stageMilliseconds[stage];
+    }
+
+    return {
+        {"mode", run.mode}, {"iteration", run.iteration}, {"wall_ms", run.wallMilliseconds}, {"stages_ms", stages},
+        {"decompressed_bytes", run.decompressedBytes}, {"file_bytes", run.fileBytes}, {"pack_bytes", run.packBytes},
+        {"triangles", run.triangles}, {"allocations", run.allocations}, {"allocated_bytes", run.allocatedBytes},
+        {"peak_bytes", run.peakBytes},
+        {"pack_mb_per_s", getMegabytesPerSecond(run.packBytes, run.wallMilliseconds)},
+        {"triangles_per_s", run.wallMilliseconds > 0.0 ? run.triangles / (run.wallMilliseconds / 1000.0) : 0.0}
+    };
+}
+
+BenchmarkRun averageRuns(const std::vector<BenchmarkRun>& runs, const std::string& mode) {
+    BenchmarkRun average;
+    average.mode = mode;
+    int count = 0;
+    for (const BenchmarkRun& run : runs) {
+        if (run.mode != mode) continue;
+
+        count++;
+        average.wallMilliseconds += run.wallMilliseconds;
+        for (size_t stage = 0; stage < LOAD_STAGE_COUNT; stage++) {
+            average.stageMilliseconds[stage] += run.stageMilliseconds[stage];
+        }
+        average.decompressedBytes += run.decompressedBytes;
+        average.fileBytes += run.fileBytes;
+        average.packBytes = run.packBytes;
+        average.triangles = run.triangles;
+        average.allocations += run.allocations;
+        average.allocatedBytes += run.allocatedBytes;
+        average.peakBytes += run.peakBytes;
+    }
+    if (count == 0) return average;
+
+    average.iteration = count;
+    average.wallMilliseconds /= count;
+    for (double& milliseconds : average.stageMilliseconds) milliseconds /= count;
+    average.decompressedBytes /= count;
+    average.fileBytes /= count;
+    average.allocations /= count;
+    average.allocatedBytes /= count;
+    average.peakBytes /= count;
+    return average;
+}
+
+void printSummary(const BenchmarkRun& average) {
+    std::cout << average.mode << " load, average of " << average.iteration << " runs: " << average.wallMilliseconds
+              << " ms, " << getMegabytesPerSecond(average.packBytes, average.wallMilliseconds) << " MB/s of pack, "
+              << average.triangles / (average.wallMilliseconds / 1000.0) << " triangles/s\n"
+              << "  " << average.allocations << " allocations, " << average.allocatedBytes / 1e6 << " MB allocated, "
+              << average.peakBytes / 1e6 << " MB peak\n";
+    for (size_t stage = 0; stage < LOAD_STAGE_COUNT; stage++) {
+        if (average.stageMilliseconds[stage] == 0.0) continue;
+        std::cout << "  " << getLoadStageName(static_cast<LoadStage>(stage)) << ": "
+                  << average.stageMilliseconds[stage] << " ms\n";
+    }
+}
+}
+
+int main(int argc, char* argv[]) {
+    std::string objectDirectory = OBJECT_PATH;
+    std::string mode = "both";
+    std::string csvPath, jsonPath, modelName;
+    bool hasForcedType = false, parallel = true;
+    FileType forcedType = OBJ;
+    int iterations = 5;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "--objects" && hasValue) {
+            objectDirectory = argv[++i];
+            if (!objectDirectory.empty() && objectDirectory.back() != '/') objectDirectory += '/';
+        }
+        else if (argument == "--type" && hasValue) {
+            std::string type = argv[++i];
+            if (type != "gltf" && type != "obj") {
+                std::cout << "Unknown model type: " << type << "\n";
+                printUsage();
+                return 2;
+            }
+            hasForcedType = true;
+            forcedType = type == "gltf" ? GLTF : OBJ;
+        }
+        else if (argument == "--mode" && hasValue) {
+            mode = argv[++i];
+        }
+        else if (argument == "--iterations" && hasValue) {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (argument == "--serial") {
+            parallel = false;
+        }
+        else if (argument == "--csv" && hasValue) {
+            csvPath = argv[++i];
+        }
+        else if (argument == "--json" && hasValue) {
+            jsonPath = argv[++i];
+        }
+        else if (argument[0] != '-' && modelName.empty()) {
+            modelName = argument;
+        }
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (modelName.empty() || (mode != "cold" && mode != "cached" && mode != "both")) {
+        printUsage();
+        return 2;
+    }
+
+    std::filesystem::path sourcePath = objectDirectory + modelName;
+    std::string extension = sourcePath.extension().string();
+    ImportSettings settings = makeImportSettings(
+        hasForcedType ? forcedType : (extension == ".gltf" || extension == ".glb" ? GLTF : OBJ));
+    // Benchmarks never touch the demo's packs
+    std::string packPath = (std::filesystem::temp_directory_path() /
+                            ("asset_bench_" + sourcePath.stem().string() + ".pack")).string();
+
+    std::vector<BenchmarkRun> runs;
+    for (bool cold : {true, false}) {
+        if ((cold && mode == "cached") || (!cold && mode == "cold")) continue;
+        // Untimed, bakes the pack the cached runs load and warms up the OS file cache
+        runLoad(sourcePath.string(), packPath, settings, parallel, cold);
+
+        for (int i = 0; i < iterations; i++) {
+            BenchmarkRun run = runLoad(sourcePath.string(), packPath, settings, parallel, cold);
+            if (!run.loaded) {
+                std::cout << "Failed to load " << sourcePath.string() << "\n";
+                return 1;
+            }
+            run.iteration = i;
+            runs.push_back(run);
+        }
+    }
+
+    std::cout << sourcePath.string() << " on " << (parallel ? ThreadPool::shared().getThreadCount() : 1)
+              << " threads, stage times add up the time of every thread\n";
+    nlohmann::json summary;
+    for (const char* runMode : {"cold", "cached"}) {
+        BenchmarkRun average = averageRuns(runs, runMode);
+        if (average.iteration == 0) continue;
+
+        printSummary(average);
+        summary[runMode] = runToJson(average);
+        summary[runMode].erase("iteration");
+    }
+
+    if (!csvPath.empty()) {
+        std::ofstream csv(csvPath);
+        csv << "model,mode,iteration,wall_ms";
+        for (size_t stage = 0; stage < LOAD_STAGE_COUNT; stage++) {
+            csv << "," << getLoadStageName(static_cast<LoadStage>(stage)) << "_ms";
+        }
+        csv << ",decompressed_bytes,file_bytes,pack_bytes,triangles,allocations,allocated_bytes,peak_bytes\n";
+        for (const BenchmarkRun& run : runs) {
+            csv << modelName << "," << run.mode << "," << run.iteration << "," << run.wallMilliseconds;
+            for (double milliseconds : run.stageMilliseconds) csv << "," << milliseconds;
+            csv << "," << run.decompressedBytes << "," << run.fileBytes << "," << run.packBytes << "," << run.triangles
+                << "," << run.allocations << "," << run.allocatedBytes << "," << run.peakBytes << "\n";
+        }
+        if (!csv.good()) {
+            std::cout << "Failed to write " << csvPath << "\n";
+            return 1;
+        }
+    }
+
+    if (!jsonPath.empty()) {
+        nlohmann::json output;
+        output["model"] = modelName;
+        output["threads"] = parallel ? ThreadPool::shared().getThreadCount() : 1;
+        output["summary"] = summary;
+        output["runs"] = nlohmann::json::array();
+        for (const BenchmarkRun& run : runs) output["runs"].push_back(runToJson(run));
+
+        std::ofstream json(jsonPath);
+        json << output.dump(2) << "\n";
+        if (!json.good()) {
+            std::cout << "Failed to write " << jsonPath << "\n";
+            return 1;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::remove(packPath, error);
+    return 0;
+}
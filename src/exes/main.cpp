@@ -1,6 +1,15 @@
 #include "core/application.h"
 
 int main(int argc, char* argv[]) {
+    // demo --time-load <model path> [gltf|obj] [iterations]
+    if (argc >= 3 && std::string(argv[1]) == "--time-load") {
+        FileType type = (argc >= 4 && std::string(argv[3]) == "gltf") ? GLTF : OBJ;
+        int iterations = argc >= 5 ? std::stoi(argv[4]) : 5;
+
+        reportCachedLoadSpeedup(argv[2], type, iterations);
+        return 0;
+    }
+
     Application app;
 
     app.init();
@@ -10,4 +19,4 @@ int main(int argc, char* argv[]) {
     app.cleanup();
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,8 +1,13 @@
 #include "base_renderer.h"
 #include "utils/functions.h"
 #include "stb_image.h"
+#include "assets/texture_mips.h"
+#include "assets/texture_registry.h"
 
 #include <SDL.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <thread>
 #include <future>
 #include <glm/gtc/matrix_transform.hpp>
@@ -23,6 +28,21 @@ void BaseRenderer::handleObjs(std::vector<Model>& objs) {}
 void BaseRenderer::drawModels(std::vector<Model>& models, Shader& shader, unsigned char drawOptions) const {
     bool shouldSkipTextures = drawOptions & SKIP_TEXTURES;
     bool shouldSkipCulling = drawOptions & SKIP_CULLING;
+    bool shouldCullClusters = !shouldSkipCulling && useClusterCulling;
+    bool shouldBatch = submissionMode == SubmissionMode::MultiDrawIndirect;
+    bool shouldUseMaterialTable = !shouldSkipTextures && materialTable.enabled;
+
+    Frustum clusterFrustum;
+    clusterStats = {};
+    renderStats = {};
+    if (shouldCullClusters) clusterFrustum = extractFrustum(camera->getProjectionMatrix() * camera->getViewMatrix());
+    float projectionScale = getProjectionScale(glm::radians(camera->Zoom), (float) windowSize.y);
+    unsigned int boundVertexArray = 0;
+    if (shouldBatch) drawBatcher.clear();
+    if (!shouldSkipTextures) {
+        shader.setBool("useMaterialTable", shouldUseMaterialTable);
+        if (shouldUseMaterialTable) materialTable.bind(shader);
+    }
 
     for (Model& model : models) {
         if (!shouldSkipCulling) {
@@ -34,6 +54,9 @@ void BaseRenderer::drawModels(std::vector<Model>& models, Shader& shader, unsign
 
         for (int j = 0; j < model.meshes.size(); j++) {
             Mesh& mesh = model.meshes[j];
+            // Evicted, the residency manager brings it back once it's visible
+            if (!mesh.geometry.isValid()) continue;
+            GeometryRange geometry = geometryPool.getRange(mesh.geometry);
 
             glm::mat4 finalModelMatrix = mesh.model_matrix * model.model_matrix;
             if (!shouldSkipCulling) {
@@ -43,76 +66,341 @@ void BaseRenderer::drawModels(std::vector<Model>& models, Shader& shader, unsign
                 if (!shouldDraw) continue;
             }
 
-            shader.setMat4("model", finalModelMatrix);
+            // Distance to the closest point of the bounds, so big meshes refine as soon as any part is close
+            glm::vec3 center(finalModelMatrix * ((mesh.aabb.minPoint + mesh.aabb.maxPoint) * 0.5f));
+            float scale = std::max({ glm::length(glm::vec3(finalModelMatrix[0])),
+                                     glm::length(glm::vec3(finalModelMatrix[1])),
+                                     glm::length(glm::vec3(finalModelMatrix[2])) });
+            float radius = glm::length(glm::vec3(mesh.aabb.maxPoint - mesh.aabb.minPoint)) * 0.5f * scale;
+            float distance = std::max(glm::distance(center, camera->Position) - radius, camera->zNear);
+            mesh.currentLod = selectLod(mesh.lods, mesh.currentLod, scale, distance, projectionScale, lodSettings);
+            MeshLod lod = mesh.lods.empty() ? MeshLod{0, geometry.indexCount, 0.0f} : mesh.lods[mesh.currentLod];
+
+            // Meshlets only cover the full level
+            bool shouldDrawMeshlets = shouldCullClusters && !mesh.meshlets.empty() && mesh.currentLod == 0;
+            if (shouldDrawMeshlets) {
+                visibleRanges.clear();
+                cullMeshlets(mesh.meshlets, finalModelMatrix, clusterFrustum, camera->Position, useConeCulling,
+                             visibleRanges, clusterStats);
+            }
+
+            // Materials in the table are fetched by the shaders, the rest get their textures bound
+            const Material* material = nullptr;
+            int materialIndex = -1;
             if (!shouldSkipTextures) {
-                Material material = model.materials_loaded[mesh.materialIndex];
+                const Material& meshMaterial = model.materials_loaded[mesh.materialIndex];
+                if (shouldUseMaterialTable && meshMaterial.tableIndex >= 0) materialIndex = meshMaterial.tableIndex;
+                else material = &meshMaterial;
+            }
+
+            Animation& currentAnimationData = model.animations[j];
+            bool isSkinned = !shouldSkipTextures && !currentAnimationData.bone_data.empty() && !model.clips.empty();
+            // Bone matrices are still uniforms, so skinned meshes keep their own draws
+            if (shouldBatch && !isSkinned) {
+                DrawData data{};
+                data.model = finalModelMatrix;
+                data.positionOffset = glm::vec4(glm::vec3(mesh.aabb.minPoint), 0.0f);
+                data.positionScale = glm::vec4(glm::vec3(mesh.aabb.maxPoint - mesh.aabb.minPoint), 0.0f);
+                data.materialIndex = materialIndex;
+                uint32_t firstIndex = uint32_t(geometry.indexOffset / mesh.indexSize);
 
-                if (material.textures.size() != 4) {
-                    shader.setBool("noMetallicMap", true);
-                    shader.setBool("noNormalMap", true);
+                if (shouldDrawMeshlets) {
+                    for (const IndexRange& range : visibleRanges) {
+                        drawBatcher.add(geometry.format, mesh.indexSize, material, firstIndex + range.offset,
+                                        range.count, geometry.baseVertex, data);
+                        renderStats.triangles += range.count / 3;
+                    }
                 }
                 else {
-                    shader.setBool("noMetallicMap", false);
-                    shader.setBool("noNormalMap", false);
+                    drawBatcher.add(geometry.format, mesh.indexSize, material, firstIndex + lod.indexOffset,
+                                    lod.indexCount, geometry.baseVertex, data);
+                    renderStats.triangles += lod.indexCount / 3;
                 }
+                continue;
+            }
 
-                for (int i = 0; i < material.textures.size(); i++) {
-                    glActiveTexture(GL_TEXTURE0 + i);
-
-                    string number;
-                    string name = material.textures[i].type;
-
-                    const string& key = name;
-                    shader.setInt(key, i);
-
-                    glBindTexture(GL_TEXTURE_2D, material.textures[i].id);
-                }
-                glActiveTexture(GL_TEXTURE0);
+            shader.setMat4("model", finalModelMatrix);
+            // From the pool, the packed vertices themselves may have been released after upload
+            if (geometry.format == VertexFormat::Quantized) {
+                shader.setVec3("positionOffset", glm::vec3(mesh.aabb.minPoint));
+                shader.setVec3("positionScale", glm::vec3(mesh.aabb.maxPoint - mesh.aabb.minPoint));
+            }
+            if (!shouldSkipTextures) {
+                shader.setInt("materialIndex", materialIndex);
+                if (material != nullptr) bindMaterial(shader, *material);
 
-                Animation& currentAnimationData = model.animations[j];
-                if (!currentAnimationData.bone_data.empty() && model.scene->mNumAnimations > 0) {
+                if (isSkinned) {
                     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, currentAnimationData.animationSSBO);
 
-                    auto finalTransforms = currentAnimationData.getBoneTransforms(animationTime, model.scene, model.nodes, chosenAnimation);
+                    const AnimationClip& clip = model.clips[std::min<size_t>(chosenAnimation, model.clips.size() - 1)];
+                    auto finalTransforms = currentAnimationData.getBoneTransforms(animationTime, clip, model.nodes);
                     for (unsigned int i = 0; i < finalTransforms.size(); i++) {
                         shader.setMat4("boneMatrices[" + std::to_string(i) + "]", finalTransforms[i]);
                     }
                 }
             }
 
-            glBindVertexArray(mesh.buffer.VAO);
-            glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, nullptr);
-            glBindVertexArray(0);
+            // Every mesh of a format shares the pool's VAO, it only changes along with the format
+            unsigned int vertexArray = geometryPool.getVertexArray(geometry.format);
+            if (vertexArray != boundVertexArray) {
+                glBindVertexArray(vertexArray);
+                boundVertexArray = vertexArray;
+            }
+            GLenum indexType = mesh.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+            if (shouldDrawMeshlets) {
+                drawCounts.clear();
+                drawOffsets.clear();
+                drawBaseVertices.clear();
+                for (const IndexRange& range : visibleRanges) {
+                    drawCounts.push_back(range.count);
+                    size_t offset = geometry.indexOffset + size_t(range.offset) * mesh.indexSize;
+                    drawOffsets.push_back((const void*) offset);
+                    drawBaseVertices.push_back(geometry.baseVertex);
+                    renderStats.triangles += range.count / 3;
+                }
+                if (!drawCounts.empty()) {
+                    glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), indexType, drawOffsets.data(),
+                                                  drawCounts.size(), drawBaseVertices.data());
+                    renderStats.drawCalls++;
+                }
+            }
+            else {
+                size_t offset = geometry.indexOffset + size_t(lod.indexOffset) * mesh.indexSize;
+                glDrawElementsBaseVertex(GL_TRIANGLES, lod.indexCount, indexType, (const void*) offset,
+                                         geometry.baseVertex);
+                renderStats.triangles += lod.indexCount / 3;
+                renderStats.drawCalls++;
+            }
+        }
+    }
+
+    if (shouldBatch) submitDrawBatches(shader, shouldSkipTextures, boundVertexArray);
+    glBindVertexArray(0);
+}
+
+void BaseRenderer::bindMaterial(Shader& shader, const Material& material) const {
+    renderStats.materialBinds++;
+    bool hasAllMaps = material.textures.size() == 4;
+    shader.setBool("noMetallicMap", !hasAllMaps);
+    shader.setBool("noNormalMap", !hasAllMaps);
+
+    for (int i = 0; i < material.textures.size(); i++) {
+        shader.setInt(material.textures[i].type, i);
+        glBindTextureUnit(i, material.textures[i].id);
+    }
+}
+
+void BaseRenderer::submitDrawBatches(Shader& shader, bool skipTextures, unsigned int& boundVertexArray) const {
+    drawBatcher.build();
+    renderStats.indirectCommands = drawBatcher.getCommandCount();
+    if (drawBatcher.getBuckets().empty()) return;
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawBatcher.getCommandBuffer());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, drawBatcher.getDrawDataBuffer());
+    shader.setBool("indirectDraws", true);
+
+    for (const DrawBucket& bucket : drawBatcher.getBuckets()) {
+        unsigned int vertexArray = geometryPool.getVertexArray(bucket.format);
+        if (vertexArray != boundVertexArray) {
+            glBindVertexArray(vertexArray);
+            boundVertexArray = vertexArray;
         }
+        if (!skipTextures && bucket.material != nullptr) bindMaterial(shader, *bucket.material);
+
+        // gl_DrawID restarts at 0 for every call
+        shader.setInt("firstDraw", (int) bucket.firstCommand);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, bucket.indexType,
+                                    (const void*) (bucket.firstCommand * sizeof(DrawElementsIndirectCommand)),
+                                    (GLsizei) bucket.commandCount, 0);
+        renderStats.drawCalls++;
     }
+
+    shader.setBool("indirectDraws", false);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 }
 
 void BaseRenderer::loadModelData(Model& model) {
+    deleteUnusedTextures();
+
     for (auto& info : model.textures_loaded) {
-        Texture& texture = info.second;
-        int levels = (texture.type == "texture_normal" || texture.width < 16) ? 1 : 4;
-        unsigned int textureID = glutil::createTexture(texture.width, texture.height,
-            GL_UNSIGNED_BYTE, texture.nrComponents, texture.data, levels);
+        uploadTexture(info.second);
+    }
+
+    for (size_t i = 0; i < model.meshes.size(); i++) {
+        uploadMesh(model, i);
+    }
+
+    finishModelUpload(model);
+}
+
+void BaseRenderer::uploadTexture(Texture& texture) {
+    UploadProgress progress;
+    uploadTexture(texture, progress, SIZE_MAX);
+}
+
+bool BaseRenderer::uploadTexture(Texture& texture, UploadProgress& progress, size_t maxBytes) {
+    assets::TextureRegistry& registry = assets::TextureRegistry::shared();
+
+    // Only the first model using a texture uploads it, the rest get the same GL texture. The pixels are only read
+    // under the registry's lock, between two calls another load may finish the same texture and free them or the
+    // last reference may go away.
+    assets::TextureKey key = assets::getTextureKey(texture);
+    unsigned int id = -1;
+    bool isDone = true;
+    bool hasPixels = registry.withPixels(key, [&](const Texture& shared) {
+        isDone = uploadPixels(shared, assets::getMipFilter(texture), progress, maxBytes, id);
+    });
+    if (!hasPixels) {
+        cancelUpload(progress);
+        texture.id = registry.find(key).id;
+        texture.data = nullptr;
+        return true;
+    }
+    if (!isDone) return false;
+
+    registry.setUploaded(key, id);
+    texture.id = id;
+    texture.data = nullptr;
+    return true;
+}
+
+bool BaseRenderer::uploadPixels(const Texture& shared, assets::MipFilter mipFilter, UploadProgress& progress,
+                                size_t maxBytes, unsigned int& id) {
+    if (shared.format != TextureFormat::Uncompressed) {
+        UploadAllocation allocation;
+        const unsigned char* pixels = stagePixels(shared.data, shared.dataSize, allocation);
+        if (assets::canStreamTexture(shared)) {
+            // Only immutable storage can go in the material table, at the cost of allocating the finer levels up
+            // front. They count against the streaming budget from then on and are never evicted.
+            bool immutableStorage = materialTable.enabled;
+            id = glutil::createStreamedTexture(shared.width, shared.height, shared.levels, shared.firstLevel,
+                shared.format, pixels, shared.dataSize, immutableStorage);
+            Texture streamed = shared;
+            streamed.id = id;
+            textureStreamer.addTexture(streamed, immutableStorage);
+        }
+        else {
+            id = glutil::createCompressedTexture(shared.width, shared.height, shared.levels,
+                shared.format, pixels, shared.dataSize);
+        }
+        finishStaging(allocation);
+        return true;
+    }
+
+    // Level 0 goes up in bands of rows, the rest of the chain once all of it is there. The mips are filtered like the
+    // baked ones, in linear space for colour and renormalized for normal maps, which glGenerateTextureMipmap can't.
+    int levels = assets::getMipLevelCount(shared.width, shared.height);
+    if (progress.texture == 0) {
+        progress.texture = glutil::createTextureStorage(shared.width, shared.height, shared.nrComponents, levels);
+    }
+
+    size_t rowSize = (size_t) shared.width * shared.nrComponents;
+    int firstRow = (int) (progress.uploadedBytes / rowSize);
+    int rows = (int) std::clamp<size_t>(maxBytes / rowSize, 1, shared.height - firstRow);
+    UploadAllocation allocation;
+    const unsigned char* pixels = stagePixels(shared.data + firstRow * rowSize, rows * rowSize, allocation);
+    glutil::uploadTextureRows(progress.texture, firstRow, shared.width, rows, GL_UNSIGNED_BYTE,
+        shared.nrComponents, pixels);
+    finishStaging(allocation);
+    progress.uploadedBytes += rows * rowSize;
+    if (firstRow + rows < shared.height) return false;
+
+    std::vector<std::vector<unsigned char>> mipChain = assets::generateMipChain(shared.data, shared.width,
+        shared.height, shared.nrComponents, mipFilter);
+    int levelWidth = shared.width, levelHeight = shared.height;
+    for (int level = 1; level < (int) mipChain.size(); level++) {
+        levelWidth = std::max(levelWidth / 2, 1);
+        levelHeight = std::max(levelHeight / 2, 1);
+        UploadAllocation levelAllocation;
+        const unsigned char* levelPixels = stagePixels(mipChain[level].data(), mipChain[level].size(),
+                                                       levelAllocation);
+        glutil::uploadTextureRows(progress.texture, 0, levelWidth, levelHeight, GL_UNSIGNED_BYTE,
+            shared.nrComponents, levelPixels, level);
+        finishStaging(levelAllocation);
+    }
+    id = progress.texture;
+    progress.texture = 0;
+    return true;
+}
+
+void BaseRenderer::uploadMesh(Model& model, size_t meshIndex) {
+    UploadProgress progress;
+    uploadMesh(model, meshIndex, progress, SIZE_MAX);
+}
 
-        texture.id = textureID;
+bool BaseRenderer::uploadMesh(Model& model, size_t meshIndex, UploadProgress& progress, size_t maxBytes) {
+    Mesh& mesh = model.meshes[meshIndex];
+    if (!mesh.geometry.isValid()) mesh.geometry = geometryPool.allocateRange(mesh);
+    if (!geometryPool.upload(mesh.geometry, mesh, progress.uploadedBytes, maxBytes)) return false;
 
-        stbi_image_free(texture.data);
+    residencyManager.releaseGeometry(model, mesh);
+
+    Animation& animationData = model.animations[meshIndex];
+    if (!animationData.bone_data.empty() && !model.clips.empty()) {
+        animationData.animationSSBO = glutil::createBuffer(sizeof(VertexBoneData) * animationData.bone_data.size(),
+            animationData.bone_data.data());
+    }
+    return true;
+}
+
+void BaseRenderer::cancelUpload(UploadProgress& progress) {
+    if (progress.texture != 0) glutil::deleteTextures({ progress.texture });
+    progress = {};
+}
+
+const unsigned char* BaseRenderer::stagePixels(const unsigned char* data, size_t size, UploadAllocation& allocation) {
+    // Staged in the upload ring, the texture calls then return without the driver copying the pixels first
+    if (!uploadRing.allocate(size, allocation)) {
+        uploadRing.addFallback();
+        allocation = {};
+        return data;
     }
 
+    std::memcpy(allocation.data, data, size);
+    uploadRing.bind();
+    return uploadRing.getUnpackPointer(allocation);
+}
+
+void BaseRenderer::finishStaging(const UploadAllocation& allocation) {
+    if (allocation.data == nullptr) return;
+
+    uploadRing.unbind();
+    uploadRing.commit(allocation);
+}
+
+void BaseRenderer::finishModelUpload(Model& model) {
     for (Material& material : model.materials_loaded) {
         for (std::string& path : material.texture_paths) {
             Texture& texture = model.textures_loaded[path];
             material.textures.push_back(texture);
         }
+        materialTable.add(material, textureStreamer);
     }
+}
 
-    for (Animation& animationData: model.animations) {
-        if (!animationData.bone_data.empty() && model.scene->mNumAnimations > 0) {
-            glCreateBuffers(1, &animationData.animationSSBO);
-            glNamedBufferStorage(animationData.animationSSBO, sizeof(VertexBoneData) * animationData.bone_data.size(),
-                animationData.bone_data.data(), GL_DYNAMIC_STORAGE_BIT);
-        }
+void BaseRenderer::unloadModelData(Model& model) {
+    for (Mesh& mesh : model.meshes) {
+        geometryPool.free(mesh.geometry);
+    }
+    for (Animation& animationData : model.animations) {
+        glutil::deleteBuffer(animationData.animationSSBO);
+        animationData.animationSSBO = 0;
+    }
+    for (Material& material : model.materials_loaded) {
+        materialTable.remove(material);
+        material.textures.clear();
+    }
+
+    freeTextureData(model);
+    deleteUnusedTextures();
+}
+
+void BaseRenderer::deleteUnusedTextures() {
+    std::vector<unsigned int> unusedTextures = assets::TextureRegistry::shared().takeUnusedTextureIds();
+    for (unsigned int id : unusedTextures) {
+        textureStreamer.removeTexture(id);
     }
+    glutil::deleteTextures(unusedTextures);
 }
 
 void BaseRenderer::checkFrustum(std::vector<Model>& objs) const {
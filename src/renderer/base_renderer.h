@@ -6,10 +6,38 @@
 #include "shader/shader.h"
 #include "utils/camera.h"
 #include "assets/model.h"
+#include "assets/texture_mips.h"
 #include "utils/common_primitives.h"
+#include "renderer/cluster_culling.h"
+#include "renderer/draw_batches.h"
+#include "renderer/geometry_pool.h"
+#include "renderer/lod_selection.h"
+#include "renderer/material_table.h"
+#include "renderer/residency_manager.h"
+#include "renderer/texture_streamer.h"
+#include "renderer/upload_ring.h"
 
 #include "ui/editor.h"
 
+struct RenderStats {
+    size_t drawCalls = 0;
+    size_t triangles = 0;
+    // Draws submitted through multi-draw indirect, drawCalls counts the calls submitting them
+    size_t indirectCommands = 0;
+    // Materials whose textures had to be bound, the rest came from the material table
+    size_t materialBinds = 0;
+};
+
+// How far a texture or mesh uploaded in parts got, zeroed before its first part
+struct UploadProgress {
+    size_t uploadedBytes = 0;
+    // Uncompressed texture being filled, not in the texture registry until it's complete
+    unsigned int texture = 0;
+};
+
+// Where the vertex shaders find the per draw data of indirect draws
+constexpr unsigned int DRAW_DATA_BINDING = 4;
+
 enum DrawOptions {
     SKIP_TEXTURES = (1u << 0),
     SKIP_CULLING = (1u << 1)
@@ -22,6 +50,22 @@ public:
     virtual void init_resources();
     virtual void handleObjs(std::vector<Model>& objs);
     void loadModelData(Model& model);
+    // loadModelData in pieces, for uploads spread over several frames: every texture, every mesh and then
+    // finishModelUpload once all of them are done
+    void uploadTexture(Texture& texture);
+    void uploadMesh(Model& model, size_t meshIndex);
+    void finishModelUpload(Model& model);
+    // The same split further, each call uploads at most about maxBytes of the texture or mesh and returns true once
+    // it's done. Meshes go up in ranges of their pool allocation, uncompressed textures in bands of rows and
+    // compressed ones, already small, in one go.
+    bool uploadTexture(Texture& texture, UploadProgress& progress, size_t maxBytes);
+    bool uploadMesh(Model& model, size_t meshIndex, UploadProgress& progress, size_t maxBytes);
+    // Frees a texture left partly uploaded, meshes go with unloadModelData
+    void cancelUpload(UploadProgress& progress);
+    // Frees the GL objects of a model, fully or partly uploaded, and drops its texture references
+    void unloadModelData(Model& model);
+    // Deletes the GL textures no model references anymore
+    void deleteUnusedTextures();
 
     virtual void render(std::vector<Model>& objs) = 0;
     virtual void handleImGui() = 0;
@@ -35,11 +79,44 @@ public:
     ScreenQuad screenQuad;
     EnviornmentCubemap cubemap;
 
+    // Meshes baked with meshlets are culled per cluster unless SKIP_CULLING is passed
+    bool useClusterCulling = true;
+    bool useConeCulling = true;
+    SubmissionMode submissionMode = SubmissionMode::Direct;
+    LodSettings lodSettings;
+    // Before the streamer, whose pending reads write into it
+    PixelUploadRing uploadRing;
+    TextureStreamer textureStreamer;
+    GeometryPool geometryPool;
+    MaterialTable materialTable;
+    ResidencyManager residencyManager;
+
 protected:
     float startTime = 0.0f;
     float animationTime = 0.0f;
     int chosenAnimation = 0;
 
+    // From the last drawModels call
+    mutable ClusterCullingStats clusterStats;
+    mutable RenderStats renderStats;
+    mutable std::vector<IndexRange> visibleRanges;
+    mutable std::vector<GLsizei> drawCounts;
+    mutable std::vector<const void*> drawOffsets;
+    mutable std::vector<GLint> drawBaseVertices;
+    mutable DrawBatcher drawBatcher;
+
     void drawModels(std::vector<Model>& models, Shader& shader, unsigned char drawOptions = 0) const;
+    // Textures and the uniforms telling the shaders which maps exist
+    void bindMaterial(Shader& shader, const Material& material) const;
+    // Everything drawModels batched, one multi-draw per bucket
+    void submitDrawBatches(Shader& shader, bool skipTextures, unsigned int& boundVertexArray) const;
     void checkFrustum(std::vector<Model>& objs) const;
+    // The part of uploadTexture that reads the registry's pixels, called under its lock. Sets id once the texture
+    // is complete and returns true then.
+    bool uploadPixels(const Texture& shared, assets::MipFilter mipFilter, UploadProgress& progress, size_t maxBytes,
+                      unsigned int& id);
+    // Copies pixels into the upload ring and binds it, returning the pointer the texture calls take instead of data.
+    // Falls back to data itself when the ring is full; finishStaging once the calls are made, either way.
+    const unsigned char* stagePixels(const unsigned char* data, size_t size, UploadAllocation& allocation);
+    void finishStaging(const UploadAllocation& allocation);
 };
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "cluster_culling.h"
+
+#include <algorithm>
+
+Frustum extractFrustum(const glm::mat4& viewProjection) {
+    glm::mat4 rows = glm::transpose(viewProjection);
+    glm::vec4 planes[6] = {
+        rows[3] + rows[0], rows[3] - rows[0],
+        rows[3] + rows[1], rows[3] - rows[1],
+        rows[3] + rows[2], rows[3] - rows[2]
+    };
+
+    Frustum frustum;
+    for (const glm::vec4& plane : planes) {
+        glm::vec3 normal(plane);
+        float length = glm::length(normal);
+        normal /= length;
+        frustum.allPlanes.push_back({ -normal * (plane.w / length), normal });
+    }
+    return frustum;
+}
+
+void cullMeshlets(const std::vector<Meshlet>& meshlets, const glm::mat4& modelMatrix, const Frustum& frustum,
+                  const glm::vec3& cameraPosition, bool coneCulling, std::vector<IndexRange>& visibleRanges,
+                  ClusterCullingStats& stats) {
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
+    float maxScale = std::max({ glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])),
+                                glm::length(glm::vec3(modelMatrix[2])) });
+
+    stats.meshlets += meshlets.size();
+    for (const Meshlet& meshlet : meshlets) {
+        glm::vec3 center(modelMatrix * glm::vec4(meshlet.center, 1.0f));
+        if (!frustum.intersectsSphere(center, meshlet.radius * maxScale)) {
+            stats.frustumCulled++;
+            continue;
+        }
+
+        if (coneCulling && meshlet.coneCutoff < 1.0f) {
+            glm::vec3 apex(modelMatrix * glm::vec4(meshlet.coneApex, 1.0f));
+            glm::vec3 axis = glm::normalize(normalMatrix * meshlet.coneAxis);
+            if (glm::dot(glm::normalize(apex - cameraPosition), axis) >= meshlet.coneCutoff) {
+                stats.coneCulled++;
+                continue;
+            }
+        }
+
+        if (!visibleRanges.empty() && visibleRanges.back().offset + visibleRanges.back().count == meshlet.indexOffset) {
+            visibleRanges.back().count += meshlet.indexCount;
+        }
+        else {
+            visibleRanges.push_back({ meshlet.indexOffset, meshlet.indexCount });
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include "assets/mesh.h"
+#include "utils/camera.h"
+
+struct ClusterCullingStats {
+    size_t meshlets = 0;
+    size_t frustumCulled = 0;
+    size_t coneCulled = 0;
+};
+
+// Contiguous run of visible triangles, in indices
+struct IndexRange {
+    uint32_t offset;
+    uint32_t count;
+};
+
+// Frustum planes of a view projection matrix, pointing inwards
+Frustum extractFrustum(const glm::mat4& viewProjection);
+
+// Appends the index ranges of the meshlets that can be visible with the mesh drawn with `modelMatrix`, merging
+// neighbouring ones. Doesn't touch OpenGL, so it can run anywhere.
+void cullMeshlets(const std::vector<Meshlet>& meshlets, const glm::mat4& modelMatrix, const Frustum& frustum,
+                  const glm::vec3& cameraPosition, bool coneCulling, std::vector<IndexRange>& visibleRanges,
+                  ClusterCullingStats& stats);
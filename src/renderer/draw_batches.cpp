@@ -0,0 +1,73 @@
+#include "draw_batches.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include "utils/functions.h"
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "Commands have to be tightly packed");
+static_assert(sizeof(DrawData) % 16 == 0, "DrawData has to match its std430 layout");
+
+void DrawBatcher::clear() {
+    draws.clear();
+    materials.clear();
+    materialIndices.clear();
+}
+
+void DrawBatcher::add(VertexFormat format, unsigned int indexSize, const Material* material, uint32_t indexOffset,
+                      uint32_t indexCount, int32_t baseVertex, const DrawData& data) {
+    auto inserted = materialIndices.try_emplace(material, (uint32_t) materials.size());
+    if (inserted.second) materials.push_back(material);
+
+    Draw& draw = draws.emplace_back();
+    draw.format = format;
+    draw.indexSize = indexSize;
+    draw.materialOrder = inserted.first->second;
+    draw.command = { indexCount, 1, indexOffset, baseVertex, 0 };
+    draw.data = data;
+}
+
+void DrawBatcher::build() {
+    order.resize(draws.size());
+    for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+    // Stable, so meshes keep the order they were added in within a bucket
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        const Draw& first = draws[a];
+        const Draw& second = draws[b];
+        return std::tie(first.format, first.indexSize, first.materialOrder) <
+               std::tie(second.format, second.indexSize, second.materialOrder);
+    });
+
+    buckets.clear();
+    commands.clear();
+    drawData.clear();
+    for (uint32_t index : order) {
+        const Draw& draw = draws[index];
+        const Material* material = materials[draw.materialOrder];
+        GLenum indexType = draw.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        if (buckets.empty() || buckets.back().format != draw.format || buckets.back().indexType != indexType ||
+            buckets.back().material != material) {
+            buckets.push_back({ draw.format, indexType, material, commands.size(), 0 });
+        }
+        buckets.back().commandCount++;
+        commands.push_back(draw.command);
+        drawData.push_back(draw.data);
+    }
+    if (commands.empty()) return;
+
+    size_t commandBytes = commands.size() * sizeof(DrawElementsIndirectCommand);
+    size_t drawDataBytes = drawData.size() * sizeof(DrawData);
+    reserve(commandBuffer, commandCapacity, commandBytes);
+    reserve(drawDataBuffer, drawDataCapacity, drawDataBytes);
+    glNamedBufferSubData(commandBuffer, 0, commandBytes, commands.data());
+    glNamedBufferSubData(drawDataBuffer, 0, drawDataBytes, drawData.data());
+}
+
+void DrawBatcher::reserve(unsigned int& buffer, size_t& capacity, size_t size) {
+    if (size <= capacity) return;
+
+    capacity = std::max<size_t>(capacity, 4096);
+    while (capacity < size) capacity *= 2;
+    if (buffer != 0) glutil::deleteBuffer(buffer);
+    buffer = glutil::createBuffer(capacity, nullptr);
+}
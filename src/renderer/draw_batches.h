@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "assets/mesh.h"
+#include "utils/material.h"
+
+// How drawModels hands meshes to the driver, switchable at runtime to compare the two
+enum class SubmissionMode {
+    // One draw per mesh, uniforms and textures set in between
+    Direct,
+    // One glMultiDrawElementsIndirect per state bucket, per draw data read through gl_DrawID
+    MultiDrawIndirect
+};
+
+// Layout glMultiDrawElementsIndirect reads
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+// What the vertex shaders read from the draw data buffer instead of the per draw uniforms, std430
+struct DrawData {
+    glm::mat4 model;
+    // Bounds quantized positions are relative to, w unused
+    glm::vec4 positionOffset;
+    glm::vec4 positionScale;
+    // Into the material table, -1 for materials bound with the bucket
+    int32_t materialIndex;
+    uint32_t padding[3];
+};
+
+// Consecutive commands drawn without changing any state in between
+struct DrawBucket {
+    VertexFormat format;
+    GLenum indexType;
+    // Bound before the bucket is drawn, null when drawn without textures or from the material table
+    const Material* material;
+    size_t firstCommand;
+    size_t commandCount;
+};
+
+// Collects the draws of one pass, sorts them into buckets of the same vertex format, index type and bound material,
+// and uploads their commands and draw data to GPU buffers. Materials in the material table share one bucket.
+// Command i of the buffers reads draw data i, the shaders add the bucket's first command to gl_DrawID. GL thread
+// only, the buffers are left to the context.
+class DrawBatcher {
+public:
+    DrawBatcher() = default;
+
+    DrawBatcher(const DrawBatcher&) = delete;
+    DrawBatcher& operator=(const DrawBatcher&) = delete;
+
+    void clear();
+    // indexOffset and indexCount in indices of indexSize bytes, indexOffset from the start of the index buffer
+    void add(VertexFormat format, unsigned int indexSize, const Material* material, uint32_t indexOffset,
+             uint32_t indexCount, int32_t baseVertex, const DrawData& data);
+    void build();
+
+    const std::vector<DrawBucket>& getBuckets() const { return buckets; }
+    unsigned int getCommandBuffer() const { return commandBuffer; }
+    unsigned int getDrawDataBuffer() const { return drawDataBuffer; }
+    size_t getCommandCount() const { return commands.size(); }
+
+private:
+    struct Draw {
+        VertexFormat format;
+        unsigned int indexSize;
+        // Into materials, in the order they were first added
+        uint32_t materialOrder;
+        DrawElementsIndirectCommand command;
+        DrawData data;
+    };
+
+    // Grows buffer to hold at least size bytes, dropping what it held
+    static void reserve(unsigned int& buffer, size_t& capacity, size_t size);
+
+    std::vector<Draw> draws;
+    std::vector<uint32_t> order;
+    std::vector<const Material*> materials;
+    std::unordered_map<const Material*, uint32_t> materialIndices;
+
+    std::vector<DrawBucket> buckets;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<DrawData> drawData;
+
+    unsigned int commandBuffer = 0;
+    unsigned int drawDataBuffer = 0;
+    size_t commandCapacity = 0;
+    size_t drawDataCapacity = 0;
+};
@@ -0,0 +1,294 @@
+#include "geometry_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "utils/functions.h"
+
+namespace {
+constexpr size_t INITIAL_VERTEX_CAPACITY = size_t(1) << 16;
+constexpr size_t INITIAL_INDEX_UNIT_CAPACITY = size_t(1) << 17;
+constexpr size_t INDEX_UNIT_SIZE = 4;
+
+// A new buffer of size bytes starting with the first copySize bytes of buffer, which is deleted
+unsigned int resizeBuffer(unsigned int buffer, size_t copySize, size_t size) {
+    unsigned int resized = glutil::createBuffer(size, nullptr);
+    if (buffer != 0) {
+        if (copySize > 0) glCopyNamedBufferSubData(buffer, resized, 0, 0, copySize);
+        glutil::deleteBuffer(buffer);
+    }
+    return resized;
+}
+}
+
+GeometryPool::FormatPool& GeometryPool::getFormatPool(VertexFormat format) {
+    FormatPool& pool = pools[(size_t) format];
+    if (pool.vertexArray == 0) init(pool, format);
+    return pool;
+}
+
+void GeometryPool::init(FormatPool& pool, VertexFormat format) {
+    glCreateVertexArrays(1, &pool.vertexArray);
+    unsigned int vao = pool.vertexArray;
+
+    // The attribute locations the model shaders declare, packed vertices leave out the bitangent whose sign rides
+    // in position.w
+    auto addAttribute = [vao](VertexType location, int size, GLenum type, bool normalized, size_t offset) {
+        glEnableVertexArrayAttrib(vao, location);
+        if (type == GL_UNSIGNED_INT) {
+            glVertexArrayAttribIFormat(vao, location, size, type, offset);
+        }
+        else {
+            glVertexArrayAttribFormat(vao, location, size, type, normalized, offset);
+        }
+        glVertexArrayAttribBinding(vao, location, 0);
+    };
+    if (format == VertexFormat::Quantized) {
+        pool.stride = sizeof(PackedVertex);
+        addAttribute(POSITION, 4, GL_UNSIGNED_SHORT, true, offsetof(PackedVertex, position));
+        addAttribute(NORMAL, 2, GL_SHORT, true, offsetof(PackedVertex, normal));
+        addAttribute(TEXCOORDS, 2, GL_HALF_FLOAT, false, offsetof(PackedVertex, texCoords));
+        addAttribute(TANGENT, 2, GL_SHORT, true, offsetof(PackedVertex, tangent));
+        addAttribute(VERTEX_ID, 1, GL_UNSIGNED_INT, false, offsetof(PackedVertex, ID));
+    }
+    else {
+        pool.stride = sizeof(Vertex);
+        addAttribute(POSITION, 3, GL_FLOAT, false, offsetof(Vertex, Position));
+        addAttribute(NORMAL, 3, GL_FLOAT, false, offsetof(Vertex, Normal));
+        addAttribute(TEXCOORDS, 2, GL_FLOAT, false, offsetof(Vertex, TexCoords));
+        addAttribute(TANGENT, 3, GL_FLOAT, false, offsetof(Vertex, Tangent));
+        addAttribute(BI_TANGENT, 3, GL_FLOAT, false, offsetof(Vertex, Bitangent));
+        addAttribute(VERTEX_ID, 1, GL_UNSIGNED_INT, false, offsetof(Vertex, ID));
+    }
+
+    reserve(pool, INITIAL_VERTEX_CAPACITY, INITIAL_INDEX_UNIT_CAPACITY);
+}
+
+void GeometryPool::reserve(FormatPool& pool, size_t vertexCapacity, size_t indexUnitCapacity) {
+    if (vertexCapacity > pool.vertices.getCapacity()) {
+        pool.vertexBuffer = resizeBuffer(pool.vertexBuffer, pool.vertices.getCapacity() * pool.stride,
+                                         vertexCapacity * pool.stride);
+        pool.vertices.grow(vertexCapacity);
+        glVertexArrayVertexBuffer(pool.vertexArray, 0, pool.vertexBuffer, 0, pool.stride);
+    }
+    if (indexUnitCapacity > pool.indices.getCapacity()) {
+        pool.indexBuffer = resizeBuffer(pool.indexBuffer, pool.indices.getCapacity() * INDEX_UNIT_SIZE,
+                                        indexUnitCapacity * INDEX_UNIT_SIZE);
+        pool.indices.grow(indexUnitCapacity);
+        glVertexArrayElementBuffer(pool.vertexArray, pool.indexBuffer);
+    }
+}
+
+GeometryHandle GeometryPool::allocate(const Mesh& mesh) {
+    GeometryHandle handle = allocateRange(mesh);
+    size_t uploadedBytes = 0;
+    upload(handle, mesh, uploadedBytes, SIZE_MAX);
+    return handle;
+}
+
+GeometryHandle GeometryPool::allocateRange(const Mesh& mesh) {
+    VertexFormat format = mesh.packedVertices.empty() ? VertexFormat::Float : VertexFormat::Quantized;
+    FormatPool& pool = getFormatPool(format);
+
+    // Empty meshes still get a range of their own, so every handle has a distinct one
+    size_t vertexCount = format == VertexFormat::Quantized ? mesh.packedVertices.size() : mesh.vertices.size();
+    size_t indexBytes = mesh.indices.size() * mesh.indexSize;
+    size_t vertexUnits = std::max<size_t>(vertexCount, 1);
+    size_t indexUnits = std::max<size_t>((indexBytes + INDEX_UNIT_SIZE - 1) / INDEX_UNIT_SIZE, 1);
+
+    size_t vertexOffset, indexUnitOffset;
+    if (!pool.vertices.allocate(vertexUnits, vertexOffset)) {
+        size_t capacity = pool.vertices.getCapacity();
+        reserve(pool, std::max(capacity * 2, capacity + vertexUnits), 0);
+        pool.vertices.allocate(vertexUnits, vertexOffset);
+    }
+    if (!pool.indices.allocate(indexUnits, indexUnitOffset)) {
+        size_t capacity = pool.indices.getCapacity();
+        reserve(pool, 0, std::max(capacity * 2, capacity + indexUnits));
+        pool.indices.allocate(indexUnits, indexUnitOffset);
+    }
+
+    uint32_t id;
+    if (!freeIds.empty()) {
+        id = freeIds.back();
+        freeIds.pop_back();
+    }
+    else {
+        id = allocations.size();
+        allocations.emplace_back();
+    }
+    allocations[id] = {format, vertexOffset, vertexUnits, indexUnitOffset, indexUnits,
+                       (uint32_t) mesh.indices.size(), true};
+    pool.allocations++;
+    return {id};
+}
+
+bool GeometryPool::upload(GeometryHandle handle, const Mesh& mesh, size_t& uploadedBytes, size_t maxBytes) {
+    const Allocation& allocation = allocations[handle.id];
+    const FormatPool& pool = pools[(size_t) allocation.format];
+
+    bool isQuantized = allocation.format == VertexFormat::Quantized;
+    size_t vertexBytes = (isQuantized ? mesh.packedVertices.size() : mesh.vertices.size()) * pool.stride;
+    size_t indexBytes = mesh.indices.size() * mesh.indexSize;
+    if (uploadedBytes < vertexBytes) {
+        const unsigned char* vertexData = isQuantized ? (const unsigned char*) mesh.packedVertices.data()
+                                                      : (const unsigned char*) mesh.vertices.data();
+        size_t size = std::min(maxBytes, vertexBytes - uploadedBytes);
+        glNamedBufferSubData(pool.vertexBuffer, allocation.vertexOffset * pool.stride + uploadedBytes, size,
+                             vertexData + uploadedBytes);
+        uploadedBytes += size;
+        maxBytes -= size;
+    }
+
+    // Whole indices only, at least one per call once the vertices are done
+    if (uploadedBytes >= vertexBytes && uploadedBytes < vertexBytes + indexBytes && maxBytes > 0) {
+        size_t firstIndex = (uploadedBytes - vertexBytes) / mesh.indexSize;
+        size_t count = std::min(std::max<size_t>(maxBytes / mesh.indexSize, 1), mesh.indices.size() - firstIndex);
+        size_t offset = allocation.indexUnitOffset * INDEX_UNIT_SIZE + firstIndex * mesh.indexSize;
+        if (mesh.indexSize == 2) {
+            std::vector<uint16_t> shortIndices(mesh.indices.begin() + firstIndex,
+                                               mesh.indices.begin() + firstIndex + count);
+            glNamedBufferSubData(pool.indexBuffer, offset, count * 2, shortIndices.data());
+        }
+        else {
+            glNamedBufferSubData(pool.indexBuffer, offset, count * 4, mesh.indices.data() + firstIndex);
+        }
+        uploadedBytes += count * mesh.indexSize;
+    }
+
+    return uploadedBytes >= vertexBytes + indexBytes;
+}
+
+void GeometryPool::free(GeometryHandle& handle) {
+    if (!handle.isValid() || handle.id >= allocations.size() || !allocations[handle.id].used) {
+        handle = {};
+        return;
+    }
+
+    Allocation& allocation = allocations[handle.id];
+    FormatPool& pool = pools[(size_t) allocation.format];
+    pool.vertices.free(allocation.vertexOffset, allocation.vertexCount);
+    pool.indices.free(allocation.indexUnitOffset, allocation.indexUnitCount);
+    pool.allocations--;
+
+    allocation.used = false;
+    freeIds.push_back(handle.id);
+    handle = {};
+}
+
+GeometryRange GeometryPool::getRange(GeometryHandle handle) const {
+    const Allocation& allocation = allocations[handle.id];
+    return {allocation.format, allocation.indexUnitOffset * INDEX_UNIT_SIZE, allocation.indexCount,
+            (int32_t) allocation.vertexOffset};
+}
+
+size_t GeometryPool::getSize(GeometryHandle handle) const {
+    if (!handle.isValid() || handle.id >= allocations.size()) return 0;
+
+    const Allocation& allocation = allocations[handle.id];
+    return allocation.vertexCount * pools[(size_t) allocation.format].stride +
+           allocation.indexUnitCount * INDEX_UNIT_SIZE;
+}
+
+unsigned int GeometryPool::getVertexArray(VertexFormat format) const {
+    return pools[(size_t) format].vertexArray;
+}
+
+void GeometryPool::defragment() {
+    if (!settings.defragment) return;
+
+    for (VertexFormat format : {VertexFormat::Float, VertexFormat::Quantized}) {
+        FormatPool& pool = pools[(size_t) format];
+        if (pool.vertexArray == 0) continue;
+
+        bool fragmented = pool.vertices.getHoleSize() > pool.vertices.getCapacity() * settings.maxHoleRatio ||
+                          pool.indices.getHoleSize() > pool.indices.getCapacity() * settings.maxHoleRatio;
+        if (fragmented) defragment(pool, format);
+    }
+}
+
+void GeometryPool::defragment(FormatPool& pool, VertexFormat format) {
+    std::vector<uint32_t> ids;
+    for (uint32_t id = 0; id < allocations.size(); id++) {
+        if (allocations[id].used && allocations[id].format == format) ids.push_back(id);
+    }
+
+    // Packed into fresh buffers with some room to grow, which also gives back what evicted meshes left over
+    size_t usedVertices = pool.vertices.getCapacity() - pool.vertices.getFreeSize();
+    size_t usedIndexUnits = pool.indices.getCapacity() - pool.indices.getFreeSize();
+    size_t vertexCapacity = std::clamp(usedVertices + usedVertices / 2, INITIAL_VERTEX_CAPACITY,
+                                       std::max(pool.vertices.getCapacity(), INITIAL_VERTEX_CAPACITY));
+    size_t indexUnitCapacity = std::clamp(usedIndexUnits + usedIndexUnits / 2, INITIAL_INDEX_UNIT_CAPACITY,
+                                          std::max(pool.indices.getCapacity(), INITIAL_INDEX_UNIT_CAPACITY));
+    unsigned int vertexBuffer = glutil::createBuffer(vertexCapacity * pool.stride, nullptr);
+    unsigned int indexBuffer = glutil::createBuffer(indexUnitCapacity * INDEX_UNIT_SIZE, nullptr);
+
+    // In buffer order, so meshes uploaded together stay next to each other
+    std::sort(ids.begin(), ids.end(), [&](uint32_t a, uint32_t b) {
+        return allocations[a].vertexOffset < allocations[b].vertexOffset;
+    });
+    size_t vertexOffset = 0;
+    for (uint32_t id : ids) {
+        Allocation& allocation = allocations[id];
+        glCopyNamedBufferSubData(pool.vertexBuffer, vertexBuffer, allocation.vertexOffset * pool.stride,
+                                 vertexOffset * pool.stride, allocation.vertexCount * pool.stride);
+        allocation.vertexOffset = vertexOffset;
+        vertexOffset += allocation.vertexCount;
+    }
+
+    std::sort(ids.begin(), ids.end(), [&](uint32_t a, uint32_t b) {
+        return allocations[a].indexUnitOffset < allocations[b].indexUnitOffset;
+    });
+    size_t indexUnitOffset = 0;
+    for (uint32_t id : ids) {
+        Allocation& allocation = allocations[id];
+        glCopyNamedBufferSubData(pool.indexBuffer, indexBuffer, allocation.indexUnitOffset * INDEX_UNIT_SIZE,
+                                 indexUnitOffset * INDEX_UNIT_SIZE, allocation.indexUnitCount * INDEX_UNIT_SIZE);
+        allocation.indexUnitOffset = indexUnitOffset;
+        indexUnitOffset += allocation.indexUnitCount;
+    }
+
+    glutil::deleteBuffer(pool.vertexBuffer);
+    glutil::deleteBuffer(pool.indexBuffer);
+    pool.vertexBuffer = vertexBuffer;
+    pool.indexBuffer = indexBuffer;
+    glVertexArrayVertexBuffer(pool.vertexArray, 0, pool.vertexBuffer, 0, pool.stride);
+    glVertexArrayElementBuffer(pool.vertexArray, pool.indexBuffer);
+
+    pool.vertices.reset(vertexOffset, vertexCapacity);
+    pool.indices.reset(indexUnitOffset, indexUnitCapacity);
+    pool.defragmentations++;
+}
+
+GeometryPoolStats GeometryPool::getStats(VertexFormat format) const {
+    const FormatPool& pool = pools[(size_t) format];
+    GeometryPoolStats stats;
+    stats.allocations = pool.allocations;
+    stats.vertexCapacity = pool.vertices.getCapacity() * pool.stride;
+    stats.vertexBytes = stats.vertexCapacity - pool.vertices.getFreeSize() * pool.stride;
+    stats.indexCapacity = pool.indices.getCapacity() * INDEX_UNIT_SIZE;
+    stats.indexBytes = stats.indexCapacity - pool.indices.getFreeSize() * INDEX_UNIT_SIZE;
+    stats.holeBytes = pool.vertices.getHoleSize() * pool.stride + pool.indices.getHoleSize() * INDEX_UNIT_SIZE;
+    stats.freeRanges = pool.vertices.getFreeRangeCount() + pool.indices.getFreeRangeCount();
+    stats.defragmentations = pool.defragmentations;
+    return stats;
+}
+
+size_t GeometryPool::getCapacityBytes() const {
+    size_t bytes = 0;
+    for (VertexFormat format : {VertexFormat::Float, VertexFormat::Quantized}) {
+        GeometryPoolStats stats = getStats(format);
+        bytes += stats.vertexCapacity + stats.indexCapacity;
+    }
+    return bytes;
+}
+
+size_t GeometryPool::getUsedBytes() const {
+    size_t bytes = 0;
+    for (VertexFormat format : {VertexFormat::Float, VertexFormat::Quantized}) {
+        GeometryPoolStats stats = getStats(format);
+        bytes += stats.vertexBytes + stats.indexBytes;
+    }
+    return bytes;
+}
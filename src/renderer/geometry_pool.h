@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "assets/mesh.h"
+#include "renderer/range_allocator.h"
+
+// Where a mesh's geometry ended up, indexOffset is in bytes into the index buffer of its format
+struct GeometryRange {
+    VertexFormat format = VertexFormat::Float;
+    size_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    int32_t baseVertex = 0;
+};
+
+struct GeometryPoolSettings {
+    bool defragment = true;
+    // Share of a buffer that may sit in holes between meshes before it gets compacted
+    float maxHoleRatio = 0.25f;
+};
+
+struct GeometryPoolStats {
+    size_t allocations = 0;
+    size_t vertexBytes = 0;
+    size_t vertexCapacity = 0;
+    size_t indexBytes = 0;
+    size_t indexCapacity = 0;
+    // Free space between meshes in both buffers, and in how many pieces
+    size_t holeBytes = 0;
+    size_t freeRanges = 0;
+    size_t defragmentations = 0;
+};
+
+// All mesh geometry of one vertex format in one vertex and one index buffer, drawn through a single VAO. Meshes
+// hold a handle instead of their own buffers; the ranges behind handles can move while compacting, so they're
+// looked up every draw. 16 and 32 bit indices share the index buffer, the draw picks the type. Buffers grow by
+// copying on the GPU and shrink again when compacted. GL thread only.
+class GeometryPool {
+public:
+    GeometryPool() = default;
+
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    // Uploads the packed vertices when the mesh has them and the float ones otherwise
+    GeometryHandle allocate(const Mesh& mesh);
+    // allocate in parts: allocateRange takes the mesh's range without filling it, and every upload call copies at
+    // most maxBytes more of the vertices and then the indices into it. uploadedBytes starts at 0 and carries over
+    // between calls, upload returns true once all of it is there. The range may move in between, it's looked up
+    // again every call.
+    GeometryHandle allocateRange(const Mesh& mesh);
+    bool upload(GeometryHandle handle, const Mesh& mesh, size_t& uploadedBytes, size_t maxBytes);
+    void free(GeometryHandle& handle);
+
+    GeometryRange getRange(GeometryHandle handle) const;
+    // Vertex and index bytes of the allocation
+    size_t getSize(GeometryHandle handle) const;
+    unsigned int getVertexArray(VertexFormat format) const;
+
+    // Compacts every buffer whose holes went over settings.maxHoleRatio
+    void defragment();
+
+    GeometryPoolStats getStats(VertexFormat format) const;
+    // Buffer storage of every format, and the part of it meshes use
+    size_t getCapacityBytes() const;
+    size_t getUsedBytes() const;
+
+    GeometryPoolSettings settings;
+
+private:
+    struct Allocation {
+        VertexFormat format;
+        // Vertices, and 4 byte units of the index buffer
+        size_t vertexOffset;
+        size_t vertexCount;
+        size_t indexUnitOffset;
+        size_t indexUnitCount;
+        uint32_t indexCount;
+        bool used = false;
+    };
+
+    struct FormatPool {
+        unsigned int vertexArray = 0;
+        unsigned int vertexBuffer = 0;
+        unsigned int indexBuffer = 0;
+        size_t stride = 0;
+        RangeAllocator vertices;
+        RangeAllocator indices;
+        size_t allocations = 0;
+        size_t defragmentations = 0;
+    };
+
+    FormatPool& getFormatPool(VertexFormat format);
+    void init(FormatPool& pool, VertexFormat format);
+    // Grows the buffers to at least the given capacities
+    void reserve(FormatPool& pool, size_t vertexCapacity, size_t indexUnitCapacity);
+    void defragment(FormatPool& pool, VertexFormat format);
+
+    FormatPool pools[2];
+    std::vector<Allocation> allocations;
+    std::vector<uint32_t> freeIds;
+};
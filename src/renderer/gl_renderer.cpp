@@ -1,7 +1,11 @@
 #include "gl_renderer.h"
+#include "assets/texture_registry.h"
 
 #include <SDL.h>
+#include <chrono>
 #include <future>
+#include <iostream>
+#include <iterator>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/string_cast.hpp>
 
@@ -20,6 +24,11 @@ void GLRenderer::subscribePrograms(UpdateListener& listener) {
 
 
 void GLRenderer::render(std::vector<Model>& objs) {
+    if (benchmarkRequested) {
+        benchmarkRequested = false;
+        measureFixedViews(objs);
+    }
+
     auto currentFrame = static_cast<float>(SDL_GetTicks());
     animationTime = (currentFrame - startTime) / 1000.0f;
 
@@ -28,6 +37,11 @@ void GLRenderer::render(std::vector<Model>& objs) {
     auto model = glm::mat4(1.0f);
 
     checkFrustum(objs);
+    textureStreamer.setReservedBytes(materialTable.getStats().arrayBytes);
+    textureStreamer.update(objs, *camera, windowSize, uploadRing);
+    residencyManager.update(objs, *camera, textureStreamer, geometryPool);
+    materialTable.update(textureStreamer);
+    geometryPool.defragment();
 
     glClearColor(1.0, 0.0, 0.0, 1.0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
@@ -38,6 +52,8 @@ void GLRenderer::render(std::vector<Model>& objs) {
     starterPipeline.setMat4("view", view);
     starterPipeline.setMat4("projection", proj);
     screenQuad.draw();
+
+    uploadRing.fence();
 }
 
 void GLRenderer::renderScene(std::vector<Model>& objs, Shader& shader, bool skipTextures) {
@@ -55,9 +71,173 @@ void GLRenderer::renderScene(std::vector<Model>& objs, Shader& shader, bool skip
     glDrawArrays(GL_TRIANGLES, 0, 6);
 }
 
+void GLRenderer::measureFixedViews(std::vector<Model>& objs) {
+    struct View {
+        glm::vec3 position;
+        float yaw, pitch;
+    };
+    const View views[] = {
+        { glm::vec3(0.0f, 5.0f, 5.0f), YAW, PITCH },
+        { glm::vec3(-110.0f, 15.0f, -5.0f), 0.0f, 0.0f },
+        { glm::vec3(110.0f, 60.0f, 0.0f), 180.0f, -20.0f },
+        { glm::vec3(0.0f, 10.0f, -40.0f), 90.0f, 10.0f }
+    };
+    constexpr int WARMUP_FRAMES = 5;
+    constexpr int MEASURED_FRAMES = 30;
+
+    glm::vec3 savedPosition = camera->Position;
+    float savedYaw = camera->Yaw, savedPitch = camera->Pitch;
+    bool savedLods = lodSettings.enabled;
+    SubmissionMode savedMode = submissionMode;
+
+    auto drawFrame = [&]() {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        starterPipeline.use();
+        starterPipeline.setMat4("view", camera->getViewMatrix());
+        starterPipeline.setMat4("projection", camera->getProjectionMatrix());
+        renderScene(objs, starterPipeline, false);
+    };
+
+    for (int i = 0; i < std::size(views); i++) {
+        camera->Position = views[i].position;
+        camera->Yaw = views[i].yaw;
+        camera->Pitch = views[i].pitch;
+        camera->processMouseMovement(0.0f, 0.0f);
+
+        for (bool useLods : { false, true }) {
+            for (SubmissionMode mode : { SubmissionMode::Direct, SubmissionMode::MultiDrawIndirect }) {
+                lodSettings.enabled = useLods;
+                submissionMode = mode;
+                // Lets the hysteresis settle on the levels for this view
+                for (int frame = 0; frame < WARMUP_FRAMES; frame++) drawFrame();
+                glFinish();
+
+                auto startTime = std::chrono::high_resolution_clock::now();
+                for (int frame = 0; frame < MEASURED_FRAMES; frame++) drawFrame();
+                glFinish();
+                auto endTime = std::chrono::high_resolution_clock::now();
+                double frameTime =
+                    std::chrono::duration<double, std::milli>(endTime - startTime).count() / MEASURED_FRAMES;
+
+                std::cout << "View " << i << (useLods ? " with LODs" : " without LODs")
+                          << (mode == SubmissionMode::Direct ? ", direct: " : ", indirect: ") << renderStats.triangles
+                          << " triangles, " << renderStats.drawCalls << " draws, " << frameTime << " ms\n";
+            }
+        }
+    }
+
+    camera->Position = savedPosition;
+    camera->Yaw = savedYaw;
+    camera->Pitch = savedPitch;
+    camera->processMouseMovement(0.0f, 0.0f);
+    lodSettings.enabled = savedLods;
+    submissionMode = savedMode;
+}
+
 void GLRenderer::handleImGui() {
     ImGuiIO& io = ImGui::GetIO();
 
     if (ImGui::CollapsingHeader("Start Here")) {
     }
+
+    if (ImGui::CollapsingHeader("Culling")) {
+        ImGui::Checkbox("Cluster culling", &useClusterCulling);
+        ImGui::Checkbox("Cone culling", &useConeCulling);
+        ImGui::Text("Meshlets: %zu, frustum culled: %zu, cone culled: %zu", clusterStats.meshlets,
+                    clusterStats.frustumCulled, clusterStats.coneCulled);
+    }
+
+    if (ImGui::CollapsingHeader("Level of detail")) {
+        ImGui::Checkbox("Use LODs", &lodSettings.enabled);
+        ImGui::SliderFloat("Pixel error", &lodSettings.pixelThreshold, 0.25f, 8.0f);
+        ImGui::SliderFloat("Hysteresis", &lodSettings.hysteresis, 0.0f, 0.9f);
+        ImGui::Text("Triangles: %zu, draws: %zu, frame: %.2f ms", renderStats.triangles, renderStats.drawCalls,
+                    1000.0f / io.Framerate);
+        if (ImGui::Button("Measure fixed views")) benchmarkRequested = true;
+    }
+
+    if (ImGui::CollapsingHeader("Submission")) {
+        int mode = (int) submissionMode;
+        ImGui::RadioButton("Direct", &mode, (int) SubmissionMode::Direct);
+        ImGui::SameLine();
+        ImGui::RadioButton("Multi-draw indirect", &mode, (int) SubmissionMode::MultiDrawIndirect);
+        submissionMode = (SubmissionMode) mode;
+        ImGui::Text("Draw calls: %zu, indirect commands: %zu", renderStats.drawCalls, renderStats.indirectCommands);
+    }
+
+    if (ImGui::CollapsingHeader("Materials")) {
+        ImGui::Checkbox("Material table", &materialTable.enabled);
+        MaterialTableStats tableStats = materialTable.getStats();
+        bool isBindless = materialTable.getMode() == MaterialTableMode::Bindless;
+        ImGui::Text("%s: %zu materials, %zu textures", isBindless ? "Bindless handles" : "Texture arrays",
+                    tableStats.materials, tableStats.textures);
+        if (!isBindless) {
+            ImGui::Text("Arrays: %zu of %u, %.1f MB", tableStats.arrays, MAX_MATERIAL_ARRAYS,
+                        tableStats.arrayBytes / 1e6);
+        }
+        ImGui::Text("Materials bound per draw: %zu", renderStats.materialBinds);
+    }
+
+    if (ImGui::CollapsingHeader("Textures")) {
+        assets::TextureRegistryStats textureStats = assets::TextureRegistry::shared().getStats();
+        ImGui::Text("Unique: %zu, references: %zu", textureStats.textures, textureStats.references);
+        ImGui::Text("Size: %.1f MB, saved by sharing: %.1f MB", textureStats.bytes / 1e6,
+                    textureStats.sharedBytes / 1e6);
+    }
+
+    if (ImGui::CollapsingHeader("Texture streaming")) {
+        TextureStreamingSettings& settings = textureStreamer.settings;
+        ImGui::Checkbox("Stream mip levels", &settings.enabled);
+        int budgetMegabytes = (int) (settings.memoryBudget >> 20);
+        if (ImGui::SliderInt("Budget (MB)", &budgetMegabytes, 16, 2048)) {
+            settings.memoryBudget = size_t(budgetMegabytes) << 20;
+        }
+        ImGui::SliderFloat("Level bias", &settings.levelBias, -2.0f, 4.0f);
+
+        TextureStreamingStats streamingStats = textureStreamer.getStats();
+        ImGui::Text("Textures: %zu, missing detail: %zu, pending levels: %zu", streamingStats.textures,
+                    streamingStats.starvedTextures, streamingStats.pendingLevels);
+        ImGui::Text("Resident: %.1f MB, material arrays: %.1f MB", streamingStats.residentBytes / 1e6,
+                    streamingStats.reservedBytes / 1e6);
+        ImGui::Text("Streamed %zu levels, evicted %zu", streamingStats.streamedLevels, streamingStats.evictedLevels);
+
+        UploadRingStats ringStats = uploadRing.getStats();
+        ImGui::Text("Upload ring: %.1f of %.1f MB in use, %.1f MB uploaded, %zu from client memory",
+                    ringStats.usedBytes / 1e6, ringStats.capacity / 1e6, ringStats.uploadedBytes / 1e6,
+                    ringStats.fallbacks);
+    }
+
+    if (ImGui::CollapsingHeader("Geometry pool")) {
+        ImGui::Checkbox("Defragment", &geometryPool.settings.defragment);
+        ImGui::SliderFloat("Max hole ratio", &geometryPool.settings.maxHoleRatio, 0.05f, 0.9f);
+        for (VertexFormat format : { VertexFormat::Float, VertexFormat::Quantized }) {
+            GeometryPoolStats poolStats = geometryPool.getStats(format);
+            ImGui::Text("%s: %zu meshes, defragmented %zu times", format == VertexFormat::Float ? "Float" : "Quantized",
+                        poolStats.allocations, poolStats.defragmentations);
+            ImGui::Text("  Vertices: %.1f of %.1f MB, indices: %.1f of %.1f MB", poolStats.vertexBytes / 1e6,
+                        poolStats.vertexCapacity / 1e6, poolStats.indexBytes / 1e6, poolStats.indexCapacity / 1e6);
+            ImGui::Text("  Holes: %.1f MB in %zu free ranges", poolStats.holeBytes / 1e6, poolStats.freeRanges);
+        }
+    }
+
+    if (ImGui::CollapsingHeader("GPU memory")) {
+        ResidencySettings& settings = residencyManager.settings;
+        ImGui::Checkbox("Evict unseen resources", &settings.enabled);
+        bool keepCpuGeometry = settings.cpuGeometry == CpuGeometryPolicy::Keep;
+        if (ImGui::Checkbox("Keep CPU geometry after upload", &keepCpuGeometry)) {
+            settings.cpuGeometry = keepCpuGeometry ? CpuGeometryPolicy::Keep : CpuGeometryPolicy::ReleaseAfterUpload;
+        }
+        int budgetMegabytes = (int) (settings.memoryBudget >> 20);
+        if (ImGui::SliderInt("Memory budget (MB)", &budgetMegabytes, 64, 8192)) {
+            settings.memoryBudget = size_t(budgetMegabytes) << 20;
+        }
+
+        ResidencyStats residencyStats = residencyManager.getStats();
+        ImGui::Text("Textures: %.1f MB, buffers: %.1f MB", residencyStats.textureBytes / 1e6,
+                    residencyStats.bufferBytes / 1e6);
+        ImGui::Text("Evicted meshes: %zu, reloading: %zu", residencyStats.evictedMeshes,
+                    residencyStats.pendingReloads);
+        ImGui::Text("CPU geometry: %.1f MB", residencyStats.cpuGeometryBytes / 1e6);
+        ImGui::Text("Evictions: %zu, reloads: %zu", residencyStats.evictions, residencyStats.reloads);
+    }
 }
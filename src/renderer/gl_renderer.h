@@ -15,5 +15,11 @@ private:
 
     Shader starterPipeline;
 
+    // Set from the UI, runs at the start of the next frame
+    bool benchmarkRequested = false;
+
     void renderScene(std::vector<Model>& objs, Shader& shader, bool skipTextures);
+    // Prints triangle counts and frame times with LODs off and on, drawn directly and indirectly, from a few fixed
+    // views of Sponza
+    void measureFixedViews(std::vector<Model>& objs);
 };
\ No newline at end of file
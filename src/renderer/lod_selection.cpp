@@ -0,0 +1,35 @@
+#include "lod_selection.h"
+
+#include <algorithm>
+#include <cmath>
+
+float getProjectionScale(float fovY, float viewportHeight) {
+    return viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+}
+
+float getProjectedError(float worldError, float distance, float projectionScale) {
+    return worldError / std::max(distance, 1e-4f) * projectionScale;
+}
+
+unsigned int selectLod(const std::vector<MeshLod>& lods, unsigned int currentLod, float scale, float distance,
+                       float projectionScale, const LodSettings& settings) {
+    if (!settings.enabled || lods.size() <= 1) return 0;
+    currentLod = std::min(currentLod, (unsigned int) lods.size() - 1);
+
+    auto projectedError = [&](unsigned int level) {
+        return getProjectedError(lods[level].error * scale, distance, projectionScale);
+    };
+
+    // Errors grow with every level, so the last one under the threshold is the coarsest acceptable
+    unsigned int target = 0;
+    for (unsigned int level = 1; level < lods.size(); level++) {
+        if (projectedError(level) <= settings.pixelThreshold) target = level;
+    }
+
+    // Refining happens right away, coarsening waits until the error is clearly small enough
+    float coarsenThreshold = settings.pixelThreshold * (1.0f - settings.hysteresis);
+    while (target > currentLod && projectedError(target) > coarsenThreshold) {
+        target--;
+    }
+    return target;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <vector>
+
+#include "assets/mesh.h"
+
+struct LodSettings {
+    bool enabled = true;
+    // Largest error on screen a level can have, in pixels
+    float pixelThreshold = 1.0f;
+    // A coarser level is only switched to once its error is this much under the threshold
+    float hysteresis = 0.25f;
+};
+
+// Pixels covered by one world unit at distance 1, for a viewport `viewportHeight` pixels tall
+float getProjectionScale(float fovY, float viewportHeight);
+float getProjectedError(float worldError, float distance, float projectionScale);
+
+// Coarsest level whose projected error stays under the threshold, with hysteresis against `currentLod`.
+// `scale` takes the mesh space errors to world space.
+unsigned int selectLod(const std::vector<MeshLod>& lods, unsigned int currentLod, float scale, float distance,
+                       float projectionScale, const LodSettings& settings);
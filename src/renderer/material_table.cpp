@@ -0,0 +1,307 @@
+#include "material_table.h"
+
+#include <SDL.h>
+#include <algorithm>
+#include <iostream>
+
+#include "renderer/texture_streamer.h"
+#include "utils/functions.h"
+
+static_assert(sizeof(MaterialEntry) == 64, "MaterialEntry has to match its std430 layout");
+
+namespace {
+// glad was generated without GL_ARB_bindless_texture, its entry points are loaded by hand
+typedef GLuint64 (APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+
+PFNGLGETTEXTUREHANDLEARBPROC getTextureHandle = nullptr;
+PFNGLMAKETEXTUREHANDLERESIDENTARBPROC makeTextureHandleResident = nullptr;
+PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC makeTextureHandleNonResident = nullptr;
+
+constexpr int INITIAL_ARRAY_LAYERS = 4;
+}
+
+int getMaterialTextureSlot(const std::string& type) {
+    if (type == "texture_diffuse") return 0;
+    if (type == "texture_normal") return 1;
+    if (type == "texture_metallic") return 2;
+    if (type == "texture_roughness") return 3;
+    if (type == "texture_ao") return 4;
+    return -1;
+}
+
+void MaterialTable::init(bool bindlessSupported) {
+    mode = MaterialTableMode::TextureArrays;
+    if (!bindlessSupported) return;
+
+    getTextureHandle = (PFNGLGETTEXTUREHANDLEARBPROC) SDL_GL_GetProcAddress("glGetTextureHandleARB");
+    makeTextureHandleResident =
+        (PFNGLMAKETEXTUREHANDLERESIDENTARBPROC) SDL_GL_GetProcAddress("glMakeTextureHandleResidentARB");
+    makeTextureHandleNonResident =
+        (PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC) SDL_GL_GetProcAddress("glMakeTextureHandleNonResidentARB");
+    if (getTextureHandle == nullptr || makeTextureHandleResident == nullptr ||
+        makeTextureHandleNonResident == nullptr) {
+        std::cout << "Failed to load the bindless texture functions, materials use texture arrays" << std::endl;
+        return;
+    }
+    mode = MaterialTableMode::Bindless;
+}
+
+void MaterialTable::add(Material& material, const TextureStreamer& streamer) {
+    if (material.tableIndex >= 0) return;
+
+    MaterialEntry entry{};
+    std::vector<unsigned int> acquired;
+    for (const Texture& texture : material.textures) {
+        int slot = getMaterialTextureSlot(texture.type);
+        if (slot < 0 || (entry.presentSlots & (1u << slot))) continue;
+
+        if (!acquireTexture(texture.id, streamer.getResidentLevel(texture.id), entry.textures[slot])) {
+            for (unsigned int id : acquired) releaseTexture(id);
+            return;
+        }
+        acquired.push_back(texture.id);
+        entry.presentSlots |= 1u << slot;
+        // A texture other materials already use may lag behind the streamer until the next update
+        entry.minLods[slot] = (float) textures[texture.id].residentLevel;
+    }
+
+    uint32_t index;
+    if (!freeEntries.empty()) {
+        index = freeEntries.back();
+        freeEntries.pop_back();
+        entries[index] = entry;
+    }
+    else {
+        index = (uint32_t) entries.size();
+        entries.push_back(entry);
+    }
+    material.tableIndex = (int) index;
+    dirty = true;
+}
+
+void MaterialTable::remove(Material& material) {
+    if (material.tableIndex < 0) return;
+
+    uint32_t presentSlots = 0;
+    for (const Texture& texture : material.textures) {
+        int slot = getMaterialTextureSlot(texture.type);
+        if (slot < 0 || (presentSlots & (1u << slot))) continue;
+
+        releaseTexture(texture.id);
+        presentSlots |= 1u << slot;
+    }
+
+    entries[material.tableIndex] = {};
+    freeEntries.push_back((uint32_t) material.tableIndex);
+    material.tableIndex = -1;
+    dirty = true;
+}
+
+void MaterialTable::update(const TextureStreamer& streamer) {
+    for (auto& [id, textureReference] : textures) {
+        int residentLevel = streamer.getResidentLevel(id);
+        if (residentLevel == textureReference.residentLevel) continue;
+
+        // Table textures have immutable storage, which the streamer never evicts, so levels only ever get added
+        if (textureReference.array >= 0 && residentLevel < textureReference.residentLevel) {
+            copyLevels(id, textureReference, residentLevel, textureReference.residentLevel);
+        }
+        textureReference.residentLevel = residentLevel;
+
+        for (MaterialEntry& entry : entries) {
+            for (unsigned int slot = 0; slot < MATERIAL_TEXTURE_SLOTS; slot++) {
+                if ((entry.presentSlots & (1u << slot)) && entry.textures[slot][0] == textureReference.reference[0] &&
+                    entry.textures[slot][1] == textureReference.reference[1]) {
+                    entry.minLods[slot] = (float) residentLevel;
+                    dirty = true;
+                }
+            }
+        }
+    }
+}
+
+void MaterialTable::bind(Shader& shader) const {
+    if (dirty && !entries.empty()) {
+        size_t size = entries.size() * sizeof(MaterialEntry);
+        if (size > bufferCapacity) {
+            bufferCapacity = std::max<size_t>(bufferCapacity, 4096);
+            while (bufferCapacity < size) bufferCapacity *= 2;
+            if (buffer != 0) glutil::deleteBuffer(buffer);
+            buffer = glutil::createBuffer(bufferCapacity, nullptr);
+        }
+        glNamedBufferSubData(buffer, 0, size, entries.data());
+        dirty = false;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_TABLE_BINDING, buffer);
+    shader.setBool("bindlessMaterials", mode == MaterialTableMode::Bindless);
+    // The shaders declare the array samplers with their units
+    for (unsigned int i = 0; i < arrays.size(); i++) {
+        glBindTextureUnit(MATERIAL_ARRAY_FIRST_UNIT + i, arrays[i].id);
+    }
+}
+
+MaterialTableStats MaterialTable::getStats() const {
+    MaterialTableStats stats;
+    stats.materials = entries.size() - freeEntries.size();
+    stats.textures = textures.size();
+    stats.arrays = arrays.size();
+    for (const TextureArray& array : arrays) {
+        stats.arrayBytes += array.layerSize * array.capacity;
+    }
+    return stats;
+}
+
+bool MaterialTable::acquireTexture(unsigned int id, int residentLevel, uint32_t reference[2]) {
+    auto found = textures.find(id);
+    if (found == textures.end()) {
+        // Textures streamed into mutable storage report no immutable levels, their levels can't be shared
+        GLint immutableLevels = 0;
+        glGetTextureParameteriv(id, GL_TEXTURE_IMMUTABLE_LEVELS, &immutableLevels);
+        if (immutableLevels == 0) return false;
+
+        TextureReference textureReference;
+        textureReference.residentLevel = residentLevel;
+        if (mode == MaterialTableMode::Bindless) {
+            if (!createView(id, textureReference)) return false;
+        }
+        else if (!copyToArray(id, textureReference)) {
+            return false;
+        }
+        found = textures.emplace(id, textureReference).first;
+    }
+
+    found->second.users++;
+    reference[0] = found->second.reference[0];
+    reference[1] = found->second.reference[1];
+    return true;
+}
+
+void MaterialTable::releaseTexture(unsigned int id) {
+    auto found = textures.find(id);
+    if (found == textures.end() || --found->second.users > 0) return;
+
+    // The handle goes away with its view, the view doesn't own any memory of its own
+    if (found->second.handle != 0) {
+        makeTextureHandleNonResident(found->second.handle);
+        glDeleteTextures(1, &found->second.view);
+    }
+    if (found->second.array >= 0) {
+        TextureArray& array = arrays[found->second.array];
+        array.freeLayers.push_back(found->second.layer);
+        array.usedLayers--;
+    }
+    textures.erase(found);
+}
+
+bool MaterialTable::createView(unsigned int id, TextureReference& textureReference) {
+    GLint levels, internalFormat;
+    glGetTextureParameteriv(id, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+    glGetTextureLevelParameteriv(id, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+
+    // Taking a handle freezes the state of the texture it's taken from, the view takes that instead. Views start
+    // with default sampling state, it's copied over.
+    unsigned int view;
+    glGenTextures(1, &view);
+    glTextureView(view, GL_TEXTURE_2D, id, internalFormat, 0, levels, 0, 1);
+    for (GLenum parameter : { GL_TEXTURE_MIN_FILTER, GL_TEXTURE_MAG_FILTER, GL_TEXTURE_WRAP_S, GL_TEXTURE_WRAP_T }) {
+        GLint value;
+        glGetTextureParameteriv(id, parameter, &value);
+        glTextureParameteri(view, parameter, value);
+    }
+
+    GLuint64 handle = getTextureHandle(view);
+    if (handle == 0) {
+        glDeleteTextures(1, &view);
+        return false;
+    }
+    makeTextureHandleResident(handle);
+
+    textureReference.view = view;
+    textureReference.handle = handle;
+    textureReference.reference[0] = (uint32_t) handle;
+    textureReference.reference[1] = (uint32_t) (handle >> 32);
+    return true;
+}
+
+bool MaterialTable::copyToArray(unsigned int id, TextureReference& textureReference) {
+    GLint width, height, internalFormat, levels;
+    glGetTextureLevelParameteriv(id, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTextureLevelParameteriv(id, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTextureLevelParameteriv(id, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+    glGetTextureParameteriv(id, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+
+    auto matches = [&](const TextureArray& array) {
+        return array.width == width && array.height == height && array.levels == levels &&
+               array.internalFormat == internalFormat;
+    };
+    auto found = std::find_if(arrays.begin(), arrays.end(), matches);
+    if (found == arrays.end()) {
+        if (arrays.size() == MAX_MATERIAL_ARRAYS) return false;
+
+        TextureArray& array = arrays.emplace_back();
+        array.width = width;
+        array.height = height;
+        array.levels = levels;
+        array.internalFormat = internalFormat;
+        array.layerSize = glutil::getTextureSize(id);
+        found = std::prev(arrays.end());
+    }
+
+    TextureArray& array = *found;
+    int layer;
+    if (!array.freeLayers.empty()) {
+        layer = array.freeLayers.back();
+        array.freeLayers.pop_back();
+    }
+    else {
+        if (array.usedLayers == array.capacity) growArray(array);
+        layer = array.usedLayers;
+    }
+    array.usedLayers++;
+
+    textureReference.array = (int) (found - arrays.begin());
+    textureReference.layer = layer;
+    textureReference.reference[0] = (uint32_t) textureReference.array;
+    textureReference.reference[1] = (uint32_t) layer;
+    // Levels the streamer hasn't filled yet are left undefined, minLods keeps them from being sampled
+    copyLevels(id, textureReference, textureReference.residentLevel, levels);
+    return true;
+}
+
+void MaterialTable::copyLevels(unsigned int id, const TextureReference& textureReference, int firstLevel,
+                               int lastLevel) {
+    const TextureArray& array = arrays[textureReference.array];
+    for (int level = firstLevel; level < lastLevel; level++) {
+        glCopyImageSubData(id, GL_TEXTURE_2D, level, 0, 0, 0, array.id, GL_TEXTURE_2D_ARRAY, level, 0, 0,
+                           textureReference.layer, std::max(array.width >> level, 1),
+                           std::max(array.height >> level, 1), 1);
+    }
+}
+
+void MaterialTable::growArray(TextureArray& array) {
+    int capacity = std::max(array.capacity * 2, INITIAL_ARRAY_LAYERS);
+
+    unsigned int grown;
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &grown);
+    glTextureStorage3D(grown, array.levels, array.internalFormat, array.width, array.height, capacity);
+    glutil::trackTexture(grown, array.layerSize * capacity);
+    glTextureParameteri(grown, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(grown, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureParameteri(grown, GL_TEXTURE_MIN_FILTER, array.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTextureParameteri(grown, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    if (array.id != 0) {
+        for (int level = 0; level < array.levels; level++) {
+            glCopyImageSubData(array.id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, grown, GL_TEXTURE_2D_ARRAY, level,
+                               0, 0, 0, std::max(array.width >> level, 1), std::max(array.height >> level, 1),
+                               array.capacity);
+        }
+        glutil::deleteTextures({ array.id });
+    }
+
+    array.id = grown;
+    array.capacity = capacity;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "utils/material.h"
+
+class TextureStreamer;
+
+// Where the shaders find the table, and the texture arrays when there are no bindless handles
+constexpr unsigned int MATERIAL_TABLE_BINDING = 5;
+constexpr unsigned int MATERIAL_ARRAY_FIRST_UNIT = 8;
+constexpr unsigned int MAX_MATERIAL_ARRAYS = 8;
+constexpr unsigned int MATERIAL_TEXTURE_SLOTS = 5;
+
+// Texture types the table has a slot for, in slot order: diffuse, normal, metallic, roughness and ao
+int getMaterialTextureSlot(const std::string& type);
+
+// A material as the shaders read it, std430. A slot holds a bindless handle split into two halves, or the index of
+// a texture array and the layer in it, and has its bit set in presentSlots when the material has that texture.
+// minLods holds the finest level of each slot with pixels in it, the shaders never sample above it.
+struct MaterialEntry {
+    uint32_t textures[MATERIAL_TEXTURE_SLOTS][2];
+    uint32_t presentSlots;
+    float minLods[MATERIAL_TEXTURE_SLOTS];
+};
+
+enum class MaterialTableMode {
+    Bindless,
+    TextureArrays
+};
+
+struct MaterialTableStats {
+    size_t materials = 0;
+    size_t textures = 0;
+    size_t arrays = 0;
+    size_t arrayBytes = 0;
+};
+
+// Every material the shaders can sample without the CPU binding anything, in one SSBO indexed by
+// Material::tableIndex. With GL_ARB_bindless_texture the entries hold resident texture handles; otherwise textures
+// are copied into arrays of the same size, level count and format, at most MAX_MATERIAL_ARRAYS of them, which then
+// get bound once per pass. Only textures with immutable storage go in the table, streamed ones included when they
+// were created with their whole chain: handles are taken from a view of the texture, so the streamer can still move
+// the texture's own base level, and update copies newly streamed levels into the array layers. Either way the
+// streamed level ends up in the entry's minLods. Materials using any other texture keep a tableIndex of -1 and their
+// textures get bound per draw as before. GL thread only, GL objects are left to the context.
+class MaterialTable {
+public:
+    MaterialTable() = default;
+
+    MaterialTable(const MaterialTable&) = delete;
+    MaterialTable& operator=(const MaterialTable&) = delete;
+
+    // Once the context exists and before anything is added, falls back to texture arrays when the bindless entry
+    // points can't be loaded
+    void init(bool bindlessSupported);
+
+    // Once the material's textures are uploaded, sets material.tableIndex when the table can hold all of them
+    void add(Material& material, const TextureStreamer& streamer);
+    // Before the material's textures can be deleted
+    void remove(Material& material);
+    // Once per frame after the streamer, follows the levels it streamed in or evicted since the last call
+    void update(const TextureStreamer& streamer);
+
+    // Uploads the entries changed since the last call and binds the table, and the arrays, for shader
+    void bind(Shader& shader) const;
+
+    MaterialTableMode getMode() const { return mode; }
+    MaterialTableStats getStats() const;
+
+    // Off makes drawModels bind every material's textures again, for comparing the two
+    bool enabled = true;
+
+private:
+    struct TextureReference {
+        uint32_t reference[2];
+        size_t users = 0;
+        // Finest level with pixels in it, as far as the table knows
+        int residentLevel = 0;
+        // Bindless only, the handle belongs to the view
+        GLuint64 handle = 0;
+        unsigned int view = 0;
+        // Texture arrays only
+        int array = -1;
+        int layer = -1;
+    };
+
+    struct TextureArray {
+        unsigned int id = 0;
+        int width = 0;
+        int height = 0;
+        int levels = 0;
+        GLint internalFormat = 0;
+        int capacity = 0;
+        int usedLayers = 0;
+        std::vector<int> freeLayers;
+        // Of one layer, what the source textures take
+        size_t layerSize = 0;
+    };
+
+    // False when the texture can't go in the table, otherwise it holds one more user
+    bool acquireTexture(unsigned int id, int residentLevel, uint32_t reference[2]);
+    void releaseTexture(unsigned int id);
+    bool createView(unsigned int id, TextureReference& textureReference);
+    bool copyToArray(unsigned int id, TextureReference& textureReference);
+    // Levels [firstLevel, lastLevel) of the texture into its layer
+    void copyLevels(unsigned int id, const TextureReference& textureReference, int firstLevel, int lastLevel);
+    // Grows the array by copying its layers into a larger one
+    void growArray(TextureArray& array);
+
+    MaterialTableMode mode = MaterialTableMode::TextureArrays;
+
+    std::vector<MaterialEntry> entries;
+    std::vector<uint32_t> freeEntries;
+    std::unordered_map<unsigned int, TextureReference> textures;
+    std::vector<TextureArray> arrays;
+
+    // Uploaded lazily by bind
+    mutable unsigned int buffer = 0;
+    mutable size_t bufferCapacity = 0;
+    mutable bool dirty = false;
+};
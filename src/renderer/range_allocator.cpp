@@ -0,0 +1,64 @@
+#include "range_allocator.h"
+
+#include <iterator>
+
+bool RangeAllocator::allocate(size_t size, size_t& offset) {
+    auto best = freeRanges.end();
+    for (auto iterator = freeRanges.begin(); iterator != freeRanges.end(); iterator++) {
+        if (iterator->second >= size && (best == freeRanges.end() || iterator->second < best->second)) {
+            best = iterator;
+            if (best->second == size) break;
+        }
+    }
+    if (best == freeRanges.end()) return false;
+
+    offset = best->first;
+    size_t remaining = best->second - size;
+    freeRanges.erase(best);
+    if (remaining > 0) freeRanges[offset + size] = remaining;
+    freeSize -= size;
+    return true;
+}
+
+void RangeAllocator::free(size_t offset, size_t size) {
+    if (size == 0) return;
+
+    auto inserted = freeRanges.emplace(offset, size).first;
+    freeSize += size;
+
+    auto next = std::next(inserted);
+    if (next != freeRanges.end() && inserted->first + inserted->second == next->first) {
+        inserted->second += next->second;
+        freeRanges.erase(next);
+    }
+    if (inserted != freeRanges.begin()) {
+        auto previous = std::prev(inserted);
+        if (previous->first + previous->second == inserted->first) {
+            previous->second += inserted->second;
+            freeRanges.erase(inserted);
+        }
+    }
+}
+
+void RangeAllocator::grow(size_t newCapacity) {
+    if (newCapacity <= capacity) return;
+
+    size_t oldCapacity = capacity;
+    capacity = newCapacity;
+    free(oldCapacity, newCapacity - oldCapacity);
+}
+
+void RangeAllocator::reset(size_t used, size_t newCapacity) {
+    freeRanges.clear();
+    capacity = newCapacity;
+    freeSize = newCapacity - used;
+    if (freeSize > 0) freeRanges[used] = freeSize;
+}
+
+size_t RangeAllocator::getHoleSize() const {
+    if (freeRanges.empty()) return 0;
+
+    auto last = std::prev(freeRanges.end());
+    bool endsAtCapacity = last->first + last->second == capacity;
+    return freeSize - (endsAtCapacity ? last->second : 0);
+}
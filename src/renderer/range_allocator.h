@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+
+// Hands out ranges of a linear space, sizes and offsets are in whatever unit the owner picks. Free ranges are kept
+// sorted by offset and merged with their neighbours as soon as they're freed.
+class RangeAllocator {
+public:
+    // Best fit, so large free ranges stay around for large meshes. False when no free range is large enough.
+    bool allocate(size_t size, size_t& offset);
+    void free(size_t offset, size_t size);
+    // Adds free space at the end
+    void grow(size_t capacity);
+    // Everything below used is allocated and the rest up to capacity is free, what compacting leaves behind
+    void reset(size_t used, size_t capacity);
+
+    size_t getCapacity() const { return capacity; }
+    size_t getFreeSize() const { return freeSize; }
+    size_t getFreeRangeCount() const { return freeRanges.size(); }
+    // Free space with allocations after it, what compacting would merge into the end
+    size_t getHoleSize() const;
+
+private:
+    // Offset to size
+    std::map<size_t, size_t> freeRanges;
+    size_t capacity = 0;
+    size_t freeSize = 0;
+};
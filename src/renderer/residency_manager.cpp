@@ -0,0 +1,226 @@
+#include "residency_manager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "assets/asset_pack.h"
+#include "utils/functions.h"
+#include "utils/thread_pool.h"
+
+namespace {
+Mesh readMeshEntry(const std::string& packPath, const PackLocation& location, size_t meshIndex) {
+    assets::PackFile pack;
+    if (!pack.open(packPath)) return {};
+
+    assets::AssetFileView file;
+    if (pack.getEntryView(location, file) && memcmp(file.type, "MESH", 4) == 0) {
+        return AssetConverter().convertBinaryToMesh(file);
+    }
+
+    // Meshes that don't know their entry, or whose entry a rebake has moved since
+    for (const assets::PackEntry& entry : pack.getEntries()) {
+        if (assets::isEntryType(entry, "MESH") && entry.index == meshIndex && pack.getEntryView(entry, file)) {
+            return AssetConverter().convertBinaryToMesh(file);
+        }
+    }
+    return {};
+}
+
+bool hasGeometry(const Mesh& mesh) {
+    return !mesh.indices.empty() && (!mesh.packedVertices.empty() || !mesh.vertices.empty());
+}
+
+bool isResident(const Mesh& mesh) {
+    return mesh.geometry.isValid();
+}
+
+size_t getGeometrySize(const Mesh& mesh) {
+    return mesh.vertices.capacity() * sizeof(Vertex) + mesh.packedVertices.capacity() * sizeof(PackedVertex) +
+           mesh.indices.capacity() * sizeof(unsigned int);
+}
+}
+
+ResidencyManager::~ResidencyManager() {
+    for (PendingMesh& pending : pendingMeshes) {
+        pending.mesh.wait();
+    }
+}
+
+void ResidencyManager::update(std::vector<Model>& models, Camera& camera, TextureStreamer& streamer,
+                              GeometryPool& geometryPool) {
+    frame++;
+    finishReloads(models, geometryPool);
+    if (settings.enabled) {
+        markVisible(models, camera);
+        reloadMeshes(models, geometryPool);
+        evict(models, streamer, geometryPool);
+    }
+
+    evictedMeshes = 0;
+    cpuGeometryBytes = 0;
+    for (const Model& model : models) {
+        for (const Mesh& mesh : model.meshes) {
+            evictedMeshes += !isResident(mesh);
+            cpuGeometryBytes += getGeometrySize(mesh);
+        }
+    }
+}
+
+void ResidencyManager::releaseGeometry(const Model& model, Mesh& mesh) const {
+    if (settings.cpuGeometry != CpuGeometryPolicy::ReleaseAfterUpload || model.packPath.empty() ||
+        !isResident(mesh)) {
+        return;
+    }
+
+    // Draws without levels use the whole index range, its size has to outlive the indices
+    if (mesh.lods.empty()) mesh.lods.push_back({0, (uint32_t) mesh.indices.size(), 0.0f});
+    // Assigning empty vectors gives the memory back, clear would keep it
+    mesh.vertices = std::vector<Vertex>();
+    mesh.packedVertices = std::vector<PackedVertex>();
+    mesh.indices = std::vector<unsigned int>();
+}
+
+void ResidencyManager::markVisible(std::vector<Model>& models, Camera& camera) {
+    for (Model& model : models) {
+        if (!model.shouldDraw) continue;
+
+        for (Mesh& mesh : model.meshes) {
+            glm::mat4 finalModelMatrix = mesh.model_matrix * model.model_matrix;
+            glm::vec4 meshMin = finalModelMatrix * mesh.aabb.minPoint;
+            glm::vec4 meshMax = finalModelMatrix * mesh.aabb.maxPoint;
+            if (!camera.isInsideFrustum(meshMax, meshMin)) continue;
+
+            mesh.lastVisibleFrame = frame;
+            for (const Texture& texture : model.materials_loaded[mesh.materialIndex].textures) {
+                textureLastVisible[texture.id] = frame;
+            }
+        }
+    }
+}
+
+void ResidencyManager::reloadMeshes(std::vector<Model>& models, GeometryPool& geometryPool) {
+    unsigned int reloadedMeshes = 0;
+    for (Model& model : models) {
+        for (size_t i = 0; i < model.meshes.size() && reloadedMeshes < settings.maxReloadsPerFrame; i++) {
+            Mesh& mesh = model.meshes[i];
+            if (isResident(mesh) || mesh.lastVisibleFrame != frame) continue;
+
+            // Kept by CpuGeometryPolicy::Keep, or the model has no pack
+            if (hasGeometry(mesh)) {
+                mesh.geometry = geometryPool.allocate(mesh);
+                reloadedMeshes++;
+                reloads++;
+                continue;
+            }
+
+            bool isPending = std::any_of(pendingMeshes.begin(), pendingMeshes.end(), [&](const PendingMesh& pending) {
+                return pending.packPath == model.packPath && pending.meshIndex == i;
+            });
+            if (isPending || model.packPath.empty()) continue;
+
+            std::string packPath = model.packPath;
+            PackLocation location = mesh.packLocation;
+            PendingMesh pending;
+            pending.packPath = packPath;
+            pending.meshIndex = i;
+            pending.mesh = ThreadPool::shared().submit([packPath, location, i]() {
+                return readMeshEntry(packPath, location, i);
+            });
+            pendingMeshes.push_back(std::move(pending));
+            reloadedMeshes++;
+        }
+    }
+}
+
+void ResidencyManager::finishReloads(std::vector<Model>& models, GeometryPool& geometryPool) {
+    for (size_t i = 0; i < pendingMeshes.size();) {
+        PendingMesh& pending = pendingMeshes[i];
+        if (pending.mesh.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            i++;
+            continue;
+        }
+
+        Mesh geometry = pending.mesh.get();
+        if (!hasGeometry(geometry)) {
+            std::cout << "Failed to reload mesh " << pending.meshIndex << " from " << pending.packPath << "\n";
+        }
+        // Every instance of the model shares the pack
+        for (Model& model : models) {
+            if (model.packPath != pending.packPath || pending.meshIndex >= model.meshes.size()) continue;
+
+            Mesh& mesh = model.meshes[pending.meshIndex];
+            if (!isResident(mesh) && hasGeometry(geometry)) {
+                mesh.geometry = geometryPool.allocate(geometry);
+                reloads++;
+            }
+        }
+        pendingMeshes.erase(pendingMeshes.begin() + i);
+    }
+}
+
+void ResidencyManager::evict(std::vector<Model>& models, TextureStreamer& streamer, GeometryPool& geometryPool) {
+    glutil::GpuMemoryStats memory = glutil::getGpuMemoryStats();
+    // Free space in the geometry pool is as good as given back, compacting returns it
+    size_t usedBytes = memory.textureBytes + memory.bufferBytes - geometryPool.getCapacityBytes() +
+                       geometryPool.getUsedBytes();
+    if (usedBytes <= settings.memoryBudget) return;
+
+    struct Candidate {
+        uint64_t lastVisibleFrame;
+        size_t size;
+        Mesh* mesh;
+        unsigned int textureId;
+    };
+    std::vector<Candidate> candidates;
+    for (Model& model : models) {
+        for (Mesh& mesh : model.meshes) {
+            bool canReload = hasGeometry(mesh) || !model.packPath.empty();
+            if (!isResident(mesh) || mesh.lastVisibleFrame == frame || !canReload) continue;
+
+            size_t size = geometryPool.getSize(mesh.geometry);
+            candidates.push_back({mesh.lastVisibleFrame, size, &mesh, 0});
+        }
+    }
+    for (auto iterator = textureLastVisible.begin(); iterator != textureLastVisible.end();) {
+        auto [id, lastVisibleFrame] = *iterator;
+        size_t size = streamer.getStreamedBytes(id);
+        // Nothing to give back, the texture is stamped again once it's visible and can stream
+        if (size == 0) {
+            iterator = textureLastVisible.erase(iterator);
+            continue;
+        }
+        iterator++;
+
+        if (lastVisibleFrame != frame) candidates.push_back({lastVisibleFrame, size, nullptr, id});
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.lastVisibleFrame < b.lastVisibleFrame;
+    });
+
+    for (const Candidate& candidate : candidates) {
+        if (usedBytes <= settings.memoryBudget) break;
+
+        if (candidate.mesh != nullptr) {
+            geometryPool.free(candidate.mesh->geometry);
+        }
+        else {
+            streamer.evictTexture(candidate.textureId);
+        }
+        usedBytes -= std::min(candidate.size, usedBytes);
+        evictions++;
+    }
+}
+
+ResidencyStats ResidencyManager::getStats() const {
+    glutil::GpuMemoryStats memory = glutil::getGpuMemoryStats();
+    ResidencyStats stats;
+    stats.textureBytes = memory.textureBytes;
+    stats.bufferBytes = memory.bufferBytes;
+    stats.evictedMeshes = evictedMeshes;
+    stats.cpuGeometryBytes = cpuGeometryBytes;
+    stats.pendingReloads = pendingMeshes.size();
+    stats.evictions = evictions;
+    stats.reloads = reloads;
+    return stats;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <future>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "assets/model.h"
+#include "renderer/geometry_pool.h"
+#include "renderer/texture_streamer.h"
+#include "utils/camera.h"
+
+enum class CpuGeometryPolicy {
+    // Vertices and indices stay in memory, evicted meshes are uploaded again straight from them
+    Keep,
+    // Dropped once the mesh is on the GPU, as long as the model has a pack to read them back from
+    ReleaseAfterUpload
+};
+
+struct ResidencySettings {
+    bool enabled = true;
+    // Only applies to meshes uploaded after a change
+    CpuGeometryPolicy cpuGeometry = CpuGeometryPolicy::ReleaseAfterUpload;
+    // Every texture and buffer glutil created, renderer targets included
+    size_t memoryBudget = size_t(1) << 30;
+    // Evicted meshes uploaded again per frame, the rest wait for the next ones
+    unsigned int maxReloadsPerFrame = 4;
+};
+
+struct ResidencyStats {
+    size_t textureBytes = 0;
+    size_t bufferBytes = 0;
+    size_t evictedMeshes = 0;
+    // Vertices and indices still held in memory
+    size_t cpuGeometryBytes = 0;
+    size_t pendingReloads = 0;
+    size_t evictions = 0;
+    size_t reloads = 0;
+};
+
+// Keeps the GPU memory of models under a budget. Frustum culling decides what's in use: every frame the meshes
+// inside the frustum and their textures are stamped with the frame, and while over budget the mesh geometry and
+// streamed texture levels unseen for the longest are evicted. Evicted meshes come back from their CPU copy or,
+// without one, from the pack once they're visible again; textures are streamed back by the TextureStreamer.
+// Skins and the coarse texture levels stay resident. Not thread safe.
+class ResidencyManager {
+public:
+    ResidencyManager() = default;
+    ~ResidencyManager();
+
+    ResidencyManager(const ResidencyManager&) = delete;
+    ResidencyManager& operator=(const ResidencyManager&) = delete;
+
+    void update(std::vector<Model>& models, Camera& camera, TextureStreamer& streamer, GeometryPool& geometryPool);
+    // Applies the CPU geometry policy to a mesh of model that was just uploaded
+    void releaseGeometry(const Model& model, Mesh& mesh) const;
+
+    ResidencyStats getStats() const;
+
+    ResidencySettings settings;
+
+private:
+    struct PendingMesh {
+        std::string packPath;
+        size_t meshIndex = 0;
+        std::future<Mesh> mesh;
+    };
+
+    void markVisible(std::vector<Model>& models, Camera& camera);
+    void reloadMeshes(std::vector<Model>& models, GeometryPool& geometryPool);
+    void finishReloads(std::vector<Model>& models, GeometryPool& geometryPool);
+    void evict(std::vector<Model>& models, TextureStreamer& streamer, GeometryPool& geometryPool);
+
+    uint64_t frame = 0;
+    std::unordered_map<unsigned int, uint64_t> textureLastVisible;
+    std::vector<PendingMesh> pendingMeshes;
+    // As of the last update
+    size_t evictedMeshes = 0;
+    size_t cpuGeometryBytes = 0;
+    size_t evictions = 0;
+    size_t reloads = 0;
+};
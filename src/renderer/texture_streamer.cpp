@@ -0,0 +1,302 @@
+#include "texture_streamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "assets/asset_pack.h"
+#include "assets/texture_mips.h"
+#include "assets/texture_registry.h"
+#include "renderer/lod_selection.h"
+#include "utils/functions.h"
+#include "utils/thread_pool.h"
+
+namespace {
+bool isTextureFile(const assets::AssetFileView& file, const assets::TextureKey& key) {
+    return memcmp(file.type, "TEXI", 4) == 0 &&
+           assets::getTextureKey(AssetConverter().readTextureMetadata(file)) == key;
+}
+
+// Searched by content, for textures that don't know their entry or no longer find it where it was
+PackLocation findTextureEntry(const assets::PackFile& pack, const assets::TextureKey& key) {
+    for (const assets::PackEntry& entry : pack.getEntries()) {
+        assets::AssetFileView file;
+        if (assets::isEntryType(entry, "TEXI") && pack.getEntryView(entry, file) && isTextureFile(file, key)) {
+            return assets::getPackLocation(entry);
+        }
+    }
+    return {};
+}
+
+bool readTextureLevel(const std::string& packPath, const PackLocation& location, const assets::TextureKey& key,
+                      int level, unsigned char* data, size_t size) {
+    assets::PackFile pack;
+    if (!pack.open(packPath)) return false;
+
+    // A rebake may have moved the texture since its location was taken
+    assets::AssetFileView file;
+    if (!pack.getEntryView(location, file) || !isTextureFile(file, key)) {
+        if (!pack.getEntryView(findTextureEntry(pack, key), file)) return false;
+    }
+    return AssetConverter().convertBinaryToTextureLevel(file, level, data, size);
+}
+
+int getWantedLevel(float idealLevel, int levels) {
+    return std::clamp((int) std::floor(idealLevel), 0, levels - 1);
+}
+}
+
+TextureStreamer::~TextureStreamer() {
+    for (PendingLevel& pending : pendingLevels) {
+        pending.read.wait();
+    }
+}
+
+void TextureStreamer::addTexture(const Texture& texture, bool immutableStorage) {
+    removeTexture(texture.id);
+
+    StreamedTexture& streamed = textures[texture.id];
+    streamed.texture = texture;
+    streamed.texture.data = nullptr;
+    streamed.baseLevel = texture.firstLevel;
+    streamed.residentLevel = texture.firstLevel;
+    streamed.immutableStorage = immutableStorage;
+    streamed.location = texture.streamLocation;
+    if (!streamed.location.isValid()) {
+        assets::PackFile pack;
+        if (pack.open(texture.streamSource)) streamed.location = findTextureEntry(pack, assets::getTextureKey(texture));
+    }
+    streamed.idealLevel = texture.levels - 1;
+    residentBytes += assets::getMipRangeSize(texture, immutableStorage ? 0 : texture.firstLevel, texture.levels);
+}
+
+void TextureStreamer::removeTexture(unsigned int id) {
+    auto iterator = textures.find(id);
+    if (iterator == textures.end()) return;
+
+    const StreamedTexture& streamed = iterator->second;
+    int firstLevel = streamed.immutableStorage ? 0 : streamed.residentLevel;
+    residentBytes -= assets::getMipRangeSize(streamed.texture, firstLevel, streamed.texture.levels);
+    textures.erase(iterator);
+}
+
+size_t TextureStreamer::getStreamedBytes(unsigned int id) const {
+    auto iterator = textures.find(id);
+    if (iterator == textures.end()) return 0;
+
+    const StreamedTexture& streamed = iterator->second;
+    if (streamed.immutableStorage) return 0;
+    return assets::getMipRangeSize(streamed.texture, streamed.residentLevel, streamed.baseLevel);
+}
+
+int TextureStreamer::getResidentLevel(unsigned int id) const {
+    auto iterator = textures.find(id);
+    return iterator != textures.end() ? iterator->second.residentLevel : 0;
+}
+
+void TextureStreamer::evictTexture(unsigned int id) {
+    auto iterator = textures.find(id);
+    if (iterator == textures.end()) return;
+
+    StreamedTexture& streamed = iterator->second;
+    if (streamed.immutableStorage || streamed.residentLevel >= streamed.baseLevel) return;
+
+    glutil::releaseTextureLevels(id, streamed.residentLevel, streamed.baseLevel, streamed.texture.format);
+    residentBytes -= assets::getMipRangeSize(streamed.texture, streamed.residentLevel, streamed.baseLevel);
+    evictedLevels += streamed.baseLevel - streamed.residentLevel;
+    streamed.residentLevel = streamed.baseLevel;
+}
+
+void TextureStreamer::update(std::vector<Model>& models, Camera& camera, glm::ivec2 viewport,
+                             PixelUploadRing& uploadRing) {
+    finishPendingLevels(uploadRing);
+    if (!settings.enabled) return;
+
+    updateIdealLevels(models, camera, viewport);
+    requestLevels(uploadRing);
+}
+
+void TextureStreamer::finishPendingLevels(PixelUploadRing& uploadRing) {
+    for (size_t i = 0; i < pendingLevels.size();) {
+        PendingLevel& pending = pendingLevels[i];
+        if (pending.read.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            i++;
+            continue;
+        }
+
+        bool read = pending.read.get();
+        bool inRing = pending.staging.empty();
+        auto iterator = textures.find(pending.id);
+        // The id may belong to another texture by now
+        if (iterator != textures.end() && iterator->second.texture.contentHash == pending.contentHash) {
+            StreamedTexture& streamed = iterator->second;
+            const Texture& texture = streamed.texture;
+            streamed.hasPendingLevel = false;
+
+            if (!read) {
+                streamed.unavailable = true;
+            }
+            // Otherwise the texture was evicted while the level was being read
+            else if (pending.level == streamed.residentLevel - 1) {
+                if (inRing) uploadRing.bind();
+                glutil::uploadTextureLevel(pending.id, texture.width, texture.height, pending.level, texture.format,
+                    inRing ? uploadRing.getUnpackPointer(pending.allocation) : pending.staging.data(), pending.size);
+                if (inRing) uploadRing.unbind();
+                streamed.residentLevel = pending.level;
+                residentBytes += pending.chargedBytes;
+                streamedLevels++;
+            }
+        }
+
+        if (inRing) uploadRing.commit(pending.allocation);
+        pendingBytes -= pending.chargedBytes;
+        pendingLevels.erase(pendingLevels.begin() + i);
+    }
+}
+
+void TextureStreamer::updateIdealLevels(std::vector<Model>& models, Camera& camera, glm::ivec2 viewport) {
+    // Textures nothing visible uses only need their coarsest level
+    for (auto& [id, streamed] : textures) {
+        streamed.idealLevel = streamed.texture.levels - 1;
+    }
+
+    float projectionScale = getProjectionScale(glm::radians(camera.Zoom), (float) viewport.y);
+    for (Model& model : models) {
+        if (!model.shouldDraw) continue;
+
+        for (Mesh& mesh : model.meshes) {
+            if (mesh.uvDensity <= 0.0f) continue;
+
+            glm::mat4 finalModelMatrix = mesh.model_matrix * model.model_matrix;
+            glm::vec4 meshMin = finalModelMatrix * mesh.aabb.minPoint;
+            glm::vec4 meshMax = finalModelMatrix * mesh.aabb.maxPoint;
+            if (!camera.isInsideFrustum(meshMax, meshMin)) continue;
+
+            // Same distance as level of detail selection, to the closest point of the bounds
+            glm::vec3 center(finalModelMatrix * ((mesh.aabb.minPoint + mesh.aabb.maxPoint) * 0.5f));
+            float scale = std::max({ glm::length(glm::vec3(finalModelMatrix[0])),
+                                     glm::length(glm::vec3(finalModelMatrix[1])),
+                                     glm::length(glm::vec3(finalModelMatrix[2])) });
+            float radius = glm::length(glm::vec3(mesh.aabb.maxPoint - mesh.aabb.minPoint)) * 0.5f * scale;
+            float distance = std::max(glm::distance(center, camera.Position) - radius, camera.zNear);
+            float pixelsPerUnit = projectionScale / std::max(distance, 1e-4f);
+            float uvPerUnit = mesh.uvDensity / scale;
+
+            for (const Texture& texture : model.materials_loaded[mesh.materialIndex].textures) {
+                auto iterator = textures.find(texture.id);
+                if (iterator == textures.end()) continue;
+
+                StreamedTexture& streamed = iterator->second;
+                float texelsPerUnit = uvPerUnit * std::max(streamed.texture.width, streamed.texture.height);
+                // One level per halving of texels per pixel, level 0 when a texel covers a pixel or more
+                float idealLevel = std::log2(std::max(texelsPerUnit / pixelsPerUnit, 1e-6f)) + settings.levelBias;
+                streamed.idealLevel = std::min(streamed.idealLevel, idealLevel);
+            }
+        }
+    }
+}
+
+void TextureStreamer::requestLevels(PixelUploadRing& uploadRing) {
+    // The budget may have been lowered
+    while (residentBytes + reservedBytes + pendingBytes > settings.memoryBudget && evictLevel(INFINITY)) {}
+
+    std::vector<std::pair<float, unsigned int>> candidates;
+    for (auto& [id, streamed] : textures) {
+        if (streamed.hasPendingLevel || streamed.unavailable) continue;
+        if (streamed.residentLevel > getWantedLevel(streamed.idealLevel, streamed.texture.levels)) {
+            candidates.emplace_back(getPriority(streamed), id);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    for (const auto& [priority, id] : candidates) {
+        if (pendingLevels.size() >= settings.maxPendingLevels) break;
+
+        StreamedTexture& streamed = textures[id];
+        int level = streamed.residentLevel - 1;
+        size_t size = getLevelSize(streamed, level);
+        // Immutable storage already holds the level
+        size_t chargedBytes = streamed.immutableStorage ? 0 : size;
+        bool fits = true;
+        while (fits && residentBytes + reservedBytes + pendingBytes + chargedBytes > settings.memoryBudget) {
+            fits = evictLevel(priority);
+        }
+        // Everything else is needed at least as much, and so are the candidates after this one
+        if (!fits) break;
+
+        const Texture& texture = streamed.texture;
+        PendingLevel pending;
+        pending.id = id;
+        pending.contentHash = texture.contentHash;
+        pending.level = level;
+        pending.size = size;
+        pending.chargedBytes = chargedBytes;
+        if (!uploadRing.canFit(size)) {
+            pending.staging.resize(size);
+            pending.allocation.data = pending.staging.data();
+            uploadRing.addFallback();
+        }
+        // The ring frees up as the GPU finishes earlier copies, the level is asked for again next frame
+        else if (!uploadRing.allocate(size, pending.allocation)) {
+            break;
+        }
+
+        assets::TextureKey key = assets::getTextureKey(texture);
+        std::string packPath = texture.streamSource;
+        PackLocation location = streamed.location;
+        unsigned char* destination = pending.allocation.data;
+        pending.read = ThreadPool::shared().submit([packPath, location, key, level, destination, size]() {
+            return readTextureLevel(packPath, location, key, level, destination, size);
+        });
+
+        pendingLevels.push_back(std::move(pending));
+        streamed.hasPendingLevel = true;
+        pendingBytes += chargedBytes;
+    }
+}
+
+bool TextureStreamer::evictLevel(float priority) {
+    StreamedTexture* victim = nullptr;
+    for (auto& [id, streamed] : textures) {
+        // Immutable storage keeps its memory whatever is evicted
+        if (streamed.immutableStorage || streamed.residentLevel >= streamed.baseLevel || streamed.hasPendingLevel) {
+            continue;
+        }
+        // Evicting raises the priority of a texture by one, it has to stay under the one making room
+        if (getPriority(streamed) + 1.0f >= priority) continue;
+
+        if (victim == nullptr || getPriority(streamed) < getPriority(*victim)) victim = &streamed;
+    }
+    if (victim == nullptr) return false;
+
+    int level = victim->residentLevel;
+    glutil::releaseTextureLevels(victim->texture.id, level, level + 1, victim->texture.format);
+    victim->residentLevel = level + 1;
+    residentBytes -= getLevelSize(*victim, level);
+    evictedLevels++;
+    return true;
+}
+
+float TextureStreamer::getPriority(const StreamedTexture& texture) {
+    return texture.residentLevel - texture.idealLevel;
+}
+
+size_t TextureStreamer::getLevelSize(const StreamedTexture& texture, int level) {
+    return assets::getMipRangeSize(texture.texture, level, level + 1);
+}
+
+TextureStreamingStats TextureStreamer::getStats() const {
+    TextureStreamingStats stats;
+    stats.textures = textures.size();
+    stats.residentBytes = residentBytes;
+    stats.reservedBytes = reservedBytes;
+    stats.pendingLevels = pendingLevels.size();
+    stats.streamedLevels = streamedLevels;
+    stats.evictedLevels = evictedLevels;
+    for (const auto& [id, streamed] : textures) {
+        if (streamed.residentLevel > getWantedLevel(streamed.idealLevel, streamed.texture.levels)) {
+            stats.starvedTextures++;
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <future>
+#include <unordered_map>
+#include <vector>
+
+#include "assets/model.h"
+#include "renderer/upload_ring.h"
+#include "utils/camera.h"
+
+struct TextureStreamingSettings {
+    bool enabled = true;
+    // Every streamed texture together, the coarse levels loaded with the models included
+    size_t memoryBudget = size_t(256) << 20;
+    // Levels being read from packs at once
+    unsigned int maxPendingLevels = 8;
+    // Added to the level picked from the texel density, positive values stream less
+    float levelBias = 0.0f;
+};
+
+struct TextureStreamingStats {
+    size_t textures = 0;
+    size_t residentBytes = 0;
+    // Counted against the budget on top of residentBytes, see setReservedBytes
+    size_t reservedBytes = 0;
+    // Textures that could use a finer level than the one they have
+    size_t starvedTextures = 0;
+    size_t pendingLevels = 0;
+    size_t streamedLevels = 0;
+    size_t evictedLevels = 0;
+};
+
+// Streams the finer levels of textures created with glutil::createStreamedTexture in and out. Every frame the
+// meshes using a texture decide the level it needs from their projected texel density; the textures missing the
+// most detail get their next level read from the pack first, and once the memory budget is reached levels are
+// evicted from the textures that need them the least. Textures with immutable storage have their whole chain
+// allocated up front, so all of it counts against the budget from the start and they're never evicted, streaming
+// only fills them in. Levels are decompressed on the shared thread pool straight into the upload ring and copied
+// into the texture on the GL thread. Not thread safe.
+class TextureStreamer {
+public:
+    TextureStreamer() = default;
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // texture.id is the streamed GL texture, data holds its levels from texture.firstLevel on. immutableStorage as
+    // passed to glutil::createStreamedTexture.
+    void addTexture(const Texture& texture, bool immutableStorage);
+    // Before the GL texture gets deleted
+    void removeTexture(unsigned int id);
+    // Levels streamed in on top of the base levels, what evictTexture gives back. Always 0 for immutable storage,
+    // which holds on to its memory whatever the levels hold.
+    size_t getStreamedBytes(unsigned int id) const;
+    // Finest level with pixels in it, 0 for textures that don't stream
+    int getResidentLevel(unsigned int id) const;
+    // Drops every streamed level, they come back once the texture is needed again. Does nothing for immutable
+    // storage.
+    void evictTexture(unsigned int id);
+    // GPU memory outside the streamed textures the budget has to leave room for, the copies the material table
+    // keeps in its texture arrays
+    void setReservedBytes(size_t bytes) { reservedBytes = bytes; }
+
+    void update(std::vector<Model>& models, Camera& camera, glm::ivec2 viewport, PixelUploadRing& uploadRing);
+
+    TextureStreamingStats getStats() const;
+
+    TextureStreamingSettings settings;
+
+private:
+    struct StreamedTexture {
+        // Metadata only, pixels live on the GPU
+        Texture texture;
+        // Loaded with the model and never evicted
+        int baseLevel = 0;
+        int residentLevel = 0;
+        bool immutableStorage = false;
+        // Of the texture's entry in texture.streamSource, levels are read straight from it
+        PackLocation location;
+        // Level the meshes using the texture would like this frame, fractional
+        float idealLevel = 0.0f;
+        bool hasPendingLevel = false;
+        // The pack no longer has the texture, it stays at what it has
+        bool unavailable = false;
+    };
+
+    struct PendingLevel {
+        unsigned int id = 0;
+        uint64_t contentHash = 0;
+        int level = 0;
+        size_t size = 0;
+        // What the level adds to residentBytes, nothing for immutable storage
+        size_t chargedBytes = 0;
+        // Where the level is read to, staging only holds levels larger than the whole ring
+        UploadAllocation allocation;
+        std::vector<unsigned char> staging;
+        std::future<bool> read;
+    };
+
+    void finishPendingLevels(PixelUploadRing& uploadRing);
+    void updateIdealLevels(std::vector<Model>& models, Camera& camera, glm::ivec2 viewport);
+    void requestLevels(PixelUploadRing& uploadRing);
+    // Drops the finest level of the texture needing it the least, as long as it needs it less than priority
+    bool evictLevel(float priority);
+
+    static float getPriority(const StreamedTexture& texture);
+    static size_t getLevelSize(const StreamedTexture& texture, int level);
+
+    std::unordered_map<unsigned int, StreamedTexture> textures;
+    std::vector<PendingLevel> pendingLevels;
+    size_t residentBytes = 0;
+    size_t reservedBytes = 0;
+    size_t pendingBytes = 0;
+    size_t streamedLevels = 0;
+    size_t evictedLevels = 0;
+};
@@ -0,0 +1,130 @@
+#include "upload_ring.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "utils/functions.h"
+
+namespace {
+// More than any pixel transfer needs, and keeps every allocation on its own cache lines
+constexpr size_t ALLOCATION_ALIGNMENT = 256;
+constexpr GLbitfield MAPPING_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+size_t alignUp(size_t value) {
+    return (value + ALLOCATION_ALIGNMENT - 1) / ALLOCATION_ALIGNMENT * ALLOCATION_ALIGNMENT;
+}
+}
+
+bool PixelUploadRing::init() {
+    if (mapping != nullptr) return true;
+    if (failed) return false;
+
+    buffer = glutil::createBuffer(capacity, nullptr, MAPPING_FLAGS);
+    mapping = static_cast<unsigned char*>(glMapNamedBufferRange(buffer, 0, capacity, MAPPING_FLAGS));
+    if (mapping == nullptr) {
+        std::cout << "Failed to map the texture upload buffer, uploading from client memory" << std::endl;
+        glutil::deleteBuffer(buffer);
+        buffer = 0;
+        failed = true;
+    }
+    return mapping != nullptr;
+}
+
+bool PixelUploadRing::canFit(size_t size) {
+    return alignUp(std::max<size_t>(size, 1)) <= capacity && init();
+}
+
+bool PixelUploadRing::allocate(size_t size, UploadAllocation& allocation) {
+    if (!canFit(size)) return false;
+    reclaim();
+
+    size_t alignedSize = alignUp(std::max<size_t>(size, 1));
+
+    // Free space is what lies between the end of the newest region and the start of the oldest one
+    size_t offset;
+    if (regions.empty()) {
+        offset = 0;
+    }
+    else {
+        size_t front = regions.front().offset;
+        size_t back = regions.back().offset + regions.back().size;
+        if (back > front) {
+            if (capacity - back >= alignedSize) offset = back;
+            else if (front >= alignedSize) offset = 0;
+            else return false;
+        }
+        else if (front - back >= alignedSize) {
+            offset = back;
+        }
+        else {
+            return false;
+        }
+    }
+
+    regions.push_back({offset, alignedSize});
+    usedBytes += alignedSize;
+    allocation = {mapping + offset, offset, size};
+    return true;
+}
+
+void PixelUploadRing::commit(const UploadAllocation& allocation) {
+    for (Region& region : regions) {
+        if (region.offset == allocation.offset && !region.committed) {
+            region.committed = true;
+            uploadedBytes += allocation.size;
+            return;
+        }
+    }
+}
+
+const unsigned char* PixelUploadRing::getUnpackPointer(const UploadAllocation& allocation) const {
+    return reinterpret_cast<const unsigned char*>(allocation.offset);
+}
+
+void PixelUploadRing::bind() const {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+}
+
+void PixelUploadRing::unbind() const {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void PixelUploadRing::fence() {
+    bool hasUnfenced = false;
+    for (Region& region : regions) {
+        if (region.committed && region.fenceSerial == 0) {
+            region.fenceSerial = lastFenceSerial + 1;
+            hasUnfenced = true;
+        }
+    }
+    if (!hasUnfenced) return;
+
+    fences.emplace_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), ++lastFenceSerial);
+}
+
+void PixelUploadRing::reclaim() {
+    while (!fences.empty()) {
+        GLenum result = glClientWaitSync(fences.front().first, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) break;
+
+        glDeleteSync(fences.front().first);
+        finishedFenceSerial = fences.front().second;
+        fences.pop_front();
+    }
+
+    // A region still being written holds back the ones after it, space is only ever freed in order
+    while (!regions.empty() && regions.front().fenceSerial != 0 &&
+           regions.front().fenceSerial <= finishedFenceSerial) {
+        usedBytes -= regions.front().size;
+        regions.pop_front();
+    }
+}
+
+UploadRingStats PixelUploadRing::getStats() const {
+    UploadRingStats stats;
+    stats.capacity = capacity;
+    stats.usedBytes = usedBytes;
+    stats.uploadedBytes = uploadedBytes;
+    stats.fallbacks = fallbacks;
+    return stats;
+}
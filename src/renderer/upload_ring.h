@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#include <glad/glad.h>
+
+struct UploadAllocation {
+    // Where the pixels go, written from any thread until the allocation is committed
+    unsigned char* data = nullptr;
+    size_t offset = 0;
+    size_t size = 0;
+};
+
+struct UploadRingStats {
+    size_t capacity = 0;
+    // Written, or waiting for the GPU to finish the copies reading them
+    size_t usedBytes = 0;
+    size_t uploadedBytes = 0;
+    // Allocations that didn't fit, their textures were copied from client memory instead
+    size_t fallbacks = 0;
+};
+
+// A persistently mapped pixel unpack buffer that textures are copied to the GPU from, so the driver never has to
+// copy client memory before the texture calls return. Space is handed out in order and comes back once the fence
+// placed after the copies reading it has signaled; allocate never waits on the GPU and fails instead when the ring
+// is full. The GL buffer is created on first use and left to the context, like the renderer's other objects.
+// Only the mapped memory may be touched off the GL thread.
+class PixelUploadRing {
+public:
+    explicit PixelUploadRing(size_t capacity = size_t(64) << 20) : capacity(capacity) {}
+
+    PixelUploadRing(const PixelUploadRing&) = delete;
+    PixelUploadRing& operator=(const PixelUploadRing&) = delete;
+
+    // False when the ring can never hold size bytes, too large or unable to map its buffer. Such uploads have to
+    // come from client memory.
+    bool canFit(size_t size);
+    bool allocate(size_t size, UploadAllocation& allocation);
+    // Once the copies reading the allocation are issued, or it turned out not to be needed
+    void commit(const UploadAllocation& allocation);
+    // Stands in for the client pointer of texture calls made between bind and unbind
+    const unsigned char* getUnpackPointer(const UploadAllocation& allocation) const;
+    void bind() const;
+    void unbind() const;
+
+    // Fences the copies committed since the last call, once per frame
+    void fence();
+    UploadRingStats getStats() const;
+
+    // Counts a texture copied from client memory because its allocation failed
+    void addFallback() { fallbacks++; }
+
+private:
+    struct Region {
+        size_t offset;
+        size_t size;
+        bool committed = false;
+        // Fence of the frame that committed the region, 0 until fenced
+        uint64_t fenceSerial = 0;
+    };
+
+    bool init();
+    // Frees the regions at the front of the ring whose copies the GPU has finished
+    void reclaim();
+
+    size_t capacity;
+    unsigned int buffer = 0;
+    unsigned char* mapping = nullptr;
+    bool failed = false;
+
+    std::deque<Region> regions;
+    std::deque<std::pair<GLsync, uint64_t>> fences;
+    uint64_t lastFenceSerial = 0;
+    uint64_t finishedFenceSerial = 0;
+    size_t usedBytes = 0;
+    size_t uploadedBytes = 0;
+    size_t fallbacks = 0;
+};
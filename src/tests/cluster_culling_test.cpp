@@ -0,0 +1,156 @@
+#include <cmath>
+#include <iostream>
+
+#include "assets/meshlets.h"
+#include "renderer/cluster_culling.h"
+
+// Builds meshlets for a few quads with known placement and facing, checks their bounds and normal cones, and culls
+// them from a camera that sees some of them from the front, some from behind and misses the rest.
+namespace {
+int failures = 0;
+
+void check(bool condition, const char* test, const char* what) {
+    if (condition) return;
+    std::cout << "FAILED " << test << ": " << what << "\n";
+    failures++;
+}
+
+bool isNear(float a, float b, float tolerance = 1e-4f) {
+    return std::abs(a - b) <= tolerance;
+}
+
+bool isNear(const glm::vec3& a, const glm::vec3& b, float tolerance = 1e-4f) {
+    return isNear(a.x, b.x, tolerance) && isNear(a.y, b.y, tolerance) && isNear(a.z, b.z, tolerance);
+}
+
+void addVertex(Mesh& mesh, const glm::vec3& position) {
+    Vertex vertex{};
+    vertex.Position = position;
+    mesh.vertices.push_back(vertex);
+}
+
+// Unit quad in the z = 0 plane with its corner at x, facing +z, or -z when flipped
+void addQuad(Mesh& mesh, float x, bool flipped) {
+    unsigned int first = (unsigned int) mesh.vertices.size();
+    addVertex(mesh, {x, 0.0f, 0.0f});
+    addVertex(mesh, {x + 1.0f, 0.0f, 0.0f});
+    addVertex(mesh, {x + 1.0f, 1.0f, 0.0f});
+    addVertex(mesh, {x, 1.0f, 0.0f});
+
+    const unsigned int frontCorners[6] = {0, 1, 2, 0, 2, 3};
+    const unsigned int backCorners[6] = {0, 2, 1, 0, 3, 2};
+    for (unsigned int corner : flipped ? backCorners : frontCorners) mesh.indices.push_back(first + corner);
+}
+
+// Facing the camera, facing away from it, and far off to the side
+Mesh makeQuads() {
+    Mesh mesh;
+    addQuad(mesh, 0.0f, false);
+    addQuad(mesh, 2.0f, true);
+    addQuad(mesh, 100.0f, false);
+    return mesh;
+}
+
+void testMeshletBounds() {
+    Mesh mesh = makeQuads();
+    std::vector<Meshlet> meshlets = assets::buildMeshlets(mesh, assets::MAX_MESHLET_VERTICES, 2);
+    check(meshlets.size() == 3, "meshlet bounds", "one meshlet per quad");
+    if (meshlets.size() != 3) return;
+
+    for (size_t i = 0; i < meshlets.size(); i++) {
+        check(meshlets[i].indexOffset == i * 6 && meshlets[i].indexCount == 6, "meshlet bounds", "index range");
+        check(meshlets[i].vertexCount == 4, "meshlet bounds", "vertex count");
+    }
+
+    const Meshlet& front = meshlets[0];
+    check(isNear(front.aabbMin, {0.0f, 0.0f, 0.0f}) && isNear(front.aabbMax, {1.0f, 1.0f, 0.0f}), "meshlet bounds",
+          "aabb");
+    check(isNear(front.center, {0.5f, 0.5f, 0.0f}), "meshlet bounds", "center");
+    check(isNear(front.radius, std::sqrt(0.5f)), "meshlet bounds", "radius");
+    // Flat clusters face one way only, anything behind their plane can cull them
+    check(isNear(front.coneAxis, {0.0f, 0.0f, 1.0f}), "meshlet bounds", "front cone axis");
+    check(isNear(front.coneCutoff, 0.0f), "meshlet bounds", "front cone cutoff");
+    check(isNear(front.coneApex, front.center), "meshlet bounds", "front cone apex");
+    check(isNear(meshlets[1].coneAxis, {0.0f, 0.0f, -1.0f}), "meshlet bounds", "back cone axis");
+
+    // Also splits on vertices, the second triangle of every quad brings one new vertex
+    std::vector<Meshlet> small = assets::buildMeshlets(mesh, 5, assets::MAX_MESHLET_TRIANGLES);
+    check(small.size() == 3 && small[1].indexOffset == 6 && small[1].vertexCount == 4, "meshlet bounds",
+          "vertex limit");
+}
+
+void testFoldedCone() {
+    // One triangle facing +z and one facing +x, the cone has to hold both normals
+    Mesh mesh;
+    addVertex(mesh, {0.0f, 0.0f, 0.0f});
+    addVertex(mesh, {1.0f, 0.0f, 0.0f});
+    addVertex(mesh, {0.0f, 1.0f, 0.0f});
+    addVertex(mesh, {0.0f, 0.0f, 1.0f});
+    mesh.indices = {0, 1, 2, 0, 2, 3};
+
+    Meshlet meshlet{};
+    meshlet.indexCount = 6;
+    assets::computeMeshletBounds(meshlet, mesh.indices, mesh.vertices);
+    check(isNear(meshlet.coneAxis, glm::normalize(glm::vec3(1.0f, 0.0f, 1.0f))), "folded cone", "axis");
+    check(isNear(meshlet.coneCutoff, std::sqrt(0.5f)), "folded cone", "cutoff");
+    // Behind both triangles' planes
+    check(meshlet.coneApex.z <= 1e-4f && meshlet.coneApex.x <= 1e-4f, "folded cone", "apex");
+}
+
+void testCulling() {
+    Mesh mesh = makeQuads();
+    std::vector<Meshlet> meshlets = assets::buildMeshlets(mesh, assets::MAX_MESHLET_VERTICES, 2);
+
+    glm::vec3 cameraPosition(0.5f, 0.5f, 5.0f);
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.5f, 0.5f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = extractFrustum(projection * view);
+    check(frustum.allPlanes.size() == 6, "culling", "six planes");
+    check(frustum.intersectsSphere({0.5f, 0.5f, 0.0f}, 0.0f), "culling", "target inside");
+    check(!frustum.intersectsSphere({0.5f, 0.5f, 10.0f}, 1.0f), "culling", "behind the camera outside");
+
+    // The far quad is off screen, the two others merge into one range
+    std::vector<IndexRange> ranges;
+    ClusterCullingStats stats;
+    cullMeshlets(meshlets, glm::mat4(1.0f), frustum, cameraPosition, false, ranges, stats);
+    check(stats.meshlets == 3 && stats.frustumCulled == 1 && stats.coneCulled == 0, "culling", "frustum stats");
+    check(ranges.size() == 1 && ranges[0].offset == 0 && ranges[0].count == 12, "culling", "frustum ranges");
+
+    // The flipped quad faces away from the camera
+    ranges.clear();
+    stats = {};
+    cullMeshlets(meshlets, glm::mat4(1.0f), frustum, cameraPosition, true, ranges, stats);
+    check(stats.frustumCulled == 1 && stats.coneCulled == 1, "culling", "cone stats");
+    check(ranges.size() == 1 && ranges[0].offset == 0 && ranges[0].count == 6, "culling", "cone ranges");
+
+    // Turned around the quads' vertical axis the flipped quad faces the camera and the other one doesn't. The
+    // ranges no longer touch.
+    glm::mat4 turned = glm::translate(glm::mat4(1.0f), glm::vec3(3.0f, 0.0f, 0.0f)) *
+                       glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    ranges.clear();
+    stats = {};
+    cullMeshlets(meshlets, turned, frustum, cameraPosition, true, ranges, stats);
+    check(stats.frustumCulled == 1 && stats.coneCulled == 1, "culling", "turned stats");
+    check(ranges.size() == 1 && ranges[0].offset == 6 && ranges[0].count == 6, "culling", "turned ranges");
+
+    // Past the far plane nothing is left
+    glm::mat4 distant = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -200.0f));
+    ranges.clear();
+    stats = {};
+    cullMeshlets(meshlets, distant, frustum, cameraPosition, true, ranges, stats);
+    check(stats.frustumCulled == 3 && ranges.empty(), "culling", "past the far plane");
+}
+}
+
+int main() {
+    testMeshletBounds();
+    testFoldedCone();
+    testCulling();
+
+    if (failures > 0) {
+        std::cout << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <array>
+#include <iostream>
+
+#include "assets/mesh_optimizer.h"
+
+// Reorders a shuffled grid and checks the simulated vertex cache gets better while the triangles stay the same,
+// then follows vertices and their bone data through the fetch remap.
+namespace {
+int failures = 0;
+
+void check(bool condition, const char* test, const char* what) {
+    if (condition) return;
+    std::cout << "FAILED " << test << ": " << what << "\n";
+    failures++;
+}
+
+constexpr unsigned int GRID_SIZE = 32;
+
+// GRID_SIZE by GRID_SIZE quads in the z = 0 plane, with the triangles in a scrambled order
+Mesh makeShuffledGrid() {
+    Mesh mesh;
+    for (unsigned int y = 0; y <= GRID_SIZE; y++) {
+        for (unsigned int x = 0; x <= GRID_SIZE; x++) {
+            Vertex vertex{};
+            vertex.Position = glm::vec3((float) x, (float) y, 0.0f);
+            vertex.ID = (unsigned int) mesh.vertices.size();
+            mesh.vertices.push_back(vertex);
+        }
+    }
+
+    std::vector<std::array<unsigned int, 3>> triangles;
+    for (unsigned int y = 0; y < GRID_SIZE; y++) {
+        for (unsigned int x = 0; x < GRID_SIZE; x++) {
+            unsigned int corner = y * (GRID_SIZE + 1) + x;
+            triangles.push_back({corner, corner + 1, corner + GRID_SIZE + 2});
+            triangles.push_back({corner, corner + GRID_SIZE + 2, corner + GRID_SIZE + 1});
+        }
+    }
+    // Fixed seed, every run gets the same order
+    uint32_t state = 12345;
+    for (size_t i = triangles.size() - 1; i > 0; i--) {
+        state = state * 1664525u + 1013904223u;
+        std::swap(triangles[i], triangles[state % (i + 1)]);
+    }
+    for (const auto& triangle : triangles) mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+    return mesh;
+}
+
+// Every triangle rotated to start at its smallest index, which keeps the winding, then sorted
+std::vector<std::array<unsigned int, 3>> getTriangleSet(const std::vector<unsigned int>& indices) {
+    std::vector<std::array<unsigned int, 3>> triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        std::array<unsigned int, 3> triangle = {indices[i], indices[i + 1], indices[i + 2]};
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+void testAnalyze() {
+    assets::VertexCacheStats single = assets::analyzeVertexCache({0, 1, 2}, 3);
+    check(single.acmr == 3.0f && single.atvr == 1.0f, "analyze", "single triangle");
+
+    // The second triangle reuses an edge, only one new vertex
+    assets::VertexCacheStats quad = assets::analyzeVertexCache({0, 1, 2, 0, 2, 3}, 4);
+    check(quad.acmr == 2.0f && quad.atvr == 1.0f, "analyze", "quad");
+
+    // A cache of 3 has forgotten vertex 0 by the time the last triangle asks for it again
+    assets::VertexCacheStats evicted = assets::analyzeVertexCache({0, 1, 2, 3, 4, 5, 0, 1, 2}, 6, 3);
+    check(evicted.acmr == 3.0f && evicted.atvr == 1.5f, "analyze", "evicted");
+}
+
+void testVertexCache() {
+    Mesh mesh = makeShuffledGrid();
+    std::vector<std::array<unsigned int, 3>> triangles = getTriangleSet(mesh.indices);
+    float before = assets::analyzeVertexCache(mesh.indices, mesh.vertices.size()).acmr;
+
+    assets::optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    float after = assets::analyzeVertexCache(mesh.indices, mesh.vertices.size()).acmr;
+    check(getTriangleSet(mesh.indices) == triangles, "vertex cache", "same triangles");
+    // Shuffled, nearly every corner misses. A grid this size ordered well is well under one miss per triangle.
+    check(before > 2.0f, "vertex cache", "shuffled input");
+    check(after < 0.8f, "vertex cache", "optimized acmr");
+
+    assets::optimizeOverdraw(mesh.indices, mesh.vertices, 1.05f);
+    float overdrawAcmr = assets::analyzeVertexCache(mesh.indices, mesh.vertices.size()).acmr;
+    check(getTriangleSet(mesh.indices) == triangles, "overdraw", "same triangles");
+    // Clusters stay intact, the threshold bounds what reordering them can cost, plus the misses at the seams
+    check(overdrawAcmr <= after * 1.05f + 0.05f, "overdraw", "acmr within threshold");
+}
+
+void testVertexFetch() {
+    size_t usedVertexCount = 0;
+    std::vector<unsigned int> remap = assets::optimizeVertexFetch({3, 1, 4, 1, 4, 0}, 6, usedVertexCount);
+    check(usedVertexCount == 4, "vertex fetch", "used vertices");
+    const std::vector<unsigned int> expected = {3, 1, ~0u, 0, 2, ~0u};
+    check(remap == expected, "vertex fetch", "first use order");
+}
+
+void testOptimizeMesh() {
+    Mesh mesh = makeShuffledGrid();
+    // One vertex no triangle uses, it gets dropped
+    Vertex unused{};
+    unused.Position = glm::vec3(-100.0f);
+    mesh.vertices.push_back(unused);
+
+    std::vector<VertexBoneData> boneData(mesh.vertices.size());
+    for (size_t i = 0; i < boneData.size(); i++) boneData[i].boneIDs[0] = (unsigned int) i;
+    std::vector<Vertex> originalVertices = mesh.vertices;
+
+    assets::MeshOptimizationReport report = assets::optimizeMesh(mesh, boneData, true);
+    check(report.triangleCount == GRID_SIZE * GRID_SIZE * 2, "optimize mesh", "triangle count");
+    check(report.after.acmr < report.before.acmr, "optimize mesh", "acmr improves");
+    check(mesh.vertices.size() == originalVertices.size() - 1, "optimize mesh", "unused vertex dropped");
+    check(boneData.size() == mesh.vertices.size(), "optimize mesh", "bone data size");
+    check(mesh.indexSize == 2, "optimize mesh", "16 bit indices");
+
+    bool idsFollow = true, bonesFollow = true, inFirstUseOrder = true;
+    unsigned int nextNew = 0;
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        idsFollow = idsFollow && mesh.vertices[i].ID == i;
+        // The bone data still belongs to the vertex it was made for
+        unsigned int original = boneData[i].boneIDs[0];
+        bonesFollow = bonesFollow && originalVertices[original].Position == mesh.vertices[i].Position;
+    }
+    for (unsigned int index : mesh.indices) {
+        if (index > nextNew) inFirstUseOrder = false;
+        if (index == nextNew) nextNew++;
+    }
+    check(idsFollow, "optimize mesh", "ids are the new slots");
+    check(bonesFollow, "optimize mesh", "bone data follows its vertex");
+    check(inFirstUseOrder, "optimize mesh", "vertices in first use order");
+}
+}
+
+int main() {
+    testAnalyze();
+    testVertexCache();
+    testVertexFetch();
+    testOptimizeMesh();
+
+    if (failures > 0) {
+        std::cout << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "assets/mesh_simplifier.h"
+
+// Simplifies a flat grid, a grid with a UV seam and a sphere, and checks the triangle counts against the targets,
+// the reported errors against the limit, and that borders and seams stay where they are.
+namespace {
+int failures = 0;
+
+void check(bool condition, const char* test, const char* what) {
+    if (condition) return;
+    std::cout << "FAILED " << test << ": " << what << "\n";
+    failures++;
+}
+
+constexpr unsigned int GRID_SIZE = 16;
+
+// GRID_SIZE by GRID_SIZE quads in the z = 0 plane facing +z. With a seam the quads right of the middle column use
+// their own copies of its vertices, with other texture coordinates.
+Mesh makeGrid(bool seam) {
+    Mesh mesh;
+    auto addVertex = [&](unsigned int x, unsigned int y, float u) {
+        Vertex vertex{};
+        vertex.Position = glm::vec3((float) x, (float) y, 0.0f);
+        vertex.Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+        vertex.TexCoords = glm::vec2(u, 0.0f);
+        mesh.vertices.push_back(vertex);
+    };
+    for (unsigned int y = 0; y <= GRID_SIZE; y++) {
+        for (unsigned int x = 0; x <= GRID_SIZE; x++) addVertex(x, y, 0.0f);
+    }
+    unsigned int seamCopies = (unsigned int) mesh.vertices.size();
+    if (seam) {
+        for (unsigned int y = 0; y <= GRID_SIZE; y++) addVertex(GRID_SIZE / 2, y, 1.0f);
+    }
+
+    auto getVertex = [&](unsigned int x, unsigned int y, bool rightOfSeam) {
+        if (seam && rightOfSeam && x == GRID_SIZE / 2) return seamCopies + y;
+        return y * (GRID_SIZE + 1) + x;
+    };
+    for (unsigned int y = 0; y < GRID_SIZE; y++) {
+        for (unsigned int x = 0; x < GRID_SIZE; x++) {
+            bool right = x >= GRID_SIZE / 2;
+            unsigned int a = getVertex(x, y, right), b = getVertex(x + 1, y, right);
+            unsigned int c = getVertex(x + 1, y + 1, right), d = getVertex(x, y + 1, right);
+            mesh.indices.insert(mesh.indices.end(), {a, b, c, a, c, d});
+        }
+    }
+    return mesh;
+}
+
+// Unit sphere without seams, the poles are single vertices
+Mesh makeSphere(unsigned int rings, unsigned int segments) {
+    Mesh mesh;
+    auto addVertex = [&](const glm::vec3& position) {
+        Vertex vertex{};
+        vertex.Position = position;
+        vertex.Normal = position;
+        mesh.vertices.push_back(vertex);
+    };
+    addVertex({0.0f, 0.0f, 1.0f});
+    for (unsigned int ring = 1; ring < rings; ring++) {
+        float polar = 3.14159265f * ring / rings;
+        for (unsigned int segment = 0; segment < segments; segment++) {
+            float azimuth = 2.0f * 3.14159265f * segment / segments;
+            addVertex({std::sin(polar) * std::cos(azimuth), std::sin(polar) * std::sin(azimuth), std::cos(polar)});
+        }
+    }
+    addVertex({0.0f, 0.0f, -1.0f});
+
+    unsigned int southPole = (unsigned int) mesh.vertices.size() - 1;
+    auto getVertex = [&](unsigned int ring, unsigned int segment) {
+        return 1 + (ring - 1) * segments + segment % segments;
+    };
+    for (unsigned int segment = 0; segment < segments; segment++) {
+        mesh.indices.insert(mesh.indices.end(), {0, getVertex(1, segment), getVertex(1, segment + 1)});
+        mesh.indices.insert(mesh.indices.end(),
+                            {southPole, getVertex(rings - 1, segment + 1), getVertex(rings - 1, segment)});
+    }
+    for (unsigned int ring = 1; ring + 1 < rings; ring++) {
+        for (unsigned int segment = 0; segment < segments; segment++) {
+            unsigned int a = getVertex(ring, segment), b = getVertex(ring + 1, segment);
+            unsigned int c = getVertex(ring + 1, segment + 1), d = getVertex(ring, segment + 1);
+            mesh.indices.insert(mesh.indices.end(), {a, b, c, a, c, d});
+        }
+    }
+
+    mesh.aabb.minPoint = glm::vec4(-1.0f, -1.0f, -1.0f, 1.0f);
+    mesh.aabb.maxPoint = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    mesh.aabb.isInitialized = true;
+    return mesh;
+}
+
+// Signed by facing, triangles that flipped over take area away
+float getFacingArea(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices) {
+    float area = 0.0f;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const glm::vec3& a = vertices[indices[i]].Position;
+        const glm::vec3& b = vertices[indices[i + 1]].Position;
+        const glm::vec3& c = vertices[indices[i + 2]].Position;
+        area += glm::cross(b - a, c - a).z * 0.5f;
+    }
+    return area;
+}
+
+bool usesPosition(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices,
+                  const glm::vec3& position) {
+    return std::any_of(indices.begin(), indices.end(), [&](unsigned int index) {
+        return vertices[index].Position == position;
+    });
+}
+
+void testFlatGrid() {
+    Mesh mesh = makeGrid(false);
+    size_t indexCount = mesh.indices.size();
+    std::vector<size_t> targets = {indexCount / 2 / 3 * 3, indexCount / 4 / 3 * 3};
+    // The interior is coplanar, collapsing it costs nothing even with no error allowed
+    std::vector<assets::SimplifiedIndices> levels = assets::simplifyMesh(mesh.indices, mesh.vertices, targets, 0.0f);
+
+    check(levels.size() == 2, "flat grid", "every target reached");
+    for (size_t i = 0; i < levels.size(); i++) {
+        check(levels[i].indices.size() <= targets[i], "flat grid", "triangle count");
+        check(levels[i].error == 0.0f, "flat grid", "no error");
+        // Nothing flipped or left a hole, and the open border is locked
+        check(std::abs(getFacingArea(levels[i].indices, mesh.vertices) - GRID_SIZE * GRID_SIZE) < 1e-3f,
+              "flat grid", "area");
+    }
+
+    bool bordersKept = true;
+    for (unsigned int i = 0; i <= GRID_SIZE; i++) {
+        float step = (float) i, end = (float) GRID_SIZE;
+        for (const glm::vec3& position : {glm::vec3(step, 0.0f, 0.0f), glm::vec3(step, end, 0.0f),
+                                          glm::vec3(0.0f, step, 0.0f), glm::vec3(end, step, 0.0f)}) {
+            bordersKept = bordersKept && usesPosition(levels.back().indices, mesh.vertices, position);
+        }
+    }
+    check(bordersKept, "flat grid", "border vertices kept");
+}
+
+void testSeam() {
+    Mesh mesh = makeGrid(true);
+    std::vector<assets::SimplifiedIndices> levels =
+        assets::simplifyMesh(mesh.indices, mesh.vertices, {mesh.indices.size() / 4 / 3 * 3}, 0.0f);
+    check(!levels.empty() && levels[0].indices.size() < mesh.indices.size(), "seam", "simplified");
+    if (levels.empty()) return;
+
+    // Both copies of every seam vertex are still used, on their own side
+    size_t seamCopies = (GRID_SIZE + 1) * (GRID_SIZE + 1);
+    const std::vector<unsigned int>& indices = levels[0].indices;
+    bool seamKept = true;
+    for (unsigned int y = 0; y <= GRID_SIZE; y++) {
+        unsigned int left = y * (GRID_SIZE + 1) + GRID_SIZE / 2;
+        unsigned int right = (unsigned int) seamCopies + y;
+        seamKept = seamKept && std::find(indices.begin(), indices.end(), left) != indices.end() &&
+                   std::find(indices.begin(), indices.end(), right) != indices.end();
+    }
+    check(seamKept, "seam", "seam vertices kept");
+    check(std::abs(getFacingArea(indices, mesh.vertices) - GRID_SIZE * GRID_SIZE) < 1e-3f, "seam", "area");
+}
+
+void testSphere() {
+    Mesh mesh = makeSphere(16, 32);
+    size_t indexCount = mesh.indices.size();
+
+    // A curved surface can't lose much under a tiny limit, simplification stops early
+    std::vector<assets::SimplifiedIndices> strict =
+        assets::simplifyMesh(mesh.indices, mesh.vertices, {indexCount / 10 / 3 * 3}, 1e-4f);
+    check(strict.size() == 1 && strict[0].indices.size() > indexCount / 10, "sphere", "stops at the limit");
+    check(strict.empty() || strict[0].error <= 1e-4f, "sphere", "strict error");
+
+    std::vector<size_t> targets = {indexCount / 2 / 3 * 3, indexCount / 4 / 3 * 3};
+    std::vector<assets::SimplifiedIndices> levels = assets::simplifyMesh(mesh.indices, mesh.vertices, targets, 0.2f);
+    check(levels.size() == 2, "sphere", "every target reached");
+    float previousError = 0.0f;
+    for (size_t i = 0; i < levels.size(); i++) {
+        check(levels[i].indices.size() <= targets[i], "sphere", "triangle count");
+        check(levels[i].error > 0.0f && levels[i].error <= 0.2f, "sphere", "error within limit");
+        check(levels[i].error >= previousError, "sphere", "error grows with every level");
+        previousError = levels[i].error;
+    }
+
+    // Every triangle is still close to the sphere, how far its middle sags inside bounds the actual error
+    const std::vector<unsigned int>& coarse = levels.back().indices;
+    float maxSag = 0.0f;
+    for (size_t i = 0; i + 2 < coarse.size(); i += 3) {
+        glm::vec3 center = (mesh.vertices[coarse[i]].Position + mesh.vertices[coarse[i + 1]].Position +
+                            mesh.vertices[coarse[i + 2]].Position) / 3.0f;
+        maxSag = std::max(maxSag, 1.0f - glm::length(center));
+    }
+    check(maxSag <= 0.2f, "sphere", "surface stays close");
+}
+
+void testMeshLods() {
+    Mesh mesh = makeSphere(16, 32);
+    size_t baseIndexCount = mesh.indices.size();
+    assets::generateMeshLods(mesh);
+
+    check(mesh.lods.size() >= 2 && mesh.lods.size() <= assets::MAX_MESH_LODS, "mesh lods", "level count");
+    check(!mesh.lods.empty() && mesh.lods[0].indexOffset == 0 && mesh.lods[0].indexCount == baseIndexCount &&
+          mesh.lods[0].error == 0.0f, "mesh lods", "level 0 is the full mesh");
+    for (size_t i = 1; i < mesh.lods.size(); i++) {
+        const MeshLod& lod = mesh.lods[i];
+        const MeshLod& previous = mesh.lods[i - 1];
+        check(lod.indexOffset == previous.indexOffset + previous.indexCount, "mesh lods", "appended in order");
+        check(lod.indexCount <= previous.indexCount * 0.8f, "mesh lods", "each level removes a fifth");
+        check(lod.error >= previous.error, "mesh lods", "error grows with every level");
+    }
+    check(mesh.indices.size() == (size_t) mesh.lods.back().indexOffset + mesh.lods.back().indexCount, "mesh lods",
+          "indices hold every level");
+
+    // Too small to be worth levels
+    Mesh small = makeSphere(4, 8);
+    assets::generateMeshLods(small);
+    check(small.lods.size() == 1, "mesh lods", "small meshes keep one level");
+}
+}
+
+int main() {
+    testFlatGrid();
+    testSeam();
+    testSphere();
+    testMeshLods();
+
+    if (failures > 0) {
+        std::cout << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <iostream>
+
+#include "renderer/range_allocator.h"
+
+// Allocates and frees ranges in a known order and checks where they land, how free ranges merge, and what's
+// reported as holes.
+namespace {
+int failures = 0;
+
+void check(bool condition, const char* test, const char* what) {
+    if (condition) return;
+    std::cout << "FAILED " << test << ": " << what << "\n";
+    failures++;
+}
+
+bool allocateAt(RangeAllocator& allocator, size_t size, size_t expectedOffset) {
+    size_t offset = ~size_t(0);
+    return allocator.allocate(size, offset) && offset == expectedOffset;
+}
+
+void testEmpty() {
+    RangeAllocator allocator;
+    size_t offset;
+    check(!allocator.allocate(1, offset), "empty", "nothing to allocate");
+    check(allocator.getCapacity() == 0 && allocator.getFreeSize() == 0, "empty", "sizes");
+}
+
+void testBestFit() {
+    RangeAllocator allocator;
+    allocator.grow(100);
+    check(allocateAt(allocator, 10, 0) && allocateAt(allocator, 20, 10) && allocateAt(allocator, 30, 30) &&
+          allocateAt(allocator, 5, 60), "best fit", "packed from the start");
+    check(allocator.getFreeSize() == 35 && allocator.getFreeRangeCount() == 1, "best fit", "tail");
+
+    // A 20 unit hole, and the freed 5 units merging into the 35 unit tail
+    allocator.free(10, 20);
+    allocator.free(60, 5);
+    check(allocator.getFreeRangeCount() == 2 && allocator.getFreeSize() == 60, "best fit", "free ranges");
+    check(allocator.getHoleSize() == 20, "best fit", "hole size");
+
+    // The smaller hole fits, the tail stays whole for something large
+    check(allocateAt(allocator, 15, 10), "best fit", "smallest range that fits");
+    check(allocateAt(allocator, 5, 25), "best fit", "exact fit");
+    check(allocator.getFreeRangeCount() == 1 && allocator.getHoleSize() == 0, "best fit", "only the tail left");
+    check(allocateAt(allocator, 40, 60), "best fit", "tail");
+    size_t offset;
+    check(!allocator.allocate(1, offset), "best fit", "full");
+}
+
+void testCoalescing() {
+    RangeAllocator allocator;
+    allocator.grow(30);
+    check(allocateAt(allocator, 10, 0) && allocateAt(allocator, 10, 10) && allocateAt(allocator, 10, 20),
+          "coalescing", "three ranges");
+
+    allocator.free(0, 10);
+    allocator.free(20, 10);
+    check(allocator.getFreeRangeCount() == 2 && allocator.getFreeSize() == 20, "coalescing", "two apart");
+    // Free space at the end doesn't count as a hole
+    check(allocator.getHoleSize() == 10, "coalescing", "hole size");
+    size_t offset;
+    check(!allocator.allocate(15, offset), "coalescing", "fragmented");
+
+    // Merges with both neighbours at once
+    allocator.free(10, 10);
+    check(allocator.getFreeRangeCount() == 1 && allocator.getFreeSize() == 30, "coalescing", "merged");
+    check(allocateAt(allocator, 30, 0), "coalescing", "whole space");
+
+    allocator.free(0, 30);
+    allocator.free(5, 0);
+    check(allocator.getFreeRangeCount() == 1, "coalescing", "empty frees ignored");
+}
+
+void testGrowAndReset() {
+    RangeAllocator allocator;
+    allocator.grow(10);
+    check(allocateAt(allocator, 5, 0), "grow", "first range");
+    // The new space merges with the free end
+    allocator.grow(20);
+    check(allocator.getCapacity() == 20 && allocator.getFreeRangeCount() == 1 && allocator.getFreeSize() == 15,
+          "grow", "merged into the end");
+    allocator.grow(8);
+    check(allocator.getCapacity() == 20, "grow", "never shrinks");
+    check(allocateAt(allocator, 15, 5), "grow", "fills the end");
+
+    // What compacting leaves behind
+    allocator.reset(12, 40);
+    check(allocator.getCapacity() == 40 && allocator.getFreeSize() == 28 && allocator.getFreeRangeCount() == 1,
+          "reset", "sizes");
+    check(allocator.getHoleSize() == 0, "reset", "no holes");
+    check(allocateAt(allocator, 28, 12), "reset", "free after used");
+
+    allocator.reset(40, 40);
+    check(allocator.getFreeRangeCount() == 0 && allocator.getFreeSize() == 0, "reset", "full");
+}
+}
+
+int main() {
+    testEmpty();
+    testBestFit();
+    testCoalescing();
+    testGrowAndReset();
+
+    if (failures > 0) {
+        std::cout << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
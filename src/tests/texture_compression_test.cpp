@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "assets/texture_compression.h"
+
+// Encodes known 4x4 blocks with the CPU BCn encoder and decodes them back. Layouts the encoder has only one sensible
+// answer for are checked bit for bit, everything else against a maximum per channel error.
+namespace {
+int failures = 0;
+
+void check(bool condition, const char* test, const char* what) {
+    if (condition) return;
+    std::cout << "FAILED " << test << ": " << what << "\n";
+    failures++;
+}
+
+struct Block {
+    uint8_t rgba[64];
+
+    void fill(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+        for (int i = 0; i < 16; i++) set(i, r, g, b, a);
+    }
+
+    void set(int pixel, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+        rgba[pixel * 4] = r;
+        rgba[pixel * 4 + 1] = g;
+        rgba[pixel * 4 + 2] = b;
+        rgba[pixel * 4 + 3] = a;
+    }
+};
+
+uint16_t read16(const uint8_t* data) {
+    return (uint16_t) (data[0] | (data[1] << 8));
+}
+
+void unpack565(uint16_t packed, int* color) {
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+int getBC1Index(const uint8_t* block, int pixel) {
+    return (block[4 + pixel / 4] >> (2 * (pixel % 4))) & 3;
+}
+
+int getBC4Index(const uint8_t* block, int pixel) {
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++) indices |= (uint64_t) block[2 + i] << (8 * i);
+    return (int) ((indices >> (3 * pixel)) & 7);
+}
+
+// Writes the RGB of every pixel, alpha is left alone
+void decodeBC1(const uint8_t* block, uint8_t* rgba) {
+    uint16_t color0 = read16(block), color1 = read16(block + 2);
+    int palette[4][3];
+    unpack565(color0, palette[0]);
+    unpack565(color1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        if (color0 > color1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) rgba[i * 4 + c] = (uint8_t) palette[getBC1Index(block, i)][c];
+    }
+}
+
+void decodeBC4(const uint8_t* block, int channel, uint8_t* rgba) {
+    int palette[8] = {block[0], block[1]};
+    if (block[0] > block[1]) {
+        for (int i = 2; i < 8; i++) palette[i] = ((8 - i) * block[0] + (i - 1) * block[1]) / 7;
+    }
+    else {
+        for (int i = 2; i < 6; i++) palette[i] = ((6 - i) * block[0] + (i - 1) * block[1]) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    for (int i = 0; i < 16; i++) rgba[i * 4 + channel] = (uint8_t) palette[getBC4Index(block, i)];
+}
+
+class BitReader {
+public:
+    explicit BitReader(const uint8_t* input) : input(input) {}
+
+    uint32_t read(int count) {
+        uint32_t value = 0;
+        for (int i = 0; i < count; i++, position++) {
+            value |= (uint32_t) ((input[position / 8] >> (position % 8)) & 1) << i;
+        }
+        return value;
+    }
+
+private:
+    const uint8_t* input;
+    int position = 0;
+};
+
+// Mode 6 only, the one the encoder writes. False for any other mode.
+bool decodeBC7(const uint8_t* block, uint8_t* rgba) {
+    BitReader reader(block);
+    if (reader.read(7) != (1u << 6)) return false;
+
+    int endpoints[2][4];
+    for (int c = 0; c < 4; c++) {
+        endpoints[0][c] = (int) reader.read(7) << 1;
+        endpoints[1][c] = (int) reader.read(7) << 1;
+    }
+    int pBit0 = (int) reader.read(1), pBit1 = (int) reader.read(1);
+    for (int c = 0; c < 4; c++) {
+        endpoints[0][c] |= pBit0;
+        endpoints[1][c] |= pBit1;
+    }
+
+    const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+    for (int i = 0; i < 16; i++) {
+        int index = (int) reader.read(i == 0 ? 3 : 4);
+        for (int c = 0; c < 4; c++) {
+            int value = ((64 - weights[index]) * endpoints[0][c] + weights[index] * endpoints[1][c] + 32) >> 6;
+            rgba[i * 4 + c] = (uint8_t) value;
+        }
+    }
+    return true;
+}
+
+int getMaxError(const Block& source, const uint8_t* decoded, int firstChannel, int channelCount) {
+    int maxError = 0;
+    for (int i = 0; i < 16; i++) {
+        for (int c = firstChannel; c < firstChannel + channelCount; c++) {
+            maxError = std::max(maxError, std::abs(source.rgba[i * 4 + c] - decoded[i * 4 + c]));
+        }
+    }
+    return maxError;
+}
+
+Block makeGradient() {
+    Block block{};
+    for (int i = 0; i < 16; i++) {
+        block.set(i, (uint8_t) (40 + i * 8), (uint8_t) (60 + i * 6), (uint8_t) (200 - i * 4), 255);
+    }
+    return block;
+}
+
+void testBC1() {
+    uint8_t output[8];
+    uint8_t decoded[64];
+
+    // A solid color has both endpoints at its 565 value and every index at 0
+    Block solid{};
+    solid.fill(100, 150, 200, 255);
+    assets::encodeBC1Block(solid.rgba, output);
+    uint16_t expected = (uint16_t) ((12 << 11) | (37 << 5) | 24);
+    check(read16(output) == expected && read16(output + 2) == expected, "BC1 solid", "endpoints");
+    check(output[4] == 0 && output[5] == 0 && output[6] == 0 && output[7] == 0, "BC1 solid", "indices");
+    decodeBC1(output, decoded);
+    check(getMaxError(solid, decoded, 0, 3) <= 4, "BC1 solid", "error");
+
+    // White and black in a checkerboard: four color mode, white on index 0 and black on index 1
+    Block twoColor{};
+    for (int i = 0; i < 16; i++) {
+        uint8_t value = ((i % 4) + (i / 4)) % 2 == 0 ? 255 : 0;
+        twoColor.set(i, value, value, value, 255);
+    }
+    assets::encodeBC1Block(twoColor.rgba, output);
+    check(read16(output) == 0xFFFF && read16(output + 2) == 0x0000, "BC1 two color", "endpoints");
+    bool indicesMatch = true;
+    for (int i = 0; i < 16; i++) {
+        int expectedIndex = twoColor.rgba[i * 4] == 255 ? 0 : 1;
+        indicesMatch = indicesMatch && getBC1Index(output, i) == expectedIndex;
+    }
+    check(indicesMatch, "BC1 two color", "indices");
+    decodeBC1(output, decoded);
+    check(getMaxError(twoColor, decoded, 0, 3) == 0, "BC1 two color", "error");
+
+    Block gradient = makeGradient();
+    assets::encodeBC1Block(gradient.rgba, output);
+    check(read16(output) > read16(output + 2), "BC1 gradient", "four color mode");
+    decodeBC1(output, decoded);
+    check(getMaxError(gradient, decoded, 0, 3) <= 16, "BC1 gradient", "error");
+}
+
+void testBC3() {
+    uint8_t output[16];
+    uint8_t decoded[64];
+
+    // Opaque on the left half and transparent on the right, over one color
+    Block alphaEdge{};
+    for (int i = 0; i < 16; i++) alphaEdge.set(i, 200, 40, 40, (i % 4) < 2 ? 255 : 0);
+    assets::encodeBC3Block(alphaEdge.rgba, output);
+    check(output[0] == 255 && output[1] == 0, "BC3 alpha edge", "alpha endpoints");
+    bool indicesMatch = true;
+    for (int i = 0; i < 16; i++) {
+        indicesMatch = indicesMatch && getBC4Index(output, i) == ((i % 4) < 2 ? 0 : 1);
+    }
+    check(indicesMatch, "BC3 alpha edge", "alpha indices");
+    check(read16(output + 8) == read16(output + 10), "BC3 alpha edge", "solid color endpoints");
+
+    decodeBC4(output, 3, decoded);
+    decodeBC1(output + 8, decoded);
+    check(getMaxError(alphaEdge, decoded, 3, 1) == 0, "BC3 alpha edge", "alpha error");
+    check(getMaxError(alphaEdge, decoded, 0, 3) <= 4, "BC3 alpha edge", "color error");
+
+    Block gradient = makeGradient();
+    for (int i = 0; i < 16; i++) gradient.rgba[i * 4 + 3] = (uint8_t) (i * 17);
+    assets::encodeBC3Block(gradient.rgba, output);
+    decodeBC4(output, 3, decoded);
+    decodeBC1(output + 8, decoded);
+    // Half a palette step of a full range block
+    check(getMaxError(gradient, decoded, 3, 1) <= 19, "BC3 gradient", "alpha error");
+    check(getMaxError(gradient, decoded, 0, 3) <= 16, "BC3 gradient", "color error");
+}
+
+void testBC4() {
+    uint8_t output[8];
+    uint8_t decoded[64];
+
+    // Equal endpoints, every index at 0
+    Block solid{};
+    solid.fill(77, 0, 0, 255);
+    assets::encodeBC4Block(solid.rgba, 0, output);
+    bool zeroIndices = true;
+    for (int i = 2; i < 8; i++) zeroIndices = zeroIndices && output[i] == 0;
+    check(output[0] == 77 && output[1] == 77 && zeroIndices, "BC4 solid", "layout");
+
+    // The eight value palette lands exactly on a ramp from 210 down to 0 in steps of 30
+    Block ramp{};
+    for (int i = 0; i < 16; i++) ramp.set(i, (uint8_t) (210 - (i % 8) * 30), 0, 0, 255);
+    assets::encodeBC4Block(ramp.rgba, 0, output);
+    check(output[0] == 210 && output[1] == 0, "BC4 ramp", "endpoints");
+    decodeBC4(output, 0, decoded);
+    check(getMaxError(ramp, decoded, 0, 1) == 0, "BC4 ramp", "error");
+
+    Block noise{};
+    for (int i = 0; i < 16; i++) noise.set(i, (uint8_t) ((i * 97 + 13) % 256), 0, 0, 255);
+    assets::encodeBC4Block(noise.rgba, 0, output);
+    decodeBC4(output, 0, decoded);
+    // Half a palette step of a full range block
+    check(getMaxError(noise, decoded, 0, 1) <= 19, "BC4 noise", "error");
+}
+
+void testBC5() {
+    uint8_t output[16];
+    uint8_t decoded[64];
+
+    // A bump in a normal map: x and y swing around 128 as they would across a rounded edge
+    Block normals{};
+    const int offsets[4] = {-90, -30, 30, 90};
+    for (int i = 0; i < 16; i++) {
+        normals.set(i, (uint8_t) (128 + offsets[i % 4]), (uint8_t) (128 + offsets[i / 4] / 2), 255, 255);
+    }
+    assets::encodeBC5Block(normals.rgba, output);
+    check(output[0] == 218 && output[1] == 38, "BC5 normals", "x endpoints");
+    check(output[8] == 173 && output[9] == 83, "BC5 normals", "y endpoints");
+    decodeBC4(output, 0, decoded);
+    decodeBC4(output + 8, 1, decoded);
+    check(getMaxError(normals, decoded, 0, 2) <= 13, "BC5 normals", "error");
+
+    // A flat normal map stores one value per channel
+    Block flat{};
+    flat.fill(128, 128, 255, 255);
+    assets::encodeBC5Block(flat.rgba, output);
+    check(output[0] == 128 && output[1] == 128 && output[8] == 128 && output[9] == 128, "BC5 flat", "endpoints");
+    decodeBC4(output, 0, decoded);
+    decodeBC4(output + 8, 1, decoded);
+    check(getMaxError(flat, decoded, 0, 2) == 0, "BC5 flat", "error");
+}
+
+void testBC7() {
+    uint8_t output[16];
+    uint8_t decoded[64];
+
+    Block solid{};
+    solid.fill(100, 150, 200, 255);
+    assets::encodeBC7Block(solid.rgba, output);
+    check(decodeBC7(output, decoded), "BC7 solid", "mode 6");
+    check(getMaxError(solid, decoded, 0, 4) <= 1, "BC7 solid", "error");
+
+    Block alphaEdge{};
+    for (int i = 0; i < 16; i++) alphaEdge.set(i, 200, 40, 40, (i % 4) < 2 ? 255 : 0);
+    assets::encodeBC7Block(alphaEdge.rgba, output);
+    check(decodeBC7(output, decoded), "BC7 alpha edge", "mode 6");
+    check(getMaxError(alphaEdge, decoded, 0, 4) <= 1, "BC7 alpha edge", "error");
+
+    Block gradient = makeGradient();
+    for (int i = 0; i < 16; i++) gradient.rgba[i * 4 + 3] = (uint8_t) (255 - i * 5);
+    assets::encodeBC7Block(gradient.rgba, output);
+    check(decodeBC7(output, decoded), "BC7 gradient", "mode 6");
+    check(getMaxError(gradient, decoded, 0, 4) <= 6, "BC7 gradient", "error");
+}
+}
+
+int main() {
+    testBC1();
+    testBC3();
+    testBC4();
+    testBC5();
+    testBC7();
+
+    if (failures > 0) {
+        std::cout << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
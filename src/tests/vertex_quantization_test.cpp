@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "assets/vertex_quantization.h"
+
+// Packs vertices into the 24 byte baked format and unpacks them again, every attribute has to come back within
+// what its encoding can hold.
+namespace {
+int failures = 0;
+
+void check(bool condition, const char* test, const char* what) {
+    if (condition) return;
+    std::cout << "FAILED " << test << ": " << what << "\n";
+    failures++;
+}
+
+BoundingBox makeBounds(const glm::vec3& minPoint, const glm::vec3& maxPoint) {
+    BoundingBox bounds;
+    bounds.minPoint = glm::vec4(minPoint, 1.0f);
+    bounds.maxPoint = glm::vec4(maxPoint, 1.0f);
+    bounds.isInitialized = true;
+    return bounds;
+}
+
+// Spread over the whole sphere, the poles and both hemispheres of the octahedral fold included
+std::vector<glm::vec3> makeDirections() {
+    std::vector<glm::vec3> directions = {
+        {1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, -1.0f, 0.0f},
+        {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}
+    };
+    for (int i = 0; i <= 16; i++) {
+        float polar = 3.14159265f * i / 16.0f;
+        for (int j = 0; j < 32; j++) {
+            float azimuth = 2.0f * 3.14159265f * j / 32.0f;
+            directions.emplace_back(std::sin(polar) * std::cos(azimuth), std::sin(polar) * std::sin(azimuth),
+                                    std::cos(polar));
+        }
+    }
+    return directions;
+}
+
+void testSize() {
+    check(sizeof(PackedVertex) == 24, "size", "24 bytes");
+}
+
+void testPositions() {
+    BoundingBox bounds = makeBounds({-2.0f, 0.0f, 10.0f}, {6.0f, 1.0f, 10.5f});
+    glm::vec3 extent(8.0f, 1.0f, 0.5f);
+    const glm::vec3 positions[] = {
+        {-2.0f, 0.0f, 10.0f}, {6.0f, 1.0f, 10.5f}, {0.123f, 0.777f, 10.31f}, {5.9999f, 0.5f, 10.25f}
+    };
+
+    for (const glm::vec3& position : positions) {
+        Vertex vertex{};
+        vertex.Position = position;
+        vertex.Normal = {0.0f, 0.0f, 1.0f};
+        vertex.Tangent = {1.0f, 0.0f, 0.0f};
+        vertex.Bitangent = {0.0f, 1.0f, 0.0f};
+        Vertex unpacked = assets::unpackVertex(assets::packVertex(vertex, bounds), bounds);
+        for (int i = 0; i < 3; i++) {
+            // Half a step of unorm16 over the bounds, and a little for float rounding
+            float maxError = extent[i] / 65535.0f * 0.5f + 1e-5f * std::abs(position[i]);
+            check(std::abs(unpacked.Position[i] - position[i]) <= maxError, "positions", "round trip");
+        }
+    }
+
+    Vertex corner{};
+    corner.Position = {-2.0f, 0.0f, 10.0f};
+    PackedVertex packed = assets::packVertex(corner, bounds);
+    check(packed.position[0] == 0 && packed.position[1] == 0 && packed.position[2] == 0, "positions", "min corner");
+    corner.Position = {6.0f, 1.0f, 10.5f};
+    packed = assets::packVertex(corner, bounds);
+    check(packed.position[0] == 65535 && packed.position[1] == 65535 && packed.position[2] == 65535, "positions",
+          "max corner");
+
+    // A flat mesh has no extent along one axis, it comes back on the plane
+    BoundingBox flat = makeBounds({0.0f, 3.0f, 0.0f}, {1.0f, 3.0f, 1.0f});
+    Vertex onPlane{};
+    onPlane.Position = {0.5f, 3.0f, 0.25f};
+    Vertex unpacked = assets::unpackVertex(assets::packVertex(onPlane, flat), flat);
+    check(unpacked.Position.y == 3.0f, "positions", "flat axis");
+}
+
+void testDirections() {
+    BoundingBox bounds = makeBounds(glm::vec3(0.0f), glm::vec3(1.0f));
+    float minNormalDot = 1.0f;
+    for (const glm::vec3& direction : makeDirections()) {
+        glm::vec3 normal = glm::normalize(direction);
+        glm::vec3 decoded = assets::decodeOctahedral(assets::encodeOctahedral(normal));
+        minNormalDot = std::min(minNormalDot, glm::dot(normal, decoded));
+
+        // Any tangent perpendicular to the normal
+        glm::vec3 helper = std::abs(normal.z) < 0.9f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        Vertex vertex{};
+        vertex.Normal = normal;
+        vertex.Tangent = glm::normalize(glm::cross(helper, normal));
+        for (float handedness : {1.0f, -1.0f}) {
+            vertex.Bitangent = glm::cross(vertex.Normal, vertex.Tangent) * handedness;
+            Vertex unpacked = assets::unpackVertex(assets::packVertex(vertex, bounds), bounds);
+            minNormalDot = std::min(minNormalDot, glm::dot(vertex.Normal, unpacked.Normal));
+            minNormalDot = std::min(minNormalDot, glm::dot(vertex.Tangent, unpacked.Tangent));
+            // Rebuilt from the normal and tangent, only the sign is stored
+            check(glm::dot(vertex.Bitangent, unpacked.Bitangent) > 0.999f, "directions", "bitangent handedness");
+        }
+    }
+    // snorm16 octahedral directions are within a few thousandths of a degree
+    check(minNormalDot >= 0.99999f, "directions", "octahedral error");
+}
+
+void testTexCoordsAndId() {
+    BoundingBox bounds = makeBounds(glm::vec3(0.0f), glm::vec3(1.0f));
+    Vertex vertex{};
+    vertex.Normal = {0.0f, 1.0f, 0.0f};
+    vertex.Tangent = {1.0f, 0.0f, 0.0f};
+    vertex.Bitangent = {0.0f, 0.0f, -1.0f};
+    vertex.ID = 123456;
+
+    // Halves hold these exactly, repeating UVs outside 0 to 1 included
+    vertex.TexCoords = {0.5f, 3.75f};
+    Vertex unpacked = assets::unpackVertex(assets::packVertex(vertex, bounds), bounds);
+    check(unpacked.TexCoords == vertex.TexCoords, "texture coordinates", "exact values");
+    check(unpacked.ID == 123456, "texture coordinates", "vertex id");
+
+    // Otherwise within the 11 bit mantissa
+    vertex.TexCoords = {0.3f, 0.9999f};
+    unpacked = assets::unpackVertex(assets::packVertex(vertex, bounds), bounds);
+    check(std::abs(unpacked.TexCoords.x - 0.3f) <= 0.3f / 2048.0f, "texture coordinates", "u error");
+    check(std::abs(unpacked.TexCoords.y - 0.9999f) <= 1.0f / 2048.0f, "texture coordinates", "v error");
+}
+}
+
+int main() {
+    testSize();
+    testPositions();
+    testDirections();
+    testTexCoordsAndId();
+
+    if (failures > 0) {
+        std::cout << failures << " checks failed\n";
+        return 1;
+    }
+    std::cout << "All checks passed\n";
+    return 0;
+}
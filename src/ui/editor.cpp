@@ -1,6 +1,10 @@
 #include "editor.h"
 #include "ui.h"
 
+#include <filesystem>
+
+#include "core/model_loader.h"
+
 void SceneEditor::render(Camera& camera)
 {
 	if (ImGui::BeginMainMenuBar()) {
@@ -62,6 +66,11 @@ void SceneEditor::render(Camera& camera)
 	if (ImGui::BeginTabItem("Stats")) {
 		ImGui::EndTabItem();
 	}
+
+	if (loader != nullptr && ImGui::BeginTabItem("Loading")) {
+		renderLoads();
+		ImGui::EndTabItem();
+	}
 	ImGui::EndTabBar();
 
 	if (ImGui::Begin("Entity Properties")) {
@@ -146,3 +155,34 @@ void SceneEditor::renderAsList(Model& model) {
 	ImGui::PopStyleColor();
 	
 }
+
+void SceneEditor::renderLoads()
+{
+	ImGui::InputText("Model path", &loadPath);
+	if (ImGui::Button("Load") && !loadPath.empty()) {
+		std::string extension = std::filesystem::path(loadPath).extension().string();
+		loader->load(loadPath, extension == ".gltf" || extension == ".glb" ? GLTF : OBJ);
+	}
+
+	float budget = (float) loader->uploadBudgetMilliseconds;
+	if (ImGui::SliderFloat("Upload budget (ms)", &budget, 0.5f, 16.0f)) {
+		loader->uploadBudgetMilliseconds = budget;
+	}
+
+	for (const ModelLoadInfo& load : loader->getLoads()) {
+		ImGui::PushID((int) load.id);
+		ImGui::Text("%s: %s", load.path.c_str(), getModelLoadStatusName(load.status));
+		ImGui::ProgressBar(load.progress, ImVec2(-80.0f, 0.0f));
+
+		bool pending = load.status == ModelLoadStatus::Loading || load.status == ModelLoadStatus::Uploading;
+		if (pending) {
+			ImGui::SameLine();
+			if (ImGui::Button("Cancel")) loader->cancel(load.id);
+		}
+		ImGui::PopID();
+	}
+
+	if (ImGui::Button("Clear finished")) {
+		loader->clearFinished();
+	}
+}
@@ -9,6 +9,7 @@
 #include "ImGuizmo/ImGuizmo.h"
 
 class BaseRenderer;
+class ModelLoader;
 
 class SceneEditor {
 public:
@@ -20,10 +21,14 @@ public:
 
 	BaseRenderer* renderer = nullptr;
 	std::vector<Model> *objs = nullptr;
+	ModelLoader* loader = nullptr;
 	Mesh* chosenObj = nullptr;
 	Material* chosenMaterial = nullptr;
 
 	ImGuizmo::OPERATION operation = ImGuizmo::OPERATION::TRANSLATE;
 
 private:
+	void renderLoads();
+
+	std::string loadPath;
 };
\ No newline at end of file
@@ -155,4 +155,16 @@ bool Frustum::isInside(glm::vec4& maxPoint, glm::vec4& minPoint) {
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const {
+    for (const FrustumPlane& plane : allPlanes) {
+        // The side planes' normals aren't unit length
+        float distance = glm::dot(plane.normal, center - plane.point);
+        if (distance < -radius * glm::length(plane.normal)) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -17,6 +17,8 @@ struct Frustum {
     std::vector<FrustumPlane> allPlanes;
 
     bool isInside(glm::vec4& maxPoint, glm::vec4& minPoint);
+    // Conservative, spheres just outside a corner still count as intersecting
+    bool intersectsSphere(const glm::vec3& center, float radius) const;
 };
 
 enum ProjectionType {
@@ -2,7 +2,25 @@
 #include "stb_image.h"
 
 #include <glad/glad.h>
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
+#include <unordered_map>
+
+// glad was generated without EXT_texture_compression_s3tc, these come from its spec
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+namespace {
+// Storage of everything glutil created and hasn't deleted yet, only touched from the GL thread
+std::unordered_map<unsigned int, size_t> textureSizes;
+std::unordered_map<unsigned int, size_t> bufferSizes;
+glutil::GpuMemoryStats gpuMemory;
+}
 
 namespace glutil {
     unsigned int loadFloatTexture(const std::string& path, GLenum format, GLenum storageFormat) {
@@ -89,6 +107,7 @@ namespace glutil {
         const std::vector<GLfloat> someBuffer(4 * width * height * depth, 0.0f);
 
         glTextureStorage3D(textureID, 6, storageFormat, width, height, depth);
+        trackTexture(textureID, getMipChainSize(width, height, 6, getStorageFormatSize(storageFormat)) * depth);
         glTextureSubImage3D(textureID, 0, 0, 0, 0, width, height, depth, GL_RGBA, GL_FLOAT, &someBuffer[0]);
         glGenerateTextureMipmap(textureID);
         
@@ -100,6 +119,7 @@ namespace glutil {
         glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &textureID);
 
         glTextureStorage3D(textureID, 1, storageFormat, width, height, size);
+        trackTexture(textureID, (size_t) width * height * size * getStorageFormatSize(storageFormat));
 
         for (int i = 0; i < size; i++) {
             glTextureSubImage3D(textureID, 0, 0, 0, i, width, height, 1, format, dataType, data);
@@ -118,6 +138,7 @@ namespace glutil {
         glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
 
         glTextureStorage2D(textureID, levels, storageFormat, width, height);
+        trackTexture(textureID, getMipChainSize(width, height, levels, getStorageFormatSize(storageFormat)));
         glTextureSubImage2D(textureID, 0, 0, 0, width, height, format, dataType, data);
 
         glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -129,39 +150,185 @@ namespace glutil {
         return textureID;
     }
 
-    unsigned int createTexture(int width, int height, GLenum dataType, int nrComponents, unsigned char* data, int levels) {
+    unsigned int createCompressedTexture(int width, int height, int levels, TextureFormat format, const unsigned char* data, size_t dataSize) {
+        unsigned int textureID;
+        glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
+
+        GLenum storageFormat = getCompressedStorageFormat(format);
+        glTextureStorage2D(textureID, levels, storageFormat, width, height);
+        size_t storageSize = 0;
+        for (int level = 0; level < levels; level++) {
+            storageSize += getTextureDataSize(format, std::max(width >> level, 1), std::max(height >> level, 1), 0);
+        }
+        trackTexture(textureID, storageSize);
+
+        size_t offset = 0;
+        for (int level = 0; level < levels; level++) {
+            int levelWidth = std::max(width >> level, 1);
+            int levelHeight = std::max(height >> level, 1);
+            size_t levelSize = getTextureDataSize(format, levelWidth, levelHeight, 0);
+            if (offset + levelSize > dataSize) {
+                std::cout << "Compressed texture is missing mip level " << level << std::endl;
+                break;
+            }
+
+            glCompressedTextureSubImage2D(textureID, level, 0, 0, levelWidth, levelHeight, storageFormat,
+                levelSize, data + offset);
+            offset += levelSize;
+        }
+
+        glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        return textureID;
+    }
+
+    unsigned int createStreamedTexture(int width, int height, int levels, int firstLevel, TextureFormat format, const unsigned char* data, size_t dataSize, bool immutableStorage) {
+        unsigned int textureID;
+        glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
+        if (immutableStorage) {
+            glTextureStorage2D(textureID, levels, getCompressedStorageFormat(format), width, height);
+            size_t storageSize = 0;
+            for (int level = 0; level < levels; level++) {
+                storageSize += getTextureDataSize(format, std::max(width >> level, 1), std::max(height >> level, 1), 0);
+            }
+            trackTexture(textureID, storageSize);
+        }
+        glTextureParameteri(textureID, GL_TEXTURE_BASE_LEVEL, levels - 1);
+        glTextureParameteri(textureID, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+        // Coarsest first, so the base level only ever moves down onto complete levels
+        size_t offset = dataSize;
+        for (int level = levels - 1; level >= firstLevel; level--) {
+            int levelWidth = std::max(width >> level, 1);
+            int levelHeight = std::max(height >> level, 1);
+            size_t levelSize = getTextureDataSize(format, levelWidth, levelHeight, 0);
+            if (levelSize > offset) {
+                std::cout << "Streamed texture is missing mip level " << level << std::endl;
+                break;
+            }
+
+            offset -= levelSize;
+            uploadTextureLevel(textureID, width, height, level, format, data + offset, levelSize);
+        }
+
+        glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        return textureID;
+    }
+
+    void uploadTextureLevel(unsigned int textureID, int width, int height, int level, TextureFormat format, const unsigned char* data, size_t dataSize) {
+        GLint immutableStorage;
+        glGetTextureParameteriv(textureID, GL_TEXTURE_IMMUTABLE_FORMAT, &immutableStorage);
+        if (immutableStorage) {
+            glCompressedTextureSubImage2D(textureID, level, 0, 0, std::max(width >> level, 1),
+                std::max(height >> level, 1), getCompressedStorageFormat(format), dataSize, data);
+            glTextureParameteri(textureID, GL_TEXTURE_BASE_LEVEL, level);
+            return;
+        }
+
+        // Immutable storage can't change its levels and there's no DSA call for mutable storage
+        GLint previousTexture;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, getCompressedStorageFormat(format), std::max(width >> level, 1),
+            std::max(height >> level, 1), 0, dataSize, data);
+        glBindTexture(GL_TEXTURE_2D, previousTexture);
+
+        glTextureParameteri(textureID, GL_TEXTURE_BASE_LEVEL, level);
+        trackTexture(textureID, getTextureSize(textureID) + dataSize);
+    }
+
+    void releaseTextureLevels(unsigned int textureID, int oldFirstLevel, int firstLevel, TextureFormat format) {
+        glTextureParameteri(textureID, GL_TEXTURE_BASE_LEVEL, firstLevel);
+
+        GLint immutableStorage;
+        glGetTextureParameteriv(textureID, GL_TEXTURE_IMMUTABLE_FORMAT, &immutableStorage);
+        if (immutableStorage) {
+            for (int level = oldFirstLevel; level < firstLevel; level++) glInvalidateTexImage(textureID, level);
+            return;
+        }
+
+        GLint previousTexture;
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        // A zero sized image leaves the level undefined and gives its memory back
+        size_t releasedSize = 0;
+        for (int level = oldFirstLevel; level < firstLevel; level++) {
+            GLint width, height;
+            glGetTextureLevelParameteriv(textureID, level, GL_TEXTURE_WIDTH, &width);
+            glGetTextureLevelParameteriv(textureID, level, GL_TEXTURE_HEIGHT, &height);
+            releasedSize += getTextureDataSize(format, width, height, 0);
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, getCompressedStorageFormat(format), 0, 0, 0, 0, nullptr);
+        }
+        glBindTexture(GL_TEXTURE_2D, previousTexture);
+        trackTexture(textureID, getTextureSize(textureID) - std::min(releasedSize, getTextureSize(textureID)));
+    }
+
+    GLenum getCompressedStorageFormat(TextureFormat format) {
+        switch (format) {
+            case TextureFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            case TextureFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            case TextureFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+            case TextureFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+            case TextureFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+            default: return GL_RGBA8;
+        }
+    }
+
+    unsigned int createTexture(int width, int height, GLenum dataType, int nrComponents, const unsigned char* data, int levels) {
+        unsigned int textureID = createTextureStorage(width, height, nrComponents, levels);
+        uploadTextureRows(textureID, 0, width, height, dataType, nrComponents, data);
+        if (levels > 1) glGenerateTextureMipmap(textureID);
+
+        return textureID;
+    }
+
+    unsigned int createTextureStorage(int width, int height, int nrComponents, int levels) {
         unsigned int textureID;
         glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
 
-        GLenum format = GL_RGBA;
         GLenum storageFormat = GL_RGBA8;
         if (nrComponents == 0) {
-            format = GL_DEPTH_COMPONENT;
             storageFormat = GL_DEPTH_COMPONENT;
         } else if (nrComponents == 1) {
-            format = GL_RED;
             storageFormat = GL_R8;
         } else if (nrComponents == 3) {
-            format = GL_RGB;
             storageFormat = GL_RGB8;
-        } else if (nrComponents == 4) {
-            format = GL_RGBA;
-            storageFormat = GL_RGBA8;
         }
 
         glTextureStorage2D(textureID, levels, storageFormat, width, height);
-        glTextureSubImage2D(textureID, 0, 0, 0, width, height, format, dataType, data);
+        trackTexture(textureID, getMipChainSize(width, height, levels, getStorageFormatSize(storageFormat)));
 
         glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 
-        if (levels > 1) glGenerateTextureMipmap(textureID);
-
         return textureID;
     }
 
+    void uploadTextureRows(unsigned int textureID, int firstRow, int width, int rows, GLenum dataType, int nrComponents, const unsigned char* data, int level) {
+        GLenum format = GL_RGBA;
+        if (nrComponents == 0) {
+            format = GL_DEPTH_COMPONENT;
+        } else if (nrComponents == 1) {
+            format = GL_RED;
+        } else if (nrComponents == 3) {
+            format = GL_RGB;
+        }
+
+        // The default 4 byte row alignment doesn't hold for RGB rows or the small levels of a chain
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTextureSubImage2D(textureID, level, 0, firstRow, width, rows, format, dataType, data);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
     unsigned int createCubemap(int width, int height, GLenum dataType, GLenum format, GLenum storageFormat, int nrComponents) {
         unsigned int cubemapID;
         
@@ -182,6 +349,7 @@ namespace glutil {
             storageFormat = GL_RGBA8;
         }
 
+        trackTexture(cubemapID, (size_t) width * height * 6 * getStorageFormatSize(storageFormat));
         for (int i = 0; i < 6; i++) {
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, storageFormat, width, height, 0,
                 format, dataType, nullptr);
@@ -225,6 +393,7 @@ namespace glutil {
 
                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, storageFormat, width, height, 0, format,
                 GL_UNSIGNED_BYTE, data);
+                trackTexture(textureID, getTextureSize(textureID) + (size_t) width * height * getStorageFormatSize(storageFormat));
 
                 glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
                 glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -247,8 +416,7 @@ namespace glutil {
 
         glCreateVertexArrays(1, &VAO);
 
-        glCreateBuffers(1, &VBO);
-        glNamedBufferStorage(VBO, sizeof(float) * vertices.size(), vertices.data(), GL_DYNAMIC_STORAGE_BIT);
+        VBO = createBuffer(sizeof(float) * vertices.size(), vertices.data());
 
         glBindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -281,11 +449,9 @@ namespace glutil {
 
         glCreateVertexArrays(1, &VAO);
 
-        glCreateBuffers(1, &VBO);
-        glNamedBufferStorage(VBO, sizeof(float) * vertices.size(), vertices.data(), GL_DYNAMIC_STORAGE_BIT);
+        VBO = createBuffer(sizeof(float) * vertices.size(), vertices.data());
 
-        glCreateBuffers(1, &EBO);
-        glNamedBufferStorage(EBO, sizeof(unsigned int) * indices.size(), indices.data(), GL_DYNAMIC_STORAGE_BIT);
+        EBO = createBuffer(sizeof(unsigned int) * indices.size(), indices.data());
 
         glBindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -315,49 +481,83 @@ namespace glutil {
         return newBuffer;
     }
 
-    AllocatedBuffer loadVertexBuffer(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, 
-        std::vector<VertexType>& endpoints) {
-        unsigned int VAO, VBO, EBO;
-
-        glCreateVertexArrays(1, &VAO);
+    unsigned int createBuffer(size_t size, const void* data, GLbitfield flags) {
+        unsigned int buffer;
+        glCreateBuffers(1, &buffer);
+        glNamedBufferStorage(buffer, size, data, flags);
 
-        glCreateBuffers(1, &VBO);
-        glNamedBufferStorage(VBO, sizeof(Vertex) * vertices.size(), vertices.data(), GL_DYNAMIC_STORAGE_BIT);
-
-        glCreateBuffers(1, &EBO);
-        glNamedBufferStorage(EBO, sizeof(unsigned int) * indices.size(), indices.data(), GL_DYNAMIC_STORAGE_BIT);
+        bufferSizes[buffer] = size;
+        gpuMemory.bufferBytes += size;
+        return buffer;
+    }
 
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    void deleteBuffer(unsigned int buffer) {
+        if (buffer == 0) return;
 
-        int totalLength = 0;
-        for (auto endpoint : endpoints) {
-            totalLength += sizes[endpoint];
+        auto iterator = bufferSizes.find(buffer);
+        if (iterator != bufferSizes.end()) {
+            gpuMemory.bufferBytes -= iterator->second;
+            bufferSizes.erase(iterator);
         }
+        glDeleteBuffers(1, &buffer);
+    }
 
-        int currentOffset = 0;
-        for (int i = 0; i < endpoints.size(); i++) {
-            VertexType type = endpoints[i];
+    void deleteVertexBuffer(AllocatedBuffer& buffer) {
+        if (buffer.VAO != 0) glDeleteVertexArrays(1, &buffer.VAO);
+        deleteBuffer(buffer.VBO);
+        deleteBuffer(buffer.EBO);
+        buffer = {};
+    }
 
-            glEnableVertexAttribArray(i);
-            if (i == 5) {
-                glVertexAttribIPointer(i, sizes[type], GL_UNSIGNED_INT, sizeof(unsigned int) * totalLength, (void*) (currentOffset * sizeof(float)));
-            } else {
-                glVertexAttribPointer(i, sizes[type], GL_FLOAT, GL_FALSE, sizeof(float) * totalLength, (void*) (currentOffset * sizeof(float)));
-            }
+    void trackTexture(unsigned int textureID, size_t size) {
+        size_t& trackedSize = textureSizes[textureID];
+        gpuMemory.textureBytes += size - trackedSize;
+        trackedSize = size;
+    }
 
+    void deleteTextures(const std::vector<unsigned int>& textureIDs) {
+        for (unsigned int textureID : textureIDs) {
+            auto iterator = textureSizes.find(textureID);
+            if (iterator == textureSizes.end()) continue;
 
-            currentOffset += sizes[type];
+            gpuMemory.textureBytes -= iterator->second;
+            textureSizes.erase(iterator);
         }
+        if (!textureIDs.empty()) glDeleteTextures(textureIDs.size(), textureIDs.data());
+    }
 
-        glVertexArrayElementBuffer(VAO, EBO);
+    size_t getBufferSize(unsigned int buffer) {
+        auto iterator = bufferSizes.find(buffer);
+        return iterator != bufferSizes.end() ? iterator->second : 0;
+    }
 
-        AllocatedBuffer newBuffer{};
-        newBuffer.VAO = VAO;
-        newBuffer.VBO = VBO;
-        newBuffer.EBO = EBO;
+    size_t getTextureSize(unsigned int textureID) {
+        auto iterator = textureSizes.find(textureID);
+        return iterator != textureSizes.end() ? iterator->second : 0;
+    }
 
-        return newBuffer;
+    GpuMemoryStats getGpuMemoryStats() {
+        return gpuMemory;
+    }
+
+    size_t getStorageFormatSize(GLenum storageFormat) {
+        switch (storageFormat) {
+            case GL_R8: return 1;
+            case GL_RG8: case GL_R16F: return 2;
+            case GL_RGBA16F: case GL_RGB16F: return 8;
+            case GL_RGBA32F: case GL_RGB32F: return 16;
+            case GL_RG32F: return 8;
+            // RGB8 is padded to 4 bytes by every driver
+            default: return 4;
+        }
+    }
+
+    size_t getMipChainSize(int width, int height, int levels, size_t texelSize) {
+        size_t size = 0;
+        for (int level = 0; level < levels; level++) {
+            size += (size_t) std::max(width >> level, 1) * std::max(height >> level, 1) * texelSize;
+        }
+        return size;
     }
 };
 
@@ -39,13 +39,47 @@ namespace glutil {
 
     unsigned int createTexture3D(int width, int height, int depth, GLenum storageFormat = GL_RGBA8);
     unsigned int createTextureArray(int size, int width, int height, GLenum dataType, GLenum format = GL_RGBA, GLenum storageFormat = GL_RGBA8, void* data = nullptr);
-    unsigned int createTexture(int width, int height, GLenum dataType, int nrComponents = 0, unsigned char* data = nullptr, int levels = 4);
+    unsigned int createTexture(int width, int height, GLenum dataType, int nrComponents = 0, const unsigned char* data = nullptr, int levels = 4);
     unsigned int createTexture(int width, int height, GLenum dataType, GLenum format = GL_RGBA, GLenum storageFormat = GL_RGBA8, void* data = nullptr, int levels = 4);
+    // createTexture in parts, for uploads spread over several frames: the storage, then a band of rows of a level at
+    // a time. Rows are tightly packed whatever their size.
+    unsigned int createTextureStorage(int width, int height, int nrComponents, int levels);
+    void uploadTextureRows(unsigned int textureID, int firstRow, int width, int rows, GLenum dataType, int nrComponents, const unsigned char* data, int level = 0);
+    // Uploads a baked chain of BCn levels as is, largest level first
+    unsigned int createCompressedTexture(int width, int height, int levels, TextureFormat format, const unsigned char* data, size_t dataSize);
+    // Mutable storage, so levels can come and go while the id stays the same, and only levels [firstLevel, levels)
+    // are allocated. Immutable storage allocates the whole chain up front instead, which bindless handles and
+    // texture views need. data holds levels [firstLevel, levels) largest first.
+    unsigned int createStreamedTexture(int width, int height, int levels, int firstLevel, TextureFormat format, const unsigned char* data, size_t dataSize, bool immutableStorage = false);
+    // Fills one more level of a streamed texture, right below its current base level, allocating it first with mutable storage
+    void uploadTextureLevel(unsigned int textureID, int width, int height, int level, TextureFormat format, const unsigned char* data, size_t dataSize);
+    // Samples a streamed texture from firstLevel on and frees levels [oldFirstLevel, firstLevel), or with immutable
+    // storage only discards their contents
+    void releaseTextureLevels(unsigned int textureID, int oldFirstLevel, int firstLevel, TextureFormat format);
+    GLenum getCompressedStorageFormat(TextureFormat format);
 
     unsigned int createCubemap(int width, int height, GLenum dataType, GLenum format = GL_DEPTH_COMPONENT, GLenum storageFormat = GL_DEPTH_COMPONENT, int nrComponents = -1);
     unsigned int loadCubemap(const std::string& path, std::vector<std::string> faces = defaultFaces);
 
     AllocatedBuffer loadVertexBuffer(std::vector<float>& vertices, std::vector<VertexType>& endpoints = basicEndpoints);
     AllocatedBuffer loadVertexBuffer(std::vector<float>& vertices, std::vector<unsigned int>& indices, std::vector<VertexType>& endpoints = basicEndpoints);
-    AllocatedBuffer loadVertexBuffer(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, std::vector<VertexType>& endpoints = basicEndpoints);
+    unsigned int createBuffer(size_t size, const void* data, GLbitfield flags = GL_DYNAMIC_STORAGE_BIT);
+
+    // Textures and buffers made above are tracked until they're deleted through these
+    void deleteBuffer(unsigned int buffer);
+    void deleteVertexBuffer(AllocatedBuffer& buffer);
+    void deleteTextures(const std::vector<unsigned int>& textureIDs);
+    // For storage changed behind glutil's back, replaces the tracked size of the texture
+    void trackTexture(unsigned int textureID, size_t size);
+
+    struct GpuMemoryStats {
+        size_t textureBytes = 0;
+        size_t bufferBytes = 0;
+    };
+    // Bytes of storage requested, what drivers really allocate is usually a bit more
+    GpuMemoryStats getGpuMemoryStats();
+    size_t getBufferSize(unsigned int buffer);
+    size_t getTextureSize(unsigned int textureID);
+    size_t getStorageFormatSize(GLenum storageFormat);
+    size_t getMipChainSize(int width, int height, int levels, size_t texelSize);
 };
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "hash.h"
+
+#include <cstring>
+
+namespace {
+constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+
+uint64_t finalize(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t rotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+
+    // Four independent lanes keep the multiplies pipelined on large buffers like textures
+    uint64_t lanes[4] = {seed + PRIME_1, seed + PRIME_2, seed, seed - PRIME_1};
+    size_t offset = 0;
+    for (; offset + 32 <= size; offset += 32) {
+        for (int i = 0; i < 4; i++) {
+            uint64_t word;
+            memcpy(&word, bytes + offset + i * 8, sizeof(uint64_t));
+            lanes[i] = rotateLeft(lanes[i] + word * PRIME_2, 31) * PRIME_1;
+        }
+    }
+
+    uint64_t h = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+    h += size;
+
+    for (; offset + 8 <= size; offset += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + offset, sizeof(uint64_t));
+        h = rotateLeft(h ^ (rotateLeft(word * PRIME_2, 31) * PRIME_1), 27) * PRIME_1 + PRIME_2;
+    }
+    for (; offset < size; offset++) {
+        h = rotateLeft(h ^ (bytes[offset] * PRIME_1), 11) * PRIME_2;
+    }
+
+    return finalize(h);
+}
+
+uint64_t hashCombine(uint64_t seed, uint64_t value) {
+    return finalize(seed ^ (value + PRIME_1 + (seed << 6) + (seed >> 2)));
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Fast non-cryptographic 64 bit hash, used to detect changed asset sources and identical content
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+uint64_t hashCombine(uint64_t seed, uint64_t value);
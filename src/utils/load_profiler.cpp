@@ -0,0 +1,58 @@
+#include "load_profiler.h"
+
+namespace {
+std::atomic<LoadProfile*> activeProfile{nullptr};
+}
+
+const char* getLoadStageName(LoadStage stage) {
+    switch (stage) {
+        case LoadStage::FileIO: return "file_io";
+        case LoadStage::AssimpRead: return "assimp_read";
+        case LoadStage::ProcessMaterials: return "process_materials";
+        case LoadStage::TextureDecode: return "texture_decode";
+        case LoadStage::ProcessMesh: return "process_mesh";
+        case LoadStage::MeshOptimize: return "mesh_optimize";
+        case LoadStage::TextureCompress: return "texture_compress";
+        case LoadStage::HeaderParse: return "header_parse";
+        case LoadStage::Decompress: return "decompress";
+        default: return "unknown";
+    }
+}
+
+double LoadProfile::getStageMilliseconds(LoadStage stage) const {
+    return stageNanoseconds[static_cast<size_t>(stage)].load() / 1e6;
+}
+
+void LoadProfile::reset() {
+    for (std::atomic<uint64_t>& nanoseconds : stageNanoseconds) nanoseconds = 0;
+    decompressedBytes = 0;
+    fileBytes = 0;
+}
+
+void setActiveLoadProfile(LoadProfile* profile) {
+    activeProfile = profile;
+}
+
+LoadProfile* getActiveLoadProfile() {
+    return activeProfile.load(std::memory_order_relaxed);
+}
+
+ScopedLoadTimer::ScopedLoadTimer(LoadStage stage) : profile(getActiveLoadProfile()), stage(stage) {
+    if (profile != nullptr) startTime = std::chrono::steady_clock::now();
+}
+
+ScopedLoadTimer::~ScopedLoadTimer() {
+    if (profile == nullptr) return;
+
+    auto elapsed = std::chrono::steady_clock::now() - startTime;
+    profile->stageNanoseconds[static_cast<size_t>(stage)] +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+void addDecompressedBytes(uint64_t bytes) {
+    if (LoadProfile* profile = getActiveLoadProfile()) profile->decompressedBytes += bytes;
+}
+
+void addFileBytes(uint64_t bytes) {
+    if (LoadProfile* profile = getActiveLoadProfile()) profile->fileBytes += bytes;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+enum class LoadStage {
+    FileIO, AssimpRead, ProcessMaterials, TextureDecode, ProcessMesh, MeshOptimize, TextureCompress, HeaderParse,
+    Decompress, Count
+};
+constexpr size_t LOAD_STAGE_COUNT = static_cast<size_t>(LoadStage::Count);
+
+const char* getLoadStageName(LoadStage stage);
+
+// Time spent in every stage of loading a model. Stages run on several threads at once, so the times add up
+// thread time and can go over the wall time of the load.
+struct LoadProfile {
+    std::atomic<uint64_t> stageNanoseconds[LOAD_STAGE_COUNT] = {};
+    // Bytes coming out of LZ4 and bytes read from source files and packs
+    std::atomic<uint64_t> decompressedBytes{0};
+    std::atomic<uint64_t> fileBytes{0};
+
+    double getStageMilliseconds(LoadStage stage) const;
+    void reset();
+};
+
+// Loads report to the active profile, when there is none the timers below don't do anything
+void setActiveLoadProfile(LoadProfile* profile);
+LoadProfile* getActiveLoadProfile();
+
+class ScopedLoadTimer {
+public:
+    explicit ScopedLoadTimer(LoadStage stage);
+    ~ScopedLoadTimer();
+
+    ScopedLoadTimer(const ScopedLoadTimer&) = delete;
+    ScopedLoadTimer& operator=(const ScopedLoadTimer&) = delete;
+
+private:
+    LoadProfile* profile;
+    LoadStage stage;
+    std::chrono::steady_clock::time_point startTime;
+};
+
+void addDecompressedBytes(uint64_t bytes);
+void addFileBytes(uint64_t bytes);
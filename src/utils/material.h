@@ -14,6 +14,8 @@ struct Material {
 	std::vector<Texture> textures;
 	std::vector<std::string> texture_paths;
 	Shader* shader;
+	// Entry in the renderer's material table, -1 while the textures get bound per draw
+	int tableIndex = -1;
 
 	std::unordered_map<std::string, int> uniformInts;
 	std::unordered_map<std::string, float> uniformFloats;
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template<typename F>
+    auto submit(F&& function) -> std::future<decltype(function())>;
+
+    // Runs function(i) for every i in [0, count) on the pool and returns once all of them have finished
+    template<typename F>
+    void parallelFor(size_t count, F&& function);
+
+    // Waits for a result while running queued tasks, so a task can safely wait on tasks it submitted itself
+    template<typename T>
+    T wait(std::future<T>& result);
+
+    unsigned int getThreadCount() const { return workers.size(); }
+
+    // Process-wide pool sized to the number of hardware threads
+    static ThreadPool& shared();
+
+private:
+    void workerLoop();
+    bool runPendingTask();
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
+
+template<typename F>
+auto ThreadPool::submit(F&& function) -> std::future<decltype(function())> {
+    using ReturnType = decltype(function());
+
+    auto task = std::make_shared<std::packaged_task<ReturnType()>>(std::forward<F>(function));
+    std::future<ReturnType> result = task->get_future();
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        tasks.emplace([task]() { (*task)(); });
+    }
+    condition.notify_one();
+
+    return result;
+}
+
+template<typename T>
+T ThreadPool::wait(std::future<T>& result) {
+    while (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        if (!runPendingTask()) result.wait_for(std::chrono::microseconds(100));
+    }
+
+    return result.get();
+}
+
+template<typename F>
+void ThreadPool::parallelFor(size_t count, F&& function) {
+    std::vector<std::future<void>> results;
+    results.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        results.push_back(submit([&function, i]() { function(i); }));
+    }
+
+    for (std::future<void>& result : results) {
+        wait(result);
+    }
+}
@@ -1 +1,10 @@
 #include "types.h"
+
+size_t getTextureDataSize(TextureFormat format, int width, int height, int nrComponents) {
+    if (format == TextureFormat::Uncompressed) {
+        return (size_t) width * height * nrComponents;
+    }
+
+    size_t blockSize = format == TextureFormat::BC1 || format == TextureFormat::BC4 ? 8 : 16;
+    return (size_t) ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
@@ -53,16 +53,53 @@ struct Vertex {
     unsigned int ID;
 };
 
+// 24 byte baked vertex. Position is unorm16 inside the mesh bounds with the bitangent sign in w,
+// normal and tangent are octahedral snorm16 and texture coordinates are half floats.
+struct PackedVertex {
+    uint16_t position[4];
+    int16_t normal[2];
+    int16_t tangent[2];
+    uint16_t texCoords[2];
+    unsigned int ID;
+};
+
+// Layout of Texture::data. Uncompressed holds nrComponents bytes per pixel, the others are rows of 4x4 blocks
+enum class TextureFormat : uint32_t {
+    Uncompressed = 0, BC1, BC3, BC4, BC5, BC7
+};
+
+// Where an asset file sits in a pack, so it can be read again without going through the table of contents
+struct PackLocation {
+    uint64_t offset = 0;
+    uint64_t size = 0;
+
+    bool isValid() const { return size != 0; }
+};
+
 struct Texture {
     unsigned int id = -1;
     std::string type;
     std::string path;
 
     int width = 0, height = 0, nrComponents = 0;
+    TextureFormat format = TextureFormat::Uncompressed;
+    // Baked textures hold their whole mip chain in data, largest level first
+    int levels = 1;
+    // Finest level in data. Textures loaded from a pack start out with their coarse levels only and stream the
+    // finer ones from streamSource, the pack, later on.
+    int firstLevel = 0;
+    std::string streamSource;
+    // Of the texture in streamSource
+    PackLocation streamLocation;
 
     unsigned char* data = nullptr;
+    size_t dataSize = 0;
+    // Set once the texture holds a reference in the texture registry, which then owns data
+    uint64_t contentHash = 0;
 };
 
+size_t getTextureDataSize(TextureFormat format, int width, int height, int nrComponents);
+
 #define MAX_BONES_PER_VERTEX 4
 
 struct VertexBoneData {
@@ -76,7 +113,14 @@ struct BoneInfo {
 };
 
 struct AllocatedBuffer {
-    unsigned int VAO, VBO, EBO;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+};
+
+// Slot of a mesh in the renderer's GeometryPool
+struct GeometryHandle {
+    unsigned int id = ~0u;
+
+    bool isValid() const { return id != ~0u; }
 };
 
 struct BoundingBox {